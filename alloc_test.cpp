@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Checks that parsing into warm buffers doesn't allocate, for every built-in
+// argument and parameter type, see `make alloc_test`. Built with
+// ARGS_ALLOC_AUDIT, so an allocating parse of the allocation-free schema
+// reports the allocation and aborts.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "args.hpp"
+
+
+using namespace args::condition;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+int main() {
+	if (!args::AllocAudit::enabled()) {
+		std::printf("FAILED: built without ARGS_ALLOC_AUDIT\n");
+		return 1;
+	}
+
+	enum class Mode { FAST, SLOW };
+
+	auto plain     = args::flag('p', "plain");
+	auto boolean   = args::flag<bool>('b', "bool");
+	auto integer   = args::flag<int>('i', "int");
+	auto multi     = args::flag<bool, int>('m', "multi");
+	auto string    = args::flag<args::Str>('s', "str");
+	auto view      = args::flag<args::StrView>('v', "view");
+	auto poly      = args::flag<args::PolyString>('y', "poly");
+	auto lazy      = args::flag<args::Lazy<int>>('l', "lazy");
+	auto path      = args::flag<args::ExistingPath>('e', "existing");
+	auto dir       = args::flag<args::ExistingDir>('d', "dir");
+	auto creatable = args::flag<args::CreatablePath>('c', "creatable");
+
+	auto mode = args::map_lookup_arg<Mode>({
+		{ "fast", Mode::FAST },
+		{ "slow", Mode::SLOW }
+	}, max(0));
+
+	auto number = args::lambda_arg<int>([](const args::BaseArg&, args::ParserState& s) {
+		int n;
+		auto token = s.arg_next();
+
+		return args::ParamParser<int>::parse_int(token, n)
+			? args::ParseResult<int>::ok(n)
+			: args::ParseResult<int>::err(args::ParseError(args::InvalidParam("", token)));
+	}, max(0));
+
+	auto rest = args::rest_arg(args::RestFrom::EndOfFlags);
+
+	auto schema = args::schema(
+		args::flags(plain, boolean, integer, multi, string, view, poly, lazy,
+			path, dir, creatable),
+		args::args(mode, number, rest)
+	).allocation_free();
+
+	// "17" fails the precondition of mode before it's taken by number, which
+	// must not allocate either. The strings and paths are longer than the
+	// small-string buffer: the data they own is left out of the audit
+	std::vector<const char*> argv = {
+		"-p", "--plain", "-b", "true", "--int=42", "-i7", "-m", "false", "3",
+		"-s", "a string parameter longer than the small buffer",
+		"--view", "a view", "-y", "a polymorphic string that needs its resource",
+		"--lazy", "12",
+		"-e", "/usr/share/doc/args/examples/readme_example.cpp",
+		"--dir", "/var/lib/build-cache/args/objects",
+		"-c", "./build/release/output/args-benchmark-results.json",
+		"fast", "17", "--", "rest", "-of", "argv"
+	};
+
+	args::OwnedParserState state;
+	auto results = decltype(schema.parse(argv.begin(), argv.end()))();
+
+	// the first parse sizes the buffers, the next ones are audited
+	for (int i = 0; i < 3; i++) {
+		const auto& res = schema.parse(argv.begin(), argv.end(), results, state);
+
+		if (!res.is_ok())
+			args::report_error(res, std::cout);
+
+		check(res.is_ok(), "warm parse");
+	}
+
+	check(results.multiplicity(plain) == 2, "plain flag");
+	check(std::get<0>(results[string][0]) == "a string parameter longer than the small buffer",
+		"string flag");
+	check(std::get<0>(results[creatable][0]).str() == "./build/release/output/args-benchmark-results.json",
+		"path flag");
+	check(std::get<0>(results[integer][0]) == 42, "integer flag");
+	check(std::get<1>(results[multi][0]) == 3, "multi flag");
+	check(std::get<0>(results[lazy][0]).get() == 12, "lazy flag");
+	check(results[mode][0] == Mode::FAST, "map lookup argument");
+	check(results[number][0] == 17, "lambda argument");
+	check(results[rest][0].size() == 3, "rest argument");
+
+
+	// results parsed with a resource outlive it
+	auto name = args::flag<args::PolyString>('n', "name");
+	auto name_parser = args::flags(name);
+
+	const char* named[] = { "-n", "a name too long for the small string buffer" };
+
+	for (int i = 0; i < 3; i++) {
+		args::MonotonicBuffer arena(128);
+		check(args::parse(arena, named, named + 2, name_parser).is_ok(), "parse with a resource");
+	}
+
+	check(std::get<0>(name.result[0]) == "a name too long for the small string buffer",
+		"results moved out of the resource");
+
+
+	if (failures == 0)
+		std::printf("alloc_test: OK\n");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#!/bin/sh
+# Writes args.hpp, the single-header configuration of the library: every
+# header reachable from args_all.hpp and every source file under lib/, with
+# their local includes inlined once, so that it only needs the system and
+# boost headers. Run by `make single_header`.
+
+cd "$(dirname "$0")" || exit 1
+
+awk -v sources="$(find lib -name '*.cpp' | LC_ALL=C sort | tr '\n' ' ')" '
+function exists(path,    status, dummy) {
+	status = (getline dummy < path)
+	close(path)
+	return status >= 0
+}
+
+function resolve(from, name,    dir) {
+	dir = from
+	sub(/[^\/]*$/, "", dir)
+
+	if (exists(dir name))
+		return dir name
+	if (exists("lib/" name))
+		return "lib/" name
+	if (exists(name))
+		return name
+	return ""
+}
+
+# copies path without its license header, inlining its local includes
+function emit(path,    line, in_license, first, name, found) {
+	if (path in seen)
+		return
+	seen[path] = 1
+
+	first = 1
+	in_license = 0
+
+	while ((getline line < path) > 0) {
+		if (first && line ~ /^\/\*/)
+			in_license = 1
+		first = 0
+
+		if (in_license) {
+			if (line ~ /\*\//)
+				in_license = 0
+			continue
+		}
+
+		if (line ~ /^#include "/) {
+			name = line
+			sub(/^#include "/, "", name)
+			sub(/".*$/, "", name)
+			found = resolve(path, name)
+
+			if (found != "") {
+				emit(found)
+				continue
+			}
+		}
+
+		print line
+	}
+
+	close(path)
+}
+
+BEGIN {
+	# the license header of args_all.hpp
+	while ((getline line < "args_all.hpp") > 0) {
+		print line
+		if (line ~ /\*\//)
+			break
+	}
+	close("args_all.hpp")
+
+	print ""
+	print "// Single-header configuration: the whole library without building or linking"
+	print "// lib/libargs. Include this wherever args is used, and define"
+	print "// ARGS_IMPLEMENTATION before including it in exactly one source file, which"
+	print "// then compiles the out-of-line parts of the library (error display, sources,"
+	print "// utilities). The parse loop itself is in the headers, so it is inlined into"
+	print "// every caller in both configurations."
+	print "//"
+	print "// Generated from lib/ by amalgamate.sh (make single_header), do not edit."
+	print ""
+	print "#ifndef ARGS_SINGLE_HEADER_H"
+	print "#define ARGS_SINGLE_HEADER_H"
+	print ""
+
+	emit("args_all.hpp")
+
+	print ""
+	print "#endif"
+	print ""
+	print ""
+	print "#if defined(ARGS_IMPLEMENTATION) && !defined(ARGS_IMPLEMENTATION_INCLUDED)"
+	print "#define ARGS_IMPLEMENTATION_INCLUDED"
+
+	n = split(sources, files, " ")
+
+	for (i = 1; i <= n; i++) {
+		print ""
+		print "// " files[i]
+		emit(files[i])
+	}
+
+	print ""
+	print "#endif"
+}
+' > args.hpp.tmp && mv args.hpp.tmp args.hpp
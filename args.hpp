@@ -0,0 +1,8922 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Single-header configuration: the whole library without building or linking
+// lib/libargs. Include this wherever args is used, and define
+// ARGS_IMPLEMENTATION before including it in exactly one source file, which
+// then compiles the out-of-line parts of the library (error display, sources,
+// utilities). The parse loop itself is in the headers, so it is inlined into
+// every caller in both configurations.
+//
+// Generated from lib/ by amalgamate.sh (make single_header), do not edit.
+
+#ifndef ARGS_SINGLE_HEADER_H
+#define ARGS_SINGLE_HEADER_H
+
+
+
+#ifndef ARGS_FLAG_H
+#define ARGS_FLAG_H
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+
+#ifndef ARGS_TYPES_H
+#define ARGS_TYPES_H
+
+#include <limits>
+#include <tuple>
+#include <string>
+#include <vector>
+
+
+#ifndef ARGS_STRING_VIEW_H
+#define ARGS_STRING_VIEW_H
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+namespace args {
+
+class StrView {
+	const char* m_c_str;
+	std::size_t m_size;
+
+public:
+	static constexpr std::size_t npos = std::size_t(-1);
+
+	StrView() : StrView("", 0) {}
+	StrView(const StrView&) = default;
+	StrView& operator= (const StrView&) = default;
+
+	// views built from a pointer and a size (e.g. with substr()) are not
+	// necessarily null-terminated
+	explicit StrView(const char* c_str, std::size_t size)
+		: m_c_str(c_str), m_size(size) {}
+
+	StrView(const char* c_str) : StrView(c_str, std::strlen(c_str)) {}
+
+	StrView(const std::string& str) : StrView(str.c_str(), str.size()) {}
+
+
+	const char* c_str() const {
+		return m_c_str;
+	}
+
+	std::string str() const {
+		return std::string(m_c_str, m_size);
+	}
+
+	std::size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	const char* begin() const {
+		return m_c_str;
+	}
+
+	const char* end() const {
+		return m_c_str + m_size;
+	}
+
+	char operator[](std::size_t pos) const {
+		return m_c_str[pos];
+	}
+
+	StrView substr(std::size_t pos, std::size_t n = npos) const {
+		return StrView(m_c_str + pos, std::min(n, m_size - pos));
+	}
+
+	bool starts_with(const StrView& prefix) const {
+		return m_size >= prefix.m_size &&
+			std::memcmp(m_c_str, prefix.m_c_str, prefix.m_size) == 0;
+	}
+
+	int compare(const StrView& other) const {
+		int cmp = std::memcmp(m_c_str, other.m_c_str, std::min(m_size, other.m_size));
+
+		if (cmp != 0)
+			return cmp;
+		else
+			return m_size < other.m_size ? -1 : m_size > other.m_size ? 1 : 0;
+	}
+};
+
+}
+
+inline bool operator== (const args::StrView& v1, const args::StrView& v2) {
+	return v1.size() == v2.size() &&
+		std::memcmp(v1.c_str(), v2.c_str(), v1.size()) == 0;
+}
+
+inline bool operator!= (const args::StrView& v1, const args::StrView& v2) {
+	return !(v1 == v2);
+}
+
+inline bool operator< (const args::StrView& v1, const args::StrView& v2) {
+	return v1.compare(v2) < 0;
+}
+
+inline std::ostream& operator<< (std::ostream& o, const args::StrView& v) {
+	return o.write(v.c_str(), v.size());
+}
+
+
+#endif
+
+#ifndef ARGS_RESULT_H
+#define ARGS_RESULT_H
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+
+namespace args {
+
+template <typename T>
+struct ResultOkWrapper {
+	T data;
+};
+
+template <typename T>
+struct ResultErrWrapper {
+	T data;
+};
+
+
+template <typename O, typename E>
+class Result {
+	const enum class Type {
+		Ok, Err
+	} type;
+
+	union {
+		O ok_value;
+		E err_value;
+	};
+
+	struct OkTag {};
+	struct ErrTag {};
+
+
+	template <typename... Ts>
+	Result(OkTag, Ts&&... args)
+		: type(Type::Ok)
+		, ok_value(std::forward<Ts>(args)...) {}
+
+	template <typename... Ts>
+	Result(ErrTag, Ts&&... args)
+		: type(Type::Err)
+		, err_value(std::forward<Ts>(args)...) {}
+
+public:
+	using OkType = O;
+	using ErrType = E;
+
+	template <typename T>
+	Result(ResultOkWrapper<T>&& w)
+		: Result(OkTag(), std::move(w.data)) {}
+
+	template <typename T>
+	Result(ResultErrWrapper<T>&& w)
+		: Result(ErrTag(), std::move(w.data)) {}
+
+
+	Result(const Result& other) : type(other.type) {
+		if (is_ok())
+			new (&ok_value) OkType(other.ok_value);
+		else
+			new (&err_value) ErrType(other.err_value);
+	}
+
+	Result(Result&& other) : type(other.type) {
+		if (is_ok())
+			new (&ok_value) OkType(std::move(other.ok_value));
+		else
+			new (&err_value) ErrType(std::move(other.err_value));
+	}
+
+
+	~Result() {
+		if (is_ok())
+			ok_value.~OkType();
+		else
+			err_value.~ErrType();
+	}
+
+	template <typename... Ts>
+	static Result ok(Ts&&... args) {
+		return Result(OkTag(), std::forward<Ts>(args)...);
+	}
+
+	template <typename... Ts>
+	static Result err(Ts&&... args) {
+		return Result(ErrTag(), std::forward<Ts>(args)...);
+	}
+
+
+	bool is_ok() const {
+		return type == Type::Ok;
+	}
+
+
+	const OkType& get_ok() const {
+		return ok_value;
+	}
+
+	OkType& get_ok() {
+		return ok_value;
+	}
+
+
+	const ErrType& get_err() const {
+		return err_value;
+	}
+
+	ErrType& get_err() {
+		return err_value;
+	}
+
+
+	template <typename F>
+	const Result& if_ok(F&& f) const& {
+		if (is_ok())
+			f(get_ok());
+
+		return *this;
+	}
+
+	template <typename F>
+	Result& if_ok(F&& f) & {
+		if (is_ok())
+			f(get_ok());
+
+		return *this;
+	}
+
+	template <typename F>
+	Result&& if_ok(F&& f) && {
+		if (is_ok())
+			f(std::move(get_ok()));
+
+		return std::move(*this);
+	}
+
+
+	template <typename F>
+	const Result& if_err(F&& f) const& {
+		if (!is_ok())
+			f(get_err());
+
+		return *this;
+	}
+
+	template <typename F>
+	Result& if_err(F&& f) & {
+		if (!is_ok())
+			f(get_err());
+
+		return *this;
+	}
+
+	template <typename F>
+	Result&& if_err(F&& f) && {
+		if (!is_ok())
+			f(std::move(get_err()));
+
+		return std::move(*this);
+	}
+};
+
+
+}
+
+#endif
+
+
+#ifndef ARGS_PARSE_ERROR_H
+#define ARGS_PARSE_ERROR_H
+
+#include <string>
+#include <type_traits>
+
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/find.hpp>
+#include <boost/mpl/vector.hpp>
+#include <boost/variant/variant.hpp>
+#include <boost/variant/get.hpp>
+
+
+
+#ifndef ARGS_PARSER_STATE_H
+#define ARGS_PARSER_STATE_H
+
+#include <cstring>
+#include <vector>
+#include <string>
+
+
+#ifndef ARGS_MATCH_LOG_H
+#define ARGS_MATCH_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+
+#ifndef ARGS_MEMORY_RESOURCE_H
+#define ARGS_MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+namespace args {
+
+// Source of memory for the storage owned by the parser (argv views, matched
+// arguments, results), modeled after std::pmr::memory_resource.
+class MemoryResource {
+public:
+	virtual ~MemoryResource() = default;
+
+	void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+		return do_allocate(bytes, align);
+	}
+
+	void deallocate(void* p, std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+		do_deallocate(p, bytes, align);
+	}
+
+protected:
+	virtual void* do_allocate(std::size_t bytes, std::size_t align) = 0;
+
+	virtual void do_deallocate(void* p, std::size_t bytes, std::size_t align) = 0;
+};
+
+// operator new and delete
+MemoryResource* new_delete_resource();
+
+// throws std::bad_alloc on every allocation, e.g. as the upstream of a
+// MonotonicBuffer over a fixed buffer
+MemoryResource* null_resource();
+
+
+// Hands out memory from a buffer by bumping a pointer, and gets more from
+// upstream when it's exhausted (in growing chunks). Deallocation does
+// nothing: everything is freed at once by release() or the destructor.
+// Not thread-safe.
+class MonotonicBuffer : public MemoryResource {
+	struct Chunk {
+		Chunk* previous;
+		std::size_t size;
+	};
+
+	char* initial_buffer;
+	std::size_t initial_size;
+
+	char* current;
+	std::size_t remaining;
+	std::size_t next_chunk_size;
+
+	Chunk* chunks = nullptr;
+	MemoryResource* upstream;
+
+public:
+	// starts with buffer, which is not owned
+	MonotonicBuffer(void* buffer, std::size_t size,
+			MemoryResource* upstream = new_delete_resource());
+
+	explicit MonotonicBuffer(std::size_t initial_chunk_size = 1024,
+			MemoryResource* upstream = new_delete_resource());
+
+	MonotonicBuffer(const MonotonicBuffer&) = delete;
+	MonotonicBuffer& operator= (const MonotonicBuffer&) = delete;
+
+	~MonotonicBuffer();
+
+	// frees everything allocated so far. the storage that used it must not be
+	// used anymore
+	void release();
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t align) override;
+
+	void do_deallocate(void*, std::size_t, std::size_t) override {
+	}
+};
+
+
+// Allocator that uses a MemoryResource (new_delete_resource() by default).
+// Unlike std::pmr::polymorphic_allocator, the resource is propagated on move
+// assignment and swap, so assigning a container built with another resource
+// (see ArgState::use_resource) switches the storage to that resource.
+template <typename T>
+class PolyAllocator {
+	MemoryResource* res;
+
+	template <typename U>
+	friend class PolyAllocator;
+
+public:
+	using value_type = T;
+
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	PolyAllocator()
+		: res(new_delete_resource()) {}
+
+	PolyAllocator(MemoryResource* res)
+		: res(res) {}
+
+	template <typename U>
+	PolyAllocator(const PolyAllocator<U>& other)
+		: res(other.res) {}
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(res->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		res->deallocate(p, n * sizeof(T), alignof(T));
+	}
+
+	MemoryResource* resource() const {
+		return res;
+	}
+
+	template <typename U>
+	bool operator== (const PolyAllocator<U>& other) const {
+		return res == other.res;
+	}
+
+	template <typename U>
+	bool operator!= (const PolyAllocator<U>& other) const {
+		return res != other.res;
+	}
+};
+
+
+template <typename T>
+using PolyVector = std::vector<T, PolyAllocator<T>>;
+
+using PolyString = std::basic_string<char, std::char_traits<char>, PolyAllocator<char>>;
+
+
+// Moves the storage that a parsed value allocated from a resource to res (see
+// ArgState::move_results_to). Only PolyString values own such storage
+template <typename T>
+void rebind_value(T&, MemoryResource*) {
+}
+
+inline void rebind_value(PolyString& value, MemoryResource* res) {
+	PolyString copy(value.data(), value.size(), PolyAllocator<char>(res));
+	value.swap(copy);
+}
+
+template <std::size_t I, typename... Ts>
+typename std::enable_if<I == sizeof...(Ts)>::type
+rebind_tuple(std::tuple<Ts...>&, MemoryResource*) {
+}
+
+template <std::size_t I, typename... Ts>
+typename std::enable_if<I < sizeof...(Ts)>::type
+rebind_tuple(std::tuple<Ts...>& value, MemoryResource* res) {
+	rebind_value(std::get<I>(value), res);
+	rebind_tuple<I+1>(value, res);
+}
+
+template <typename... Ts>
+void rebind_value(std::tuple<Ts...>& value, MemoryResource* res) {
+	rebind_tuple<0>(value, res);
+}
+
+}
+
+#endif
+
+
+namespace args {
+
+struct BaseArg;
+
+// The arguments matched during a parse, in order. Every distinct argument gets
+// a 16-bit id when it's first matched (so ids are ordered by first match, and
+// at most 65535 distinct arguments can be logged: matching one more aborts),
+// and consecutive matches of the same argument ("-v -v -v", runs of
+// positionals) are stored as a single run. The argv position of every match is only kept
+// when asked for (see keep_positions), and the runs can be dropped when only
+// the first matches are needed (see keep_runs).
+class MatchLog {
+public:
+	using id_type = std::uint16_t;
+
+	static constexpr uint no_pos = std::numeric_limits<uint>::max();
+
+	struct Run {
+		id_type id;
+		std::uint16_t count;
+	};
+
+	class const_iterator {
+		const MatchLog* log;
+		std::size_t run;
+		uint offset;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = const BaseArg*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = value_type;
+
+		const_iterator(const MatchLog* log, std::size_t run)
+			: log(log), run(run), offset(0) {}
+
+		const BaseArg* operator* () const {
+			return log->arg(log->runs[run].id);
+		}
+
+		const_iterator& operator++ () {
+			if (++offset == log->runs[run].count) {
+				run++;
+				offset = 0;
+			}
+
+			return *this;
+		}
+
+		const_iterator operator++ (int) {
+			auto old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator== (const const_iterator& other) const {
+			return run == other.run && offset == other.offset;
+		}
+
+		bool operator!= (const const_iterator& other) const {
+			return !(*this == other);
+		}
+	};
+
+
+	explicit MatchLog(MemoryResource* res = new_delete_resource())
+		: ids(res), runs(res), positions(res) {}
+
+	// whether to keep the argv position of every match (off by default)
+	void keep_positions(bool keep) {
+		positions_kept = keep;
+	}
+
+	bool keeps_positions() const {
+		return positions_kept;
+	}
+
+	// whether to keep the order of every match (on by default). Without the
+	// runs the log only grows with the number of distinct arguments: size,
+	// contains and first_before still work, but iteration and truncate don't
+	void keep_runs(bool keep) {
+		runs_kept = keep;
+	}
+
+	bool keeps_runs() const {
+		return runs_kept;
+	}
+
+	// pos is the argv position of the match, no_pos if it's not from argv
+	void add(const BaseArg& arg, uint pos = no_pos) {
+		if (!runs_kept)
+			intern(arg);
+		else if (!runs.empty() && ids[runs.back().id] == &arg
+				&& runs.back().count != std::numeric_limits<std::uint16_t>::max())
+			runs.back().count++;
+		else
+			add_run(intern(arg), 1);
+
+		if (positions_kept)
+			positions.push_back(pos);
+
+		match_count++;
+	}
+
+	// appends the matches of other, whose positions are offset by pos_offset
+	void append(const MatchLog& other, uint pos_offset = 0);
+
+	void clear();
+
+	// forgets every match after the first count
+	void truncate(std::size_t count);
+
+
+	// number of matches
+	std::size_t size() const {
+		return match_count;
+	}
+
+	bool empty() const {
+		return match_count == 0;
+	}
+
+	// whether arg has been matched
+	bool contains(const BaseArg& arg) const {
+		return find(arg) != no_id;
+	}
+
+	// whether a has first been matched before b. false if a has not been
+	// matched, true if only a has been matched
+	bool first_before(const BaseArg& a, const BaseArg& b) const {
+		id_type id_a = find(a);
+		return id_a != no_id && id_a < find(b);
+	}
+
+	// the id of arg, no_id if it has not been matched
+	id_type find(const BaseArg& arg) const;
+
+	const BaseArg* arg(id_type id) const {
+		return ids[id];
+	}
+
+	// the distinct matched arguments, indexed by id
+	const PolyVector<const BaseArg*>& args() const {
+		return ids;
+	}
+
+	const PolyVector<Run>& run_list() const {
+		return runs;
+	}
+
+	// argv position of the i-th match, no_pos if positions aren't kept
+	uint position(std::size_t i) const {
+		return i < positions.size() ? positions[i] : no_pos;
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, runs.size());
+	}
+
+	static constexpr id_type no_id = std::numeric_limits<id_type>::max();
+
+private:
+	PolyVector<const BaseArg*> ids;
+	PolyVector<Run> runs;
+	PolyVector<uint> positions;
+
+	std::size_t match_count = 0;
+	bool positions_kept = false;
+	bool runs_kept = true;
+
+	id_type intern(const BaseArg& arg);
+
+	void add_run(id_type id, uint count);
+};
+
+}
+
+#endif
+
+
+
+namespace args {
+
+struct BaseArg;
+
+using Argv = PolyVector<StrView>;
+
+
+template <typename Container>
+bool bounds_check(int pos, const Container& cont) {
+	return pos < static_cast<int>(cont.size());
+}
+
+
+// What an argv token looks like, computed once per argv by OwnedParserState
+// so that parsers don't have to look at the strings of tokens they can't match
+enum class TokenClass : unsigned char {
+	Positional,      // doesn't start with '-' (or is empty)
+	Dash,            // "-"
+	EndOfFlags,      // "--"
+	ShortoptCluster, // "-abc"
+	Longopt,         // "--name"
+	LongoptValue     // "--name=value"
+};
+
+inline TokenClass classify_token(const StrView& token) {
+	if (token.size() < 2 || token[0] != '-')
+		return token.size() == 1 && token[0] == '-'
+			? TokenClass::Dash
+			: TokenClass::Positional;
+
+	if (token[1] != '-')
+		return TokenClass::ShortoptCluster;
+
+	if (token.size() == 2)
+		return TokenClass::EndOfFlags;
+
+	return std::memchr(token.c_str() + 2, '=', token.size() - 2)
+		? TokenClass::LongoptValue
+		: TokenClass::Longopt;
+}
+
+// the name of a longopt token, i.e. "--name" for "--name=value"
+inline StrView longopt_name(const StrView& token) {
+	auto eq = static_cast<const char*>(std::memchr(token.c_str(), '=', token.size()));
+
+	return eq ? token.substr(0, eq - token.c_str()) : token;
+}
+
+
+struct ParserState {
+	uint pos = 0;
+	uint str_off = 0;
+
+	// "--" has been found, so everything else is a positional argument
+	bool end_of_flags = false;
+
+	const MatchLog& matched_args;
+	const Argv& argv;
+
+	// where parsers allocate the values they own (see ParamParser<PolyString>)
+	MemoryResource* resource = new_delete_resource();
+
+	// multiplicities indexed by BaseArg::id when the results are stored out of
+	// the arguments (see Schema), null when they are stored in the arguments
+	const uint* counts = nullptr;
+	uint count_size = 0;
+
+	// class of every token of argv, null to classify them when needed
+	const TokenClass* classes = nullptr;
+
+	// longopt that the current token abbreviates (see FlagParser), empty if
+	// it must be matched exactly
+	StrView longopt_match;
+
+	ParserState(const MatchLog& matched_args, const Argv& argv);
+
+	ParserState(const ParserState&) = default;
+
+
+	bool bounds_check() const;
+
+	bool offset_check() const;
+
+	const StrView& arg() const;
+
+	const StrView& arg_next();
+
+	// the next parameter of a flag: the rest of the current token if it's
+	// attached to the flag ("-j8", "--jobs=8"), otherwise the next token
+	StrView param_next();
+
+	char ch() const;
+
+	// class of the current token
+	TokenClass token_class() const;
+
+	// how many times arg has been parsed so far. conditions must use this
+	// instead of BaseArg::multiplicity so that they work with a Schema
+	uint multiplicity(const BaseArg& arg) const;
+
+	void update(ParserState& clone);
+};
+
+
+// the accessors are used for every token by the parse loop, they are defined
+// here so that they can be inlined into it
+
+inline bool ParserState::bounds_check() const {
+	return ::args::bounds_check(pos, argv);
+}
+
+inline bool ParserState::offset_check() const {
+	return ::args::bounds_check(str_off, arg());
+}
+
+inline const StrView& ParserState::arg() const {
+	return argv[pos];
+}
+
+inline const StrView& ParserState::arg_next() {
+	auto& a = arg();
+	pos++;
+	return a;
+}
+
+inline StrView ParserState::param_next() {
+	if (str_off == 0)
+		return arg_next();
+
+	auto param = arg().substr(str_off);
+
+	pos++;
+	str_off = 0;
+
+	return param;
+}
+
+inline char ParserState::ch() const {
+	return arg()[str_off];
+}
+
+inline TokenClass ParserState::token_class() const {
+	return classes ? classes[pos] : classify_token(arg());
+}
+
+inline void ParserState::update(ParserState& clone) {
+	pos = clone.pos;
+	str_off = clone.str_off;
+	longopt_match = StrView();
+}
+
+
+// Owns argv, the matched arguments and the token classes, allocated from
+// res (see MemoryResource), which must outlive the state
+struct OwnedParserState : public ParserState {
+	MatchLog owned_matched_args;
+
+	// position of the first "--" in argv, or argv.size()
+	uint end_of_flags_pos = 0;
+
+	explicit OwnedParserState(MemoryResource* res = new_delete_resource())
+		: ParserState(owned_matched_args, owned_argv)
+		, owned_matched_args(res)
+		, owned_argv(res)
+		, owned_classes(res) {
+
+		resource = res;
+	}
+
+	template <typename InputIt>
+	OwnedParserState(InputIt argv_begin, InputIt argv_end,
+			MemoryResource* res = new_delete_resource())
+		: ParserState(owned_matched_args, owned_argv)
+		, owned_matched_args(res)
+		, owned_argv(argv_begin, argv_end, res)
+		, owned_classes(res) {
+
+		resource = res;
+		classify();
+	}
+
+	OwnedParserState(OwnedParserState&& other)
+		: ParserState(owned_matched_args, owned_argv)
+		, owned_matched_args(std::move(other.owned_matched_args))
+		, end_of_flags_pos(other.end_of_flags_pos)
+		, owned_argv(std::move(other.owned_argv))
+		, owned_classes(std::move(other.owned_classes)) {
+
+		resource = other.resource;
+		pos = other.pos;
+		str_off = other.str_off;
+		end_of_flags = other.end_of_flags;
+		counts = other.counts;
+		count_size = other.count_size;
+		classes = other.classes ? owned_classes.data() : nullptr;
+	}
+
+	OwnedParserState(const OwnedParserState&) = delete;
+	OwnedParserState& operator= (const OwnedParserState&) = delete;
+
+	// starts over with a new argv, reusing the storage of the previous one
+	template <typename InputIt>
+	void assign(InputIt argv_begin, InputIt argv_end) {
+		owned_argv.assign(argv_begin, argv_end);
+		owned_matched_args.clear();
+
+		pos = 0;
+		str_off = 0;
+		end_of_flags = false;
+
+		classify();
+	}
+
+	// starts over with the words of a shell command line (see split_shell),
+	// reusing the storage of the previous argv. The unescaped words are stored
+	// in buffer, which must outlive the parse. Returns false if command has an
+	// unterminated quote
+	bool assign_command(StrView command, std::string& buffer);
+
+	// replaces argv with the words of command like assign_command, but keeps
+	// the position and the matched arguments, for when only the tokens after
+	// the position have changed (see IncrementalSession)
+	bool replace_command(StrView command, std::string& buffer,
+			std::vector<std::size_t>* word_ends = nullptr);
+
+	// goes back to token pos, forgetting every match after the first
+	// match_count
+	void rewind(uint pos, bool end_of_flags, std::size_t match_count);
+
+private:
+	Argv owned_argv;
+	PolyVector<TokenClass> owned_classes;
+
+	// classifies every token of argv and finds the first "--"
+	void classify();
+};
+
+
+}
+
+#endif
+
+
+namespace args {
+
+struct BaseArg;
+struct ParserState;
+
+struct Nothing {};
+
+struct BaseArgError {
+	const BaseArg* arg = nullptr;
+
+	BaseArgError() = default;
+
+	explicit BaseArgError(const BaseArg* arg) : arg(arg) {}
+};
+
+
+struct UnknownArg {
+	StrView argv_element;
+	uint str_off;
+
+	// closest known name (see NameSuggester), empty if there is none
+	StrView suggestion;
+
+	explicit UnknownArg(const ParserState& state)
+		: argv_element(state.arg())
+		, str_off(state.str_off) {}
+
+	UnknownArg(const UnknownArg&) = default;
+	UnknownArg& operator= (const UnknownArg&) = default;
+};
+
+struct BoundError : public BaseArgError {
+	std::string method_name;
+
+	explicit BoundError(const char* method_name, const BaseArg* arg = nullptr)
+		: BaseArgError(arg)
+		, method_name(method_name) {}
+};
+
+struct InvalidParam : public BaseArgError {
+	std::string custom_msg;
+	StrView given;
+
+	InvalidParam(std::string custom_msg, StrView given, const BaseArg* arg = nullptr)
+		: BaseArgError(arg)
+		, custom_msg(std::move(custom_msg))
+		, given(given) {}
+};
+
+struct InvalidShortoptList : public BaseArgError {
+	StrView shortopt_list;
+
+	explicit InvalidShortoptList(
+			const StrView& shortopt_list,
+			const BaseArg* arg = nullptr)
+		: BaseArgError(arg)
+		, shortopt_list(std::move(shortopt_list)) {}
+};
+
+// The message of a failed condition is only built by message(), so that a
+// failing precondition (which just skips an argument) doesn't allocate.
+// Conditions give either a custom error_msg, or the name of the condition and
+// the argument or number it refers to.
+struct CondFailed : public BaseArgError {
+	std::string error_msg;
+
+	const char* condition = nullptr;
+	const BaseArg* other = nullptr;
+	uint number = 0;
+	bool has_number = false;
+
+	CondFailed(std::string error_msg, const BaseArg* arg = nullptr)
+		: BaseArgError(arg)
+		, error_msg(std::move(error_msg)) {}
+
+	static CondFailed lazy(const char* condition, const BaseArg* other) {
+		CondFailed e("");
+		e.condition = condition;
+		e.other = other;
+		return e;
+	}
+
+	static CondFailed lazy(const char* condition, uint number) {
+		CondFailed e("");
+		e.condition = condition;
+		e.number = number;
+		e.has_number = true;
+		return e;
+	}
+
+	// e.g. "Requires -f, --flag" or "Min 1"
+	std::string message() const;
+};
+
+
+template <typename... Ts>
+struct GenericParseError {
+	using Vec = boost::mpl::vector<Ts...>;
+	using Var = boost::variant<Ts...>;
+
+	static constexpr std::size_t type_count = sizeof...(Ts);
+
+	Var data;
+
+	GenericParseError(boost::variant<Ts...> data)
+		: data(std::move(data)) {}
+
+
+	template <std::size_t I>
+	using at = typename boost::mpl::at_c<Vec, I>::type;
+
+	template <typename T>
+	static constexpr std::size_t index_of() {
+		using namespace boost::mpl;
+
+		using vec_begin = typename begin<Vec>::type;
+		using vec_found = typename find<Vec, T>::type;
+		using vec_end   = typename end<Vec>::type;
+
+		static_assert(
+			!std::is_same<vec_found, vec_end>::value,
+			"Type is not part of ParseError");
+
+		return distance<vec_begin, vec_found>::type::value;
+	}
+
+	template <typename T>
+	const T& get() const {
+		return boost::get<T>(data);
+	}
+
+	template <typename T>
+	T& get() {
+		return boost::get<T>(data);
+	}
+
+	void set_arg(const BaseArg* arg) {
+		set_arg_iter<0>(arg);
+	}
+
+	template <std::size_t I, typename T = void>
+	typename std::enable_if<I == sizeof...(Ts)>::type
+	set_arg_iter(const BaseArg*) {
+	}
+
+	template <std::size_t I>
+	typename std::enable_if<I < sizeof...(Ts)>::type
+	set_arg_iter(const BaseArg* arg) {
+		constexpr bool is_base = std::is_base_of<BaseArgError, at<I>>::value;
+
+		if (data.which() == I && is_base)
+			reinterpret_cast<BaseArgError&>(get<at<I>>()).arg = arg;
+		else
+			set_arg_iter<I+1>(arg);
+	}
+};
+
+template <typename T, typename... Ts>
+static bool is(const GenericParseError<Ts...>& e) {
+	return e.data.which() == GenericParseError<Ts...>::template index_of<T>();
+}
+
+
+struct ParseError
+	: public GenericParseError<
+		Nothing,
+		UnknownArg,
+		BoundError,
+		InvalidParam,
+		InvalidShortoptList,
+		CondFailed
+	> {
+
+	using GenericParseError::GenericParseError;
+
+
+	bool is_ok() const {
+		return is<Nothing>(*this);
+	}
+};
+
+template <typename T>
+using ParseResult = Result<T, ParseError>;
+
+using ParseResultVoid = ParseError;
+
+inline ParseResultVoid success() {
+	return ParseError(Nothing());
+}
+
+}
+
+#endif
+
+
+namespace args {
+
+#ifndef INT_MAX
+constexpr std::size_t INT_MAX = std::numeric_limits<int>::max();
+#endif
+
+using uint = unsigned int;
+
+using Str = std::string;
+
+template <bool cond, typename Ret = ParseResultVoid>
+using If = typename std::enable_if<cond, Ret>::type;
+
+
+// compile-time list of tuple indices, BuildIndices<N> is Indices<0, ..., N-1>
+template <std::size_t... Is>
+struct Indices {};
+
+template <std::size_t N, std::size_t... Is>
+struct BuildIndices : BuildIndices<N-1, N-1, Is...> {};
+
+template <std::size_t... Is>
+struct BuildIndices<0, Is...> : Indices<Is...> {};
+
+
+// calls f(a_i, b_i) for the elements of two tuples of the same size
+template <typename F, typename TupleA, typename TupleB, std::size_t... Is>
+void zip_each(F& f, TupleA& a, TupleB& b, Indices<Is...>) {
+	int expand[] = { 0, (f(std::get<Is>(a), std::get<Is>(b)), 0)... };
+	(void) expand;
+}
+
+// same as zip_each for tuples of tuples (one tuple per parser)
+template <typename F>
+struct ZipInner {
+	F& f;
+
+	template <typename TupleA, typename TupleB>
+	void operator() (TupleA& a, TupleB& b) {
+		zip_each(f, a, b, BuildIndices<std::tuple_size<TupleA>::value>());
+	}
+};
+
+template <typename F, typename TupleA, typename TupleB>
+void zip_nested(F& f, TupleA& a, TupleB& b) {
+	ZipInner<F> inner { f };
+	zip_each(inner, a, b, BuildIndices<std::tuple_size<TupleA>::value>());
+}
+
+
+// where the values of an argument come from, by increasing precedence
+enum class Origin : unsigned char {
+	None, Default, File, Env, Argv
+};
+
+
+struct BaseArg {
+	static constexpr uint no_id = std::numeric_limits<uint>::max();
+
+	uint multiplicity = 0;
+	Origin origin = Origin::None;
+
+	// position in the Schema that contains the argument (or in the parsers of
+	// its parse with ARGS_INSTRUMENT, see number_args)
+	uint id = no_id;
+
+	explicit operator bool() const {
+		return multiplicity > 0;
+	}
+
+	virtual Str to_str() const = 0;
+};
+
+}
+
+#endif
+
+#ifndef ARGS_ARG_H
+#define ARGS_ARG_H
+
+
+#ifndef ARGS_CONDITION_H
+#define ARGS_CONDITION_H
+
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+
+
+
+#ifndef ARGS_DISPLAY_ERROR_H
+#define ARGS_DISPLAY_ERROR_H
+
+#include <iosfwd>
+#include <sstream>
+#include <string>
+
+
+namespace args {
+	struct ParseError;
+
+	void report_error(const ParseError& err, std::ostream& o);
+}
+
+std::ostream& operator<< (std::ostream& o, const args::ParseError& e);
+
+namespace std {
+string to_string(const args::ParseError& e);
+}
+
+#endif
+
+
+namespace args {
+
+namespace condition {
+
+inline ParseResultVoid cond_fail(Str error_msg) {
+	return ParseError(CondFailed(std::move(error_msg)));
+}
+
+// failures whose message is only built when reported (see CondFailed)
+inline ParseResultVoid cond_fail(const char* condition, const BaseArg* other = nullptr) {
+	return ParseError(CondFailed::lazy(condition, other));
+}
+
+inline ParseResultVoid cond_fail(const char* condition, uint number) {
+	return ParseError(CondFailed::lazy(condition, number));
+}
+
+
+struct True {
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const {
+		return success();
+	}
+};
+
+struct False {
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const {
+		return cond_fail("False");
+	}
+};
+
+
+template <typename... Predicates>
+struct All {
+	std::tuple<Predicates...> predicates;
+
+	static constexpr std::size_t N = sizeof...(Predicates);
+
+
+	explicit All(Predicates... predicates) : predicates(std::move(predicates)...) {}
+
+	template <typename Self>
+	ParseResultVoid operator() (const Self& self, const ParserState& s) const {
+		return eval_iter<Self, 0>(self, s);
+	}
+
+
+	template <typename Self, std::size_t I>
+	If<I == N> eval_iter(const Self& self, const ParserState& s) const {
+		return success();
+	}
+
+	template <typename Self, std::size_t I>
+	If<I < N> eval_iter(const Self& self, const ParserState& s) const {
+		auto res = std::get<I>(predicates)(self, s);
+
+		if (res.is_ok())
+			return eval_iter<Self, I+1>(self, s);
+		else
+			return res;
+	}
+};
+
+
+template <typename... Predicates>
+struct Any {
+	std::tuple<Predicates...> predicates;
+
+	static constexpr std::size_t N = sizeof...(Predicates);
+
+
+	explicit Any(Predicates... predicates) : predicates(std::move(predicates)...) {}
+
+	template <typename Self>
+	ParseResultVoid operator() (const Self& self, const ParserState& s) const {
+		std::vector<ParseError> errors;
+		return eval_iter<Self, 0>(self, s, errors);
+	}
+
+
+	template <typename Self, std::size_t I>
+	If<I == N> eval_iter(const Self& self, const ParserState& s,
+			std::vector<ParseError>& errors) const {
+
+		std::ostringstream ss;
+		ss << "Failed all conditions on " << self.to_str() << ":\n";
+
+		for (const auto& e : errors)
+			ss << e;
+
+		return cond_fail(ss.str());
+	}
+
+	template <typename Self, std::size_t I>
+	If<I < N> eval_iter(const Self& self, const ParserState& s,
+			std::vector<ParseError>& errors) const {
+
+		auto res = std::get<I>(predicates)(self, s);
+
+		if (res.is_ok()) {
+			return success();
+		}
+		else {
+			errors.emplace_back(std::move(res));
+			return eval_iter<Self, I+1>(self, s, errors);
+		}
+	}
+};
+
+
+struct Requires {
+	const BaseArg& to_find;
+
+	explicit Requires(const BaseArg& to_find) : to_find(to_find) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+struct Conflicts {
+	const BaseArg& to_find;
+
+	explicit Conflicts(const BaseArg& to_find) : to_find(to_find) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+
+struct Before {
+	const BaseArg& to_find;
+
+	explicit Before(const BaseArg& to_find) : to_find(to_find) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+struct After {
+	const BaseArg& to_find;
+
+	explicit After(const BaseArg& to_find) : to_find(to_find) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+struct Min {
+	uint min_multiplicity;
+
+	explicit Min(uint min_multiplicity) : min_multiplicity(min_multiplicity) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+struct Max {
+	uint max_multiplicity;
+
+	explicit Max(uint max_multiplicity) : max_multiplicity(max_multiplicity) {}
+
+	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const;
+};
+
+
+
+// Whether a condition gives the same result wherever it's evaluated, i.e. it
+// doesn't depend on the arguments parsed so far. If all preconditions are
+// stateless, parts of argv can be parsed independently (see Schema::parse)
+template <typename Cond>
+struct is_stateless : std::false_type {};
+
+template <>
+struct is_stateless<True> : std::true_type {};
+
+template <>
+struct is_stateless<False> : std::true_type {};
+
+template <>
+struct is_stateless<All<>> : std::true_type {};
+
+template <typename P, typename... Ps>
+struct is_stateless<All<P, Ps...>> : std::integral_constant<bool,
+	is_stateless<P>::value && is_stateless<All<Ps...>>::value> {};
+
+template <typename... Ps>
+struct is_stateless<Any<Ps...>> : is_stateless<All<Ps...>> {};
+
+
+
+// Constructor wrappers
+
+template <typename... Predicates>
+All<Predicates...> all(Predicates... predicates) {
+	return All<Predicates...>(std::move(predicates)...);
+}
+
+template <typename... Predicates>
+Any<Predicates...> any(Predicates... predicates) {
+	return Any<Predicates...>(std::move(predicates)...);
+}
+
+
+inline Requires requires(const BaseArg& to_find) {
+	return Requires(to_find);
+}
+
+inline Conflicts conficts(const BaseArg& to_find) {
+	return Conflicts(to_find);
+}
+
+
+inline Before before(const BaseArg& to_find) {
+	return Before(to_find);
+}
+
+inline After after(const BaseArg& to_find) {
+	return After(to_find);
+}
+
+
+inline Min min(uint min_multiplicity) {
+	return Min(min_multiplicity);
+}
+
+inline Max max(uint max_multiplicity) {
+	return Max(max_multiplicity);
+}
+
+inline All<Min,Max> between(uint min_multiplicity, uint max_multiplicity) {
+	return all(min(min_multiplicity), max(max_multiplicity));
+}
+
+inline All<Min,Max> exactly(uint multiplicity) {
+	return between(multiplicity, multiplicity);
+}
+
+}
+
+}
+
+
+#endif
+
+
+#ifndef ARGS_INSTRUMENT_H
+#define ARGS_INSTRUMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+
+// Parse instrumentation. The counters, timers and histograms below are always
+// available, but the library only records into them when ARGS_INSTRUMENT is
+// defined (for the whole program, including libargs), otherwise the
+// instrumentation points compile to nothing.
+
+namespace args {
+namespace instrument {
+
+// cycle counter used by the timers (the TSC on x86, nanoseconds elsewhere)
+inline std::uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+enum class Phase : unsigned {
+	Parse,    // a whole parse, from argv to the last postcondition
+	Match,    // preconditions and parse_impl of the arguments tried
+	Params,   // ParamParsers of the flags that matched
+	Postcond, // postconditions
+	Count
+};
+
+
+// Histogram of positive values with a relative precision of 1/16: values
+// below 32 have their own bucket, the others fall in one of 16 buckets per
+// power of two (like HdrHistogram with 1 significant digit in base 2).
+// Recording is a single relaxed atomic increment.
+class LatencyHistogram {
+public:
+	static constexpr std::size_t sub_buckets = 16;
+	static constexpr std::size_t bucket_count = 61 * sub_buckets;
+
+	static std::size_t index(std::uint64_t value);
+
+	// smallest value that falls in bucket i
+	static std::uint64_t lower_bound(std::size_t i);
+
+	void record(std::uint64_t value) {
+		buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::uint64_t count() const;
+
+	// lower bound of the bucket of the p-th percentile (p in [0, 100])
+	std::uint64_t percentile(double p) const;
+
+	void reset();
+
+private:
+	std::atomic<std::uint64_t> buckets[bucket_count] = {};
+};
+
+
+// cost of one argument, attributed by BaseArg::id (given by a Schema, or by
+// ARGS_NUMBER_ARGS to the arguments of the other parses)
+struct ArgCost {
+	std::atomic<std::uint64_t> attempts { 0 };
+	std::atomic<std::uint64_t> matches { 0 };
+	std::atomic<std::uint64_t> cycles { 0 };
+};
+
+struct ParseStats {
+	// arguments with an id >= this share the last ArgCost
+	static constexpr std::size_t max_args = 256;
+
+	std::atomic<std::uint64_t> parses { 0 };
+	std::atomic<std::uint64_t> match_attempts { 0 };
+	std::atomic<std::uint64_t> precond_evals { 0 };
+	std::atomic<std::uint64_t> state_clones { 0 };
+	std::atomic<std::uint64_t> param_parses { 0 };
+	std::atomic<std::uint64_t> keyword_lookups { 0 };
+	std::atomic<std::uint64_t> postcond_evals { 0 };
+
+	// result vectors that had to grow to store a value
+	std::atomic<std::uint64_t> result_allocations { 0 };
+
+	std::atomic<std::uint64_t> phase_cycles[static_cast<unsigned>(Phase::Count)] = {};
+
+	ArgCost args[max_args];
+
+	// cycles per parse
+	LatencyHistogram parse_latency;
+
+
+	ArgCost& arg(std::size_t id) {
+		return args[id < max_args ? id : max_args - 1];
+	}
+
+	void reset();
+
+	// writes every non-zero statistic as "name value" lines
+	void print(std::ostream& o) const;
+};
+
+// the process-wide statistics
+ParseStats& stats();
+
+
+inline void count(std::atomic<std::uint64_t>& counter) {
+	counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// adds the cycles spent in its scope to a phase
+class PhaseTimer {
+	Phase phase;
+	std::uint64_t start;
+
+public:
+	explicit PhaseTimer(Phase phase)
+		: phase(phase)
+		, start(cycles()) {}
+
+	~PhaseTimer() {
+		stats().phase_cycles[static_cast<unsigned>(phase)]
+			.fetch_add(cycles() - start, std::memory_order_relaxed);
+	}
+};
+
+// times a whole parse: its phase, the latency histogram and the parse count
+class ParseTimer {
+	std::uint64_t start;
+
+public:
+	ParseTimer()
+		: start(cycles()) {}
+
+	~ParseTimer() {
+		auto& s = stats();
+		std::uint64_t elapsed = cycles() - start;
+
+		count(s.parses);
+		s.phase_cycles[static_cast<unsigned>(Phase::Parse)]
+			.fetch_add(elapsed, std::memory_order_relaxed);
+		s.parse_latency.record(elapsed);
+	}
+};
+
+// attributes the cycles spent in its scope to an argument
+class ArgTimer {
+	ArgCost& cost;
+	std::uint64_t start;
+
+public:
+	explicit ArgTimer(std::size_t id)
+		: cost(stats().arg(id))
+		, start(cycles()) {
+
+		count(cost.attempts);
+	}
+
+	~ArgTimer() {
+		cost.cycles.fetch_add(cycles() - start, std::memory_order_relaxed);
+	}
+};
+
+}
+}
+
+
+#ifdef ARGS_INSTRUMENT
+
+#define ARGS_COUNT(counter) \
+	::args::instrument::count(::args::instrument::stats().counter)
+
+#define ARGS_COUNT_IF(cond, counter) \
+	do { if (cond) ARGS_COUNT(counter); } while (0)
+
+#define ARGS_TIME_PHASE(phase) \
+	::args::instrument::PhaseTimer args_phase_timer(::args::instrument::Phase::phase)
+
+#define ARGS_TIME_PARSE() \
+	::args::instrument::ParseTimer args_parse_timer
+
+#define ARGS_TIME_ARG(id) \
+	::args::instrument::ArgTimer args_arg_timer(id)
+
+#define ARGS_COUNT_ARG_MATCH(id) \
+	::args::instrument::count(::args::instrument::stats().arg(id).matches)
+
+#define ARGS_NUMBER_ARGS(...) \
+	::args::number_args(__VA_ARGS__)
+
+#else
+
+#define ARGS_COUNT(counter) ((void) 0)
+#define ARGS_COUNT_IF(cond, counter) ((void) 0)
+#define ARGS_TIME_PHASE(phase) ((void) 0)
+#define ARGS_TIME_PARSE() ((void) 0)
+#define ARGS_TIME_ARG(id) ((void) 0)
+#define ARGS_COUNT_ARG_MATCH(id) ((void) 0)
+#define ARGS_NUMBER_ARGS(...) ((void) 0)
+
+#endif
+
+#endif
+
+#ifndef ARGS_NAME_TABLE_H
+#define ARGS_NAME_TABLE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+
+namespace args {
+
+// Sorted set of the names that select arguments on the command line (longopts,
+// keywords), used to resolve abbreviations and to complete partial tokens.
+// The table only holds views: the names must outlive it.
+class NameTable {
+	std::vector<StrView> names;
+
+public:
+	using const_iterator = std::vector<StrView>::const_iterator;
+
+	void add(StrView name);
+
+	// sorts the names and removes duplicates, must be called after adding
+	void sort();
+
+	std::size_t size() const {
+		return names.size();
+	}
+
+	const_iterator begin() const {
+		return names.begin();
+	}
+
+	const_iterator end() const {
+		return names.end();
+	}
+
+	// the names starting with prefix, in order
+	std::pair<const_iterator, const_iterator> prefix_range(StrView prefix) const;
+
+	// the name equal to prefix, or else the only name starting with it. empty
+	// if there is none or prefix is ambiguous
+	StrView resolve(StrView prefix) const;
+};
+
+
+// Finds the name closest to a token (e.g. an unknown argument) in one or more
+// NameTables, using Myers' bit-parallel edit distance: the token is encoded
+// once, then every name costs one pass of a few word operations per
+// character, without allocating. Names further than max(1, size/3) edits
+// away are not suggested, nor are any for tokens longer than 64 characters.
+class NameSuggester {
+	std::uint64_t char_masks[256];
+	std::size_t token_size;
+
+	std::size_t best_distance;
+	StrView best;
+
+	std::size_t distance(StrView name, std::size_t bound) const;
+
+public:
+	explicit NameSuggester(StrView token);
+
+	void add(const NameTable& names);
+
+	// the closest name, empty if none is close enough
+	StrView suggestion() const {
+		return best;
+	}
+};
+
+}
+
+#endif
+
+
+namespace args {
+
+template <typename T>
+struct ArgState : public BaseArg {
+	using value_type = T;
+
+	PolyVector<T> result;
+
+	// forgets the results of the previous parse, keeping the storage
+	void reset() {
+		result.clear();
+		multiplicity = 0;
+		origin = Origin::None;
+	}
+
+	// forgets the results of the previous parse, and allocates the next ones
+	// from res. The storage is freed through res, so before res is destroyed
+	// the results must be moved out of it (see move_results_to) or dropped by
+	// calling this with another resource
+	void use_resource(MemoryResource* res) {
+		result = PolyVector<T>(res);
+		multiplicity = 0;
+		origin = Origin::None;
+	}
+
+	// moves the results (and the strings they allocated) to storage from res,
+	// keeping them
+	void move_results_to(MemoryResource* res) {
+		PolyVector<T> moved { PolyAllocator<T>(res) };
+		moved.reserve(result.size());
+
+		for (auto& value : result) {
+			moved.push_back(std::move(value));
+			rebind_value(moved.back(), res);
+		}
+
+		result = std::move(moved);
+	}
+};
+
+template <typename T, typename PreCond, typename PostCond, typename Derived>
+struct Arg : public ArgState<T> {
+	using precond_type = PreCond;
+
+	// number of tokens a value from a source (see parse_with) is split into
+	static constexpr std::size_t value_arity = 1;
+
+	// whether parse_impl consumes a single token when it doesn't start with '-',
+	// and at most 1 + value_arity tokens otherwise
+	static constexpr bool bounded_tokens = true;
+
+	PreCond precond;
+	PostCond postcond;
+	StrView doc_description;
+
+	// name used to look up the argument in sources other than argv,
+	// empty if it can only be given in argv
+	Str source_key;
+
+	Arg(PreCond precond, PostCond postcond)
+		: ArgState<T>()
+		, precond(std::move(precond))
+		, postcond(std::move(postcond)) {}
+
+	ParseResultVoid parse(ParserState& s) {
+		return store(derived().parse_impl(s));
+	}
+
+	// parses a value given by a source, where s only contains the value tokens
+	ParseResultVoid parse_value(ParserState& s) {
+		return store(derived().parse_value_impl(s));
+	}
+
+	ParseResult<T> parse_value_impl(ParserState& s) const {
+		return derived().parse_impl(s);
+	}
+
+	// adds the names that select the argument on the command line (e.g. its
+	// longopt), which the parsers use for abbreviations and completion
+	void collect_names(NameTable&) const {
+	}
+
+	Derived& description(StrView desc) & {
+		this->doc_description = desc;
+		return derived();
+	}
+
+	Derived&& description(StrView desc) && {
+		this->doc_description = desc;
+		return std::move(derived());
+	}
+
+	Derived& key(Str key) & {
+		this->source_key = std::move(key);
+		return derived();
+	}
+
+	Derived&& key(Str key) && {
+		this->source_key = std::move(key);
+		return std::move(derived());
+	}
+
+private:
+	ParseResultVoid store(ParseResult<T>&& parsed) {
+		auto res = success();
+
+		std::move(parsed)
+
+		.if_ok([&](T&& value) {
+			this->result.emplace_back(std::move(value));
+		})
+
+		.if_err([&](ParseError&& err) {
+			res = err;
+		});
+
+		return res;
+	}
+
+	Derived& derived() & {
+		return *static_cast<Derived*>(this);
+	}
+
+	const Derived& derived() const& {
+		return *static_cast<const Derived*>(this);
+	}
+
+	Derived&& derived() && {
+		return std::move(*static_cast<Derived*>(this));
+	}
+};
+
+
+// Stores parse results in the arguments themselves
+struct ArgSink {
+	template <std::size_t I, typename A, typename T>
+	void push(A& arg, T&& value) {
+		ARGS_COUNT_IF(arg.result.size() == arg.result.capacity(), result_allocations);
+
+		arg.result.emplace_back(std::forward<T>(value));
+		arg.multiplicity++;
+		arg.origin = Origin::Argv;
+	}
+};
+
+
+// Whether argv can be split into chunks that are parsed independently by a
+// set of arguments, and how many tokens after the first one an argument may
+// consume (see Schema::parse)
+template <typename... ArgTs>
+struct ChunkTraits {
+	static constexpr bool chunkable = true;
+	static constexpr std::size_t max_arity = 0;
+};
+
+template <typename A, typename... ArgTs>
+struct ChunkTraits<A, ArgTs...> {
+	using Rest = ChunkTraits<ArgTs...>;
+
+	static constexpr bool chunkable = A::bounded_tokens
+		&& condition::is_stateless<typename A::precond_type>::value
+		&& Rest::chunkable;
+
+	static constexpr std::size_t max_arity =
+		A::value_arity > Rest::max_arity ? A::value_arity : Rest::max_arity;
+};
+
+
+template <typename... ArgTs>
+struct ArgParser {
+	static constexpr std::size_t N = sizeof...(ArgTs);
+
+	using Chunking = ChunkTraits<ArgTs...>;
+
+	// one Slot<T> per argument, where T is its value_type
+	template <template <typename> class Slot>
+	using Slots = std::tuple<Slot<typename ArgTs::value_type>...>;
+
+	template <typename T>
+	using Vector = std::vector<T>;
+
+	// makes every argument allocate its results from res
+	struct ResourceSetter {
+		MemoryResource* res;
+
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.use_resource(res);
+		}
+	};
+
+	// moves the results of every argument to res
+	struct ResultMover {
+		MemoryResource* res;
+
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.move_results_to(res);
+		}
+	};
+
+	// adds the names of every argument to a NameTable
+	struct NameCollector {
+		NameTable& names;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			arg.collect_names(names);
+		}
+	};
+
+	// results of every argument when they are stored out of the arguments
+	using Values = Slots<Vector>;
+
+	// Stores parse results in Values, and multiplicities in counts, which is
+	// indexed by BaseArg::id
+	struct ValueSink {
+		Values& values;
+		uint* counts;
+
+		template <std::size_t I, typename A, typename T>
+		void push(const A& arg, T&& value) {
+			auto& vec = std::get<I>(values);
+
+			ARGS_COUNT_IF(vec.size() == vec.capacity(), result_allocations);
+
+			vec.emplace_back(std::forward<T>(value));
+			counts[arg.id]++;
+		}
+	};
+
+private:
+
+	template <std::size_t I>
+	using ArgType = typename std::tuple_element<I, std::tuple<ArgTs...>>::type;
+
+	std::tuple<ArgTs&...> args;
+	NameTable name_table;
+
+
+	template <std::size_t I, typename Sink>
+	If<I == N> parse_iter(OwnedParserState& state, Sink&) const {
+		return ParseError(UnknownArg(state));
+	}
+
+	template <std::size_t I, typename Sink>
+	If<I < N> parse_iter(OwnedParserState& state, Sink& sink) const {
+		bool skipped = false;
+		auto res = parse_arg<I>(state, sink, skipped);
+
+		return skipped ? parse_iter<I+1>(state, sink) : res;
+	}
+
+	// tries the argument I. skipped is set if the next ones should be tried
+	template <std::size_t I, typename Sink>
+	ParseResultVoid parse_arg(OwnedParserState& state, Sink& sink, bool& skipped) const {
+		auto& arg = std::get<I>(args);
+
+		ARGS_TIME_ARG(arg.id);
+		ARGS_COUNT(state_clones);
+
+		auto state_clone = ParserState(state);
+
+		ARGS_COUNT(precond_evals);
+
+		const auto& c_arg = arg;
+		auto res = arg.precond(c_arg, state_clone);
+
+		if (!res.is_ok()) {
+			skipped = is<CondFailed>(res);
+			return res;
+		}
+
+		ARGS_COUNT(match_attempts);
+
+		auto parsed = arg.parse_impl(state_clone);
+
+		if (parsed.is_ok()) {
+			ARGS_COUNT_ARG_MATCH(arg.id);
+
+			sink.template push<I>(arg, std::move(parsed.get_ok()));
+			state.owned_matched_args.add(arg, state.pos);
+			state.update(state_clone);
+			return success();
+		}
+
+		res = std::move(parsed.get_err());
+
+		if (is<UnknownArg>(res)) {
+			skipped = true;
+		} else {
+			res.set_arg(&arg);
+		}
+
+		return res;
+	}
+
+
+	template <std::size_t I>
+	If<I == N, void> reset_iter() {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> reset_iter() {
+		std::get<I>(args).reset();
+		reset_iter<I+1>();
+	}
+
+
+	template <std::size_t I, typename F>
+	If<I == N, void> for_each_arg_iter(F&) const {
+	}
+
+	template <std::size_t I, typename F>
+	If<I < N, void> for_each_arg_iter(F& f) const {
+		f(std::get<I>(args));
+		for_each_arg_iter<I+1>(f);
+	}
+
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	If<I == N, const Slot<typename A::value_type>*>
+	find_slot_iter(const A&, const Slots<Slot>&) const {
+		return nullptr;
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	If<I < N, const Slot<typename A::value_type>*>
+	find_slot_iter(const A& arg, const Slots<Slot>& slots) const {
+		auto found = find_slot_at<Slot, I>(arg, slots, std::is_same<ArgType<I>, A>());
+
+		return found ? found : find_slot_iter<Slot, I+1>(arg, slots);
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	const Slot<typename A::value_type>*
+	find_slot_at(const A& arg, const Slots<Slot>& slots, std::true_type) const {
+		return &std::get<I>(args) == &arg ? &std::get<I>(slots) : nullptr;
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	const Slot<typename A::value_type>*
+	find_slot_at(const A&, const Slots<Slot>&, std::false_type) const {
+		return nullptr;
+	}
+
+
+	template <std::size_t I>
+	If<I == N> eval_postcond_iter(const ParserState& state) const {
+		return success();
+	}
+
+	template <std::size_t I>
+	If<I < N> eval_postcond_iter(const ParserState& s) const {
+		ARGS_COUNT(postcond_evals);
+
+		const auto& arg = std::get<I>(args);
+		auto res = arg.postcond(arg, s);
+
+		if (res.is_ok()) {
+			return eval_postcond_iter<I+1>(s);
+		} else {
+			res.set_arg(&arg);
+			return res;
+		}
+	}
+
+public:
+	const decltype(args)& const_args = args;
+
+
+	ArgParser(ArgTs&... args)
+		: args(std::tie(args...)) {
+
+		NameCollector collector { name_table };
+		for_each_arg(collector);
+		name_table.sort();
+	}
+
+	ArgParser(const ArgParser& other)
+		: args(other.args)
+		, name_table(other.name_table) {}
+
+
+	ParseResultVoid parse(OwnedParserState& state) const {
+		ArgSink sink;
+		return parse(state, sink);
+	}
+
+	template <typename Sink>
+	ParseResultVoid parse(OwnedParserState& state, Sink& sink) const {
+		ARGS_TIME_PHASE(Match);
+		return parse_iter<0>(state, sink);
+	}
+
+	// the names of the arguments, sorted
+	const NameTable& names() const {
+		return name_table;
+	}
+
+	ParseResultVoid eval_postcond(const ParserState& state) const {
+		ARGS_TIME_PHASE(Postcond);
+		return eval_postcond_iter<0>(state);
+	}
+
+	void reset() {
+		reset_iter<0>();
+	}
+
+	// see ArgState::use_resource
+	void use_resource(MemoryResource* res) {
+		ResourceSetter setter { res };
+		for_each_arg(setter);
+	}
+
+	// see ArgState::move_results_to
+	void move_results_to(MemoryResource* res) {
+		ResultMover mover { res };
+		for_each_arg(mover);
+	}
+
+	// calls f(arg) for every argument, in declaration order
+	template <typename F>
+	void for_each_arg(F& f) const {
+		for_each_arg_iter<0>(f);
+	}
+
+	// the slot of arg, null if arg is not managed by this parser
+	template <template <typename> class Slot, typename A>
+	const Slot<typename A::value_type>* find_slot(const A& arg, const Slots<Slot>& slots) const {
+		return find_slot_iter<Slot, 0>(arg, slots);
+	}
+
+	// results of arg in values, null if arg is not managed by this parser
+	template <typename A>
+	const std::vector<typename A::value_type>* find_values(const A& arg, const Values& values) const {
+		return find_slot<Vector>(arg, values);
+	}
+};
+
+
+template <typename... ArgTs>
+ArgParser<ArgTs...> args(ArgTs&... args) {
+	return ArgParser<ArgTs...>(args...);
+}
+
+}
+
+
+#endif
+
+#ifndef ARGS_FLAG_MATCHER_H
+#define ARGS_FLAG_MATCHER_H
+
+#include <utility>
+
+
+
+namespace args {
+
+struct FlagMatcher {
+	static constexpr char no_shortopt = '\0';
+
+	char shortopt;
+	Str longopt;
+
+	FlagMatcher(char shortopt, Str longopt)
+		: shortopt(shortopt)
+		, longopt(std::move(longopt)) {}
+
+	bool match_shortopt(const ParserState& s) const {
+		return shortopt != no_shortopt && s.ch() == shortopt;
+	}
+
+	bool match_longopt(const ParserState& s) const {
+		auto token_class = s.token_class();
+
+		if (s.str_off != 0 ||
+				(token_class != TokenClass::Longopt && token_class != TokenClass::LongoptValue))
+			return false;
+
+		return s.longopt_match.empty()
+			? longopt_name(s.arg()) == longopt
+			: s.longopt_match == longopt;
+	}
+
+	bool match(ParserState& s) const {
+		if (match_shortopt(s)) {
+			advance_shortopt(s);
+			return true;
+		}
+
+		else if (match_longopt(s)) {
+			// the value of "--name=value" is read by ParserState::param_next
+			if (s.token_class() == TokenClass::LongoptValue)
+				s.str_off = longopt_name(s.arg()).size() + 1;
+			else
+				s.pos++;
+
+			return true;
+		}
+
+		else
+			return false;
+	}
+
+	static void advance_shortopt(ParserState& s) {
+		s.str_off++;
+
+		if (s.str_off == s.arg().size()) {
+			s.str_off = 0;
+			s.pos++;
+		}
+	}
+};
+
+}
+
+#endif
+
+#ifndef ARGS_LAZY_PARAM_H
+#define ARGS_LAZY_PARAM_H
+
+
+
+#ifndef ARGS_PARAM_PARSER_H
+#define ARGS_PARAM_PARSER_H
+
+#include <type_traits>
+
+
+namespace args {
+
+template <typename T>
+struct ParamParser {
+	static_assert(
+		!std::is_same<T,T>::value,
+		"ParamParser is not specialized for this type");
+};
+
+}
+
+#endif
+
+
+
+namespace args {
+
+// Cheap check of a parameter of type Lazy<T> at parse time, before it's
+// converted. Accepts everything unless specialized.
+template <typename T>
+struct ParamCheck {
+	static ParseResultVoid check(const StrView&) {
+		return success();
+	}
+};
+
+
+// Parameter that is only converted by ParamParser<T> when it's first read
+// (e.g. flag<Lazy<Regex>>), for parameters that are expensive to convert and
+// rarely used. Until then only the token is stored, as a view: argv (or the
+// source the value came from) must outlive it. The conversion is cached, and
+// it's not thread-safe.
+template <typename T>
+class Lazy {
+	StrView param;
+	const BaseArg* owner = nullptr;
+
+	mutable bool converted = false;
+	mutable T value = T();
+	mutable ParseError error = success();
+
+	void convert() const {
+		if (converted)
+			return;
+
+		converted = true;
+
+		Argv tokens(1, param);
+		MatchLog matched;
+		ParserState s(matched, tokens);
+
+		auto res = ParamParser<T>::parse(s);
+
+		if (res.is_ok()) {
+			value = std::move(res.get_ok());
+		} else {
+			error = std::move(res.get_err());
+			error.set_arg(owner);
+		}
+	}
+
+public:
+	Lazy() = default;
+
+	explicit Lazy(StrView param)
+		: param(param) {}
+
+
+	// the unconverted parameter
+	const StrView& token() const {
+		return param;
+	}
+
+	// the argument the parameter belongs to, reported with conversion errors
+	void set_owner(const BaseArg* arg) {
+		owner = arg;
+	}
+
+	// converts the parameter if it hasn't been yet. success(), or the error of
+	// ParamParser<T> (e.g. for report_error)
+	const ParseError& status() const {
+		convert();
+		return error;
+	}
+
+	bool ok() const {
+		return status().is_ok();
+	}
+
+	// the converted parameter, T() if the conversion failed
+	const T& get() const {
+		convert();
+		return value;
+	}
+};
+
+
+template <typename T>
+void set_param_owner(T&, const BaseArg*) {
+}
+
+template <typename T>
+void set_param_owner(Lazy<T>& param, const BaseArg* arg) {
+	param.set_owner(arg);
+}
+
+
+template <typename T>
+struct ParamParser<Lazy<T>> {
+	using Result = ParseResult<Lazy<T>>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<Lazy>"));
+
+		auto param = s.param_next();
+		auto res = ParamCheck<T>::check(param);
+
+		if (!res.is_ok())
+			return Result::err(std::move(res));
+
+		return Result::ok(param);
+	}
+};
+
+}
+
+#endif
+
+
+namespace args {
+
+template <typename PreCond, typename PostCond, typename... Params>
+class Flag : public Arg<
+				std::tuple<Params...>, PreCond, PostCond,
+				Flag<PreCond, PostCond, Params...>
+			> {
+
+	using ParamsTuple = std::tuple<Params...>;
+	using TupResult = ParseResult<ParamsTuple>;
+
+	static constexpr std::size_t N = sizeof...(Params);
+
+	FlagMatcher matcher;
+
+
+	template <std::size_t I>
+	static If<I == N>
+	parse_params_iter(ParserState&, ParamsTuple&) {
+		return success();
+	}
+
+	template <std::size_t I>
+	static If<I < N>
+	parse_params_iter(ParserState& s, ParamsTuple& tup) {
+		using Type = typename std::tuple_element<I, ParamsTuple>::type;
+
+		auto res = success();
+
+		ParamParser<Type>::parse(s)
+
+		.if_ok([&](Type&& value) {
+			res = parse_params_iter<I+1>(s, tup);
+
+			if (res.is_ok())
+				std::get<I>(tup) = std::move(value);
+		})
+
+		.if_err([&](ParseError&& err) {
+			res = std::move(err);
+		});
+
+		return res;
+	}
+
+	static TupResult parse_params(ParserState& s) {
+		ARGS_TIME_PHASE(Params);
+
+		ParamsTuple tup;
+
+		auto res = parse_params_iter<0>(s, tup);
+
+		if (res.is_ok())
+			return TupResult::ok(std::move(tup));
+		else
+			return TupResult::err(std::move(res));
+	}
+
+	template <std::size_t I>
+	If<I == N, void> set_owner_iter(ParamsTuple&) const {
+	}
+
+	// lets Lazy parameters report their conversion errors for this flag
+	template <std::size_t I>
+	If<I < N, void> set_owner_iter(ParamsTuple& tup) const {
+		set_param_owner(std::get<I>(tup), this);
+		set_owner_iter<I+1>(tup);
+	}
+
+	void fmt_metavars(Str& s) const {
+		if (!doc_metavars.empty()) {
+			s += " ";
+			s += doc_metavars;
+		}
+	}
+
+public:
+
+	static constexpr std::size_t value_arity = N;
+
+	Str doc_metavars;
+
+
+	Flag(char shortopt, Str longopt, PreCond precond, PostCond postcond)
+		: Arg<ParamsTuple, PreCond, PostCond, Flag>(
+				std::move(precond), std::move(postcond))
+		, matcher(shortopt, std::move(longopt)) {
+
+		if (matcher.longopt.compare(0, 2, "--") == 0)
+			this->source_key = matcher.longopt.substr(2);
+	}
+
+	Flag(Flag&&) = default;
+
+
+	TupResult parse_impl(ParserState& s) const {
+		if (!s.bounds_check() || !s.offset_check())
+			return TupResult::err(BoundError("Flag::parse"));
+
+		if (!matcher.match(s))
+			return TupResult::err(ParseError(UnknownArg(s)));
+
+		auto res = parse_params(s);
+
+		// "--name=value" where the flag has no parameters
+		if (res.is_ok() && s.str_off != 0 && s.token_class() == TokenClass::LongoptValue) {
+			return TupResult::err(ParseError(InvalidParam(
+				"unexpected value",
+				s.arg().substr(s.str_off))));
+		}
+
+		if (res.is_ok())
+			set_owner_iter<0>(res.get_ok());
+
+		return res;
+	}
+
+	TupResult parse_value_impl(ParserState& s) const {
+		auto res = parse_params(s);
+
+		if (res.is_ok())
+			set_owner_iter<0>(res.get_ok());
+
+		return res;
+	}
+
+	void collect_names(NameTable& names) const {
+		names.add(matcher.longopt);
+	}
+
+
+	Flag& metavars(Str metavars) & {
+		this->doc_metavars = std::move(metavars);
+		return *this;
+	}
+
+	Flag&& metavars(Str metavars) && {
+		this->doc_metavars = std::move(metavars);
+		return std::move(*this);
+	}
+
+
+	virtual std::string to_str() const override {
+		Str result;
+
+		if (matcher.shortopt != FlagMatcher::no_shortopt) {
+			result += "-";
+			result += matcher.shortopt;
+			fmt_metavars(result);
+			result += ", ";
+		}
+
+		result += matcher.longopt;
+		fmt_metavars(result);
+
+		return result;
+	}
+};
+
+
+template <typename... FlagTs>
+class FlagParser : public ArgParser<FlagTs...> {
+public:
+
+	using ArgParser<FlagTs...>::ArgParser;
+
+	ParseResultVoid parse(OwnedParserState& s) const {
+		ArgSink sink;
+		return parse(s, sink);
+	}
+
+	template <typename Sink>
+	ParseResultVoid parse(OwnedParserState& s, Sink& sink) const {
+		auto token_class = s.token_class();
+
+		// the first "--" is consumed here, every token after it is positional
+		if (token_class == TokenClass::EndOfFlags && !s.end_of_flags) {
+			s.end_of_flags = true;
+			s.pos++;
+			return success();
+		}
+
+		bool longopt = token_class == TokenClass::Longopt
+			|| token_class == TokenClass::LongoptValue;
+
+		s.longopt_match = longopt && !s.end_of_flags
+			? this->names().resolve(longopt_name(s.arg()))
+			: StrView();
+
+		if (s.end_of_flags
+				|| token_class == TokenClass::Positional
+				|| token_class == TokenClass::Dash)
+			return ParseError(UnknownArg(s));
+
+		if (s.str_off == 0 && token_class == TokenClass::ShortoptCluster)
+			FlagMatcher::advance_shortopt(s);
+
+		return this->ArgParser<FlagTs...>::parse(s, sink);
+	}
+};
+
+
+// public API
+
+template <
+	typename... Ts,
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+Flag<PreCond, PostCond, Ts...>
+flag(char shortopt, Str longopt,
+		PreCond precond = PreCond(),
+		PostCond postcond = PostCond()) {
+
+	return {
+		shortopt,
+		std::move(longopt.insert(0, "--")),
+		std::move(precond),
+		std::move(postcond)
+	};
+}
+
+template <
+	typename... Ts,
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+Flag<PreCond, PostCond, Ts...>
+flag(Str longopt, PreCond precond = PreCond(), PostCond postcond = PostCond()) {
+	return flag<Ts...>(
+			FlagMatcher::no_shortopt,
+			std::move(longopt),
+			std::move(precond),
+			std::move(postcond));
+}
+
+template <typename... FlagTs>
+FlagParser<FlagTs...> flags(FlagTs&... flags) {
+	return FlagParser<FlagTs...>(flags...);
+}
+
+}
+
+#endif
+
+#ifndef ARGS_LAMBDA_ARG_H
+#define ARGS_LAMBDA_ARG_H
+
+#include <utility>
+
+
+
+namespace args {
+
+template <typename T, typename Parser, typename PreCond, typename PostCond>
+struct LambdaArg : public Arg<T, PreCond, PostCond, LambdaArg<T, Parser, PreCond, PostCond>> {
+	// the parser may consume any number of tokens
+	static constexpr bool bounded_tokens = false;
+
+	Parser parser;
+
+	LambdaArg(Parser&& parser, PreCond precond, PostCond postcond)
+		: Arg<T, PreCond, PostCond, LambdaArg>(
+				std::move(precond),
+				std::move(postcond))
+
+		, parser(std::move(parser)) {}
+
+	ParseResult<T> parse_impl(ParserState& s) const {
+		return parser(*this, s);
+	}
+
+	virtual Str to_str() const override {
+		return "(lambda)";
+	}
+};
+
+
+template <
+	typename T,
+	typename Parser,
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+LambdaArg<T, Parser, PreCond, PostCond>
+lambda_arg(
+		Parser parser,
+		PreCond precond = PreCond(),
+		PostCond postcond = PostCond()) {
+
+	return LambdaArg<T, Parser, PreCond, PostCond> {
+		std::move(parser),
+		std::move(precond),
+		std::move(postcond)
+	};
+}
+
+}
+
+#endif
+
+#ifndef ARGS_MAP_LOOKUP_ARG_H
+#define ARGS_MAP_LOOKUP_ARG_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+
+namespace args {
+
+template <typename T, typename PreCond, typename PostCond>
+struct MapLookupArg : public Arg<T, PreCond, PostCond, MapLookupArg<T, PreCond, PostCond>> {
+	std::unordered_map<Str, T> lookup_map;
+
+	MapLookupArg(std::unordered_map<Str, T> lookup_map,
+			PreCond precond, PostCond postcond)
+		: Arg<T, PreCond, PostCond, MapLookupArg>(
+				std::move(precond),
+				std::move(postcond))
+		, lookup_map(std::move(lookup_map)) {
+
+		index_keys();
+	}
+
+	MapLookupArg(const MapLookupArg& other)
+		: Arg<T, PreCond, PostCond, MapLookupArg>(other)
+		, lookup_map(other.lookup_map) {
+
+		index_keys();
+	}
+
+	// the nodes of lookup_map are moved along with it, so the index stays valid
+	MapLookupArg(MapLookupArg&&) = default;
+
+
+	ParseResult<T> parse_impl(ParserState& s) const {
+		using R = ParseResult<T>;
+
+		if (!s.bounds_check())
+			return R::err(ParseError(BoundError("MapLookupArg::parse()")));
+
+		const auto& arg = s.arg_next();
+
+		ARGS_COUNT(keyword_lookups);
+
+		if (s.str_off != 0)
+			return R::err(ParseError(InvalidShortoptList(arg)));
+
+		auto value = find(arg);
+
+		if (!value) {
+			return R::err(ParseError(InvalidParam(
+				"expected one of " + fmt_keys("(", ", ", ")"),
+				arg)));
+		} else {
+			return R::ok(*value);
+		}
+	}
+
+	// the value of key, null if it's not in lookup_map. unlike
+	// lookup_map.find(), this doesn't build a string from the token
+	const T* find(const StrView& key) const {
+		auto i = std::lower_bound(begin(sorted_keys), end(sorted_keys), key, key_less);
+
+		return i != end(sorted_keys) && i->first == key ? i->second : nullptr;
+	}
+
+	virtual Str to_str() const override {
+		return fmt_keys("", ", ", "");
+	}
+
+
+	void collect_names(NameTable& names) const {
+		for (const auto& entry : lookup_map)
+			names.add(entry.first);
+	}
+
+	Str fmt_keys(StrView lhs, StrView sep, StrView rhs) const {
+		auto i   = std::begin(lookup_map);
+		auto end = std::end(lookup_map);
+
+		Str s = lhs.str();
+
+		if (!lookup_map.empty()) {
+			s += i->first;
+
+			while (++i != end) {
+				s += sep.str();
+				s += i->first;
+			}
+		}
+
+		s += rhs.str();
+
+		return s;
+	}
+
+private:
+	using KeyEntry = std::pair<StrView, const T*>;
+
+	// the keys of lookup_map, sorted. lookup_map must not be modified after
+	// the argument is built
+	std::vector<KeyEntry> sorted_keys;
+
+	static bool key_less(const KeyEntry& entry, const StrView& key) {
+		return entry.first < key;
+	}
+
+	void index_keys() {
+		sorted_keys.clear();
+
+		for (const auto& entry : lookup_map)
+			sorted_keys.emplace_back(StrView(entry.first), &entry.second);
+
+		std::sort(begin(sorted_keys), end(sorted_keys),
+			[](const KeyEntry& a, const KeyEntry& b) {
+				return a.first < b.first;
+			});
+	}
+};
+
+
+
+template <
+	typename T,
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+MapLookupArg<T, PreCond, PostCond>
+map_lookup_arg(
+		std::unordered_map<Str, T> lookup_map,
+		PreCond precond = condition::True(),
+		PostCond postcond = condition::True()) {
+
+	return MapLookupArg<T, PreCond, PostCond> {
+		std::move(lookup_map),
+		std::move(precond),
+		std::move(postcond)
+	};
+}
+
+}
+
+#endif
+
+#ifndef ARGS_REST_ARG_H
+#define ARGS_REST_ARG_H
+
+#include <utility>
+
+
+
+namespace args {
+
+// Range of argv positions [first, last), relative to the argv given to parse.
+// The tokens aren't copied: they are argv[first] to argv[last-1]
+struct ArgSpan {
+	uint first = 0;
+	uint last = 0;
+
+	uint size() const {
+		return last - first;
+	}
+
+	bool empty() const {
+		return first == last;
+	}
+};
+
+// where a RestArg starts claiming the tokens
+enum class RestFrom {
+	EndOfFlags,     // after "--"
+	FirstPositional // at the first token that isn't a flag, or after "--"
+};
+
+
+// Claims the whole tail of argv in one step, as a single ArgSpan. It does not
+// take values from sources
+template <typename PreCond, typename PostCond>
+struct RestArg : public Arg<ArgSpan, PreCond, PostCond, RestArg<PreCond, PostCond>> {
+	// the tail may have any number of tokens
+	static constexpr bool bounded_tokens = false;
+
+	RestFrom from;
+
+	RestArg(RestFrom from, PreCond precond, PostCond postcond)
+		: Arg<ArgSpan, PreCond, PostCond, RestArg>(
+				std::move(precond),
+				std::move(postcond))
+		, from(from) {}
+
+	ParseResult<ArgSpan> parse_impl(ParserState& s) const {
+		using R = ParseResult<ArgSpan>;
+
+		if (!s.bounds_check())
+			return R::err(ParseError(BoundError("RestArg::parse()")));
+
+		auto token_class = s.token_class();
+
+		ArgSpan span;
+		span.first = s.pos;
+		span.last = s.argv.size();
+
+		if (!s.end_of_flags && token_class == TokenClass::EndOfFlags) {
+			// "--" hasn't been consumed by a FlagParser
+			span.first++;
+
+		} else if (!s.end_of_flags && (from == RestFrom::EndOfFlags
+				|| token_class != TokenClass::Positional)) {
+
+			return R::err(ParseError(UnknownArg(s)));
+		}
+
+		s.pos = span.last;
+		s.str_off = 0;
+
+		return R::ok(span);
+	}
+
+	virtual Str to_str() const override {
+		return "...";
+	}
+};
+
+
+template <
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+RestArg<PreCond, PostCond>
+rest_arg(
+		RestFrom from = RestFrom::EndOfFlags,
+		PreCond precond = PreCond(),
+		PostCond postcond = PostCond()) {
+
+	return RestArg<PreCond, PostCond> {
+		from,
+		std::move(precond),
+		std::move(postcond)
+	};
+}
+
+}
+
+#endif
+
+
+#ifndef ARGS_PARAM_PARSERS_H
+#define ARGS_PARAM_PARSERS_H
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+
+
+
+#ifndef ARGS_ALLOC_AUDIT_H
+#define ARGS_ALLOC_AUDIT_H
+
+#include <cstddef>
+#include <iostream>
+
+
+namespace args {
+
+// Records the allocations made with operator new by the calling thread while
+// it's alive, with their call stacks, e.g. to check that parsing with warm
+// buffers doesn't allocate. Allocations are only intercepted when the library
+// is built with ARGS_ALLOC_AUDIT (see enabled()), which replaces the global
+// operator new and delete, and with glibc malloc, calloc and realloc.
+class AllocAudit {
+public:
+	static constexpr std::size_t max_recorded = 64;
+	static constexpr std::size_t max_frames = 8;
+
+	struct Allocation {
+		std::size_t size;
+		void* frames[max_frames];
+		int frame_count;
+	};
+
+	// whether operator new is intercepted in this build
+	static bool enabled();
+
+	AllocAudit();
+	~AllocAudit();
+
+	AllocAudit(const AllocAudit&) = delete;
+	AllocAudit& operator= (const AllocAudit&) = delete;
+
+	// stops recording (also done by the destructor)
+	void stop();
+
+	// number of allocations, including the ones past max_recorded
+	std::size_t count() const {
+		return total;
+	}
+
+	std::size_t bytes() const {
+		return total_bytes;
+	}
+
+	// the first max_recorded allocations
+	const Allocation* begin() const {
+		return recorded;
+	}
+
+	const Allocation* end() const {
+		return recorded + (total < max_recorded ? total : max_recorded);
+	}
+
+	// writes every recorded allocation with its call stack
+	void report(std::ostream& o) const;
+
+	// called by operator new
+	void record(std::size_t size);
+
+private:
+	AllocAudit* previous;
+	bool active = true;
+	bool recording = false;
+
+	std::size_t total = 0;
+	std::size_t total_bytes = 0;
+	Allocation recorded[max_recorded];
+};
+
+
+// Leaves the allocations made by the calling thread while it's alive out of
+// its AllocAudit. Used by the parameter parsers around the data of values that
+// own it (e.g. strings longer than the small-string buffer), which grows with
+// the input whatever the buffers are
+class AllocExempt {
+	AllocAudit* audit;
+
+public:
+	AllocExempt();
+	~AllocExempt();
+
+	AllocExempt(const AllocExempt&) = delete;
+	AllocExempt& operator= (const AllocExempt&) = delete;
+};
+
+
+// runs f under an AllocAudit and writes its allocations to o. returns whether
+// f didn't allocate. buffers reused across calls (e.g. Results or a
+// ParseSession) should be warmed up by a first call outside of the audit
+template <typename F>
+bool allocation_free(F&& f, std::ostream& o = std::cerr) {
+	AllocAudit audit;
+	f();
+	audit.stop();
+
+	if (audit.count() != 0)
+		audit.report(o);
+
+	return audit.count() == 0;
+}
+
+}
+
+#endif
+
+
+namespace args {
+
+template <>
+struct ParamParser<bool> {
+	using Result = ParseResult<bool>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<bool>"));
+
+		auto arg = s.param_next();
+
+		if (arg == "true")
+			return Result::ok(true);
+		else if (arg == "false")
+			return Result::ok(false);
+		else
+			return Result::err(ParseError(InvalidParam("expected 'true' or 'false'", arg)));
+	}
+};
+
+template <>
+struct ParamParser<int> {
+	using Result = ParseResult<int>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<int>"));
+
+		auto arg = s.param_next();
+
+		int result;
+
+		if (parse_int(arg, result))
+			return Result::ok(result);
+		else
+			return Result::err(ParseError(InvalidParam("could not parse int", arg)));
+	}
+
+	// the whole argument must be a base 10 integer in range. no allocations,
+	// the argument is copied to the stack so that it doesn't need a '\0'
+	static bool parse_int(const StrView& arg, int& result) {
+		char buf[32];
+
+		if (arg.empty() || arg.size() >= sizeof buf)
+			return false;
+
+		std::memcpy(buf, arg.c_str(), arg.size());
+		buf[arg.size()] = '\0';
+
+		char* end;
+		errno = 0;
+		long value = std::strtol(buf, &end, 10);
+
+		if (errno != 0 || end != buf + arg.size() || std::isspace(static_cast<unsigned char>(buf[0])) ||
+				value < std::numeric_limits<int>::min() ||
+				value > std::numeric_limits<int>::max())
+			return false;
+
+		result = static_cast<int>(value);
+		return true;
+	}
+};
+
+template <>
+struct ParamParser<Str> {
+	using Result = ParseResult<Str>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<Str>"));
+
+		auto param = s.param_next();
+		AllocExempt owned_data;
+
+		return Result::ok(param.str());
+	}
+};
+
+// the parameter as a view into argv, which must outlive the results
+template <>
+struct ParamParser<StrView> {
+	using Result = ParseResult<StrView>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<StrView>"));
+
+		return Result::ok(s.param_next());
+	}
+};
+
+// the parameter allocated from the resource of the state
+template <>
+struct ParamParser<PolyString> {
+	using Result = ParseResult<PolyString>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<PolyString>"));
+
+		auto param = s.param_next();
+		AllocExempt owned_data;
+
+		return Result::ok(PolyString(param.c_str(), param.size(), s.resource));
+	}
+};
+
+}
+
+#endif
+
+#ifndef ARGS_PATH_PARAMS_H
+#define ARGS_PATH_PARAMS_H
+
+#include <tuple>
+#include <vector>
+
+
+#ifndef ARGS_RESULT_CODEC_H
+#define ARGS_RESULT_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+
+
+
+namespace args {
+
+// Reads the bytes written by ResultCodecs, failing instead of reading past
+// the end
+struct ByteReader {
+	const char* p = nullptr;
+	const char* end = nullptr;
+
+	ByteReader() = default;
+
+	explicit ByteReader(StrView data)
+		: p(data.begin()), end(data.end()) {}
+
+	bool read(void* out, std::size_t size) {
+		if (static_cast<std::size_t>(end - p) < size)
+			return false;
+
+		std::memcpy(out, p, size);
+		p += size;
+		return true;
+	}
+
+	// a view into the data, which must outlive it
+	bool view(std::size_t size, StrView& out) {
+		if (static_cast<std::size_t>(end - p) < size)
+			return false;
+
+		out = StrView(p, size);
+		p += size;
+		return true;
+	}
+
+	bool at_end() const {
+		return p == end;
+	}
+};
+
+
+template <typename T>
+struct IsTuple : std::false_type {};
+
+template <typename... Ts>
+struct IsTuple<std::tuple<Ts...>> : std::true_type {};
+
+
+// Converts results of type T to bytes and back, for ResultCache. Trivially
+// copyable types are stored as they are (so they must not hold pointers),
+// specialize it for other types.
+template <typename T, typename Enable = void>
+struct ResultCodec {
+	static_assert(
+		!std::is_same<T,T>::value,
+		"ResultCodec is not specialized for this type");
+};
+
+template <typename T>
+struct ResultCodec<T, typename std::enable_if<
+		std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value
+		&& !std::is_same<T, StrView>::value && !IsTuple<T>::value
+	>::type> {
+
+	static void encode(const T& value, std::string& out) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof value);
+	}
+
+	static bool decode(ByteReader& in, T& value) {
+		return in.read(&value, sizeof value);
+	}
+};
+
+template <>
+struct ResultCodec<Str> {
+	static void encode(const Str& value, std::string& out) {
+		std::uint32_t size = value.size();
+		ResultCodec<std::uint32_t>::encode(size, out);
+		out += value;
+	}
+
+	static bool decode(ByteReader& in, Str& value) {
+		std::uint32_t size;
+		StrView data;
+
+		if (!ResultCodec<std::uint32_t>::decode(in, size) || !in.view(size, data))
+			return false;
+
+		value.assign(data.c_str(), data.size());
+		return true;
+	}
+};
+
+// decoded views point into the cache entry, which stays mapped until the
+// ResultCache that loaded it loads another one
+template <>
+struct ResultCodec<StrView> {
+	static void encode(const StrView& value, std::string& out) {
+		std::uint32_t size = value.size();
+		ResultCodec<std::uint32_t>::encode(size, out);
+		out.append(value.c_str(), value.size());
+	}
+
+	static bool decode(ByteReader& in, StrView& value) {
+		std::uint32_t size;
+		return ResultCodec<std::uint32_t>::decode(in, size) && in.view(size, value);
+	}
+};
+
+template <typename... Ts>
+struct ResultCodec<std::tuple<Ts...>> {
+	using Tuple = std::tuple<Ts...>;
+
+	static void encode(const Tuple& value, std::string& out) {
+		encode_iter<0>(value, out);
+	}
+
+	static bool decode(ByteReader& in, Tuple& value) {
+		return decode_iter<0>(in, value);
+	}
+
+private:
+	template <std::size_t I>
+	static If<I == sizeof...(Ts), void> encode_iter(const Tuple&, std::string&) {
+	}
+
+	template <std::size_t I>
+	static If<I < sizeof...(Ts), void> encode_iter(const Tuple& value, std::string& out) {
+		using T = typename std::tuple_element<I, Tuple>::type;
+
+		ResultCodec<T>::encode(std::get<I>(value), out);
+		encode_iter<I+1>(value, out);
+	}
+
+	template <std::size_t I>
+	static If<I == sizeof...(Ts), bool> decode_iter(ByteReader&, Tuple&) {
+		return true;
+	}
+
+	template <std::size_t I>
+	static If<I < sizeof...(Ts), bool> decode_iter(ByteReader& in, Tuple& value) {
+		using T = typename std::tuple_element<I, Tuple>::type;
+
+		return ResultCodec<T>::decode(in, std::get<I>(value)) && decode_iter<I+1>(in, value);
+	}
+};
+
+}
+
+#endif
+
+
+
+#ifndef ARGS_STAT_BATCH_H
+#define ARGS_STAT_BATCH_H
+
+#include <vector>
+
+
+#ifndef ARGS_THREAD_POOL_H
+#define ARGS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace args {
+
+// Fixed set of worker threads that run indexed tasks. Every worker starts with
+// a contiguous range of task indices and steals from the ranges of the others
+// once its own is exhausted, so uneven tasks still keep every core busy.
+class ThreadPool {
+public:
+	using Task = std::function<void(std::size_t worker, std::size_t index)>;
+
+	// threads == 0 uses one worker per hardware thread. The thread calling
+	// run() counts as a worker
+	explicit ThreadPool(std::size_t threads = 0);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator= (const ThreadPool&) = delete;
+
+	~ThreadPool();
+
+
+	std::size_t size() const {
+		return workers.size() + 1;
+	}
+
+	// runs task(worker, i) for every i in [0, count) and waits for all of them.
+	// worker is in [0, size()), and can be used to index per-thread scratch data
+	void run(std::size_t count, const Task& task);
+
+private:
+	// padded to a cache line, so that workers taking indices from neighbouring
+	// ranges don't share one (new doesn't honour alignas(64) before C++17)
+	struct Range {
+		std::atomic<std::size_t> next;
+		std::size_t end;
+		char padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+	};
+
+	std::vector<std::thread> workers;
+	std::unique_ptr<Range[]> ranges;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+
+	const Task* task = nullptr;
+	std::size_t generation = 0;
+	std::size_t running = 0;
+	bool stopping = false;
+
+
+	void work(std::size_t worker);
+
+	void worker_loop(std::size_t worker);
+};
+
+}
+
+#endif
+
+
+namespace args {
+
+struct PathStat {
+	int error = 0; // errno of the stat, 0 on success
+	bool is_dir = false;
+};
+
+// How stat_batch makes its requests
+enum class StatMethod : unsigned char {
+	Syscalls, // one stat per path, spread over the pool if there is one
+	IoUring   // statx through io_uring on Linux, else like Syscalls
+};
+
+// Stats every path of paths into out (resized to paths.size()), one by one, or
+// spread over pool if it isn't null. With StatMethod::IoUring the requests are
+// instead submitted in batches of statx through io_uring, one io_uring_enter
+// per batch of up to 4096 paths, falling back to the syscalls where io_uring
+// is not available (or not allowed). It's opt-in because setting up the ring
+// costs more than it saves on the stats of a typical command line (about
+// twice as slow as the syscalls on a warm cache).
+void stat_batch(const std::vector<const char*>& paths, std::vector<PathStat>& out,
+		ThreadPool* pool = nullptr, StatMethod method = StatMethod::Syscalls);
+
+}
+
+#endif
+
+
+namespace args {
+
+enum class PathKind : unsigned char {
+	Existing,       // must exist
+	Directory,      // must be an existing directory
+	CreatableParent // its parent must be an existing directory
+};
+
+// Path parameter (e.g. flag<ExistingPath>) checked by PathChecks after the
+// parse, so that the checks of all paths can be batched. The parse itself
+// only stores the path
+template <PathKind K>
+struct CheckedPath {
+	static constexpr PathKind kind = K;
+
+	Str path;
+
+	const Str& str() const {
+		return path;
+	}
+};
+
+using ExistingPath = CheckedPath<PathKind::Existing>;
+using ExistingDir = CheckedPath<PathKind::Directory>;
+using CreatablePath = CheckedPath<PathKind::CreatableParent>;
+
+
+template <PathKind K>
+struct ParamParser<CheckedPath<K>> {
+	using Result = ParseResult<CheckedPath<K>>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<CheckedPath>"));
+
+		auto param = s.param_next();
+		AllocExempt owned_data;
+
+		CheckedPath<K> path;
+		path.path = param.str();
+
+		return Result::ok(std::move(path));
+	}
+};
+
+template <PathKind K>
+struct ResultCodec<CheckedPath<K>> {
+	static void encode(const CheckedPath<K>& value, std::string& out) {
+		ResultCodec<Str>::encode(value.path, out);
+	}
+
+	static bool decode(ByteReader& in, CheckedPath<K>& value) {
+		return ResultCodec<Str>::decode(in, value.path);
+	}
+};
+
+
+// Checks the CheckedPath results of arguments (directly, or in the parameters
+// of flags) in one batch, see stat_batch
+class PathChecks {
+	struct Request {
+		const Str* path;
+		PathKind kind;
+		const BaseArg* arg;
+	};
+
+	std::vector<Request> requests;
+	std::vector<Str> parents;
+
+	std::vector<const char*> stat_paths;
+	std::vector<PathStat> stats;
+
+
+	template <typename T>
+	void collect(const T&, const BaseArg*) {
+	}
+
+	template <PathKind K>
+	void collect(const CheckedPath<K>& path, const BaseArg* arg) {
+		requests.push_back(Request { &path.path, K, arg });
+	}
+
+	template <typename... Ts>
+	void collect(const std::tuple<Ts...>& tup, const BaseArg* arg) {
+		collect_iter<0>(tup, arg);
+	}
+
+	template <std::size_t I, typename... Ts>
+	If<I == sizeof...(Ts), void> collect_iter(const std::tuple<Ts...>&, const BaseArg*) {
+	}
+
+	template <std::size_t I, typename... Ts>
+	If<I < sizeof...(Ts), void> collect_iter(const std::tuple<Ts...>& tup, const BaseArg* arg) {
+		collect(std::get<I>(tup), arg);
+		collect_iter<I+1>(tup, arg);
+	}
+
+	ParseResultVoid check(const Request& req, const PathStat& st) const;
+
+public:
+	// adds the paths among the current results of arg, which must not change
+	// until run()
+	template <typename A>
+	PathChecks& add(const A& arg) {
+		for (const auto& value : arg.result)
+			collect(value, &arg);
+
+		return *this;
+	}
+
+	// stats every path (see stat_batch) and returns the first failed check,
+	// in the order the paths were added, as an InvalidParam of its argument.
+	// The paths are forgotten afterwards
+	ParseResultVoid run(ThreadPool* pool = nullptr,
+			StatMethod method = StatMethod::Syscalls);
+};
+
+}
+
+#endif
+
+
+#ifndef ARGS_BATCH_H
+#define ARGS_BATCH_H
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+#ifndef ARGS_SCHEMA_H
+#define ARGS_SCHEMA_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+
+#ifndef ARGS_PARSER_H
+#define ARGS_PARSER_H
+
+#include <iostream>
+
+
+
+#ifndef ARGS_SOURCE_H
+#define ARGS_SOURCE_H
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+
+
+#ifndef ARGS_TOKENIZER_H
+#define ARGS_TOKENIZER_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+
+namespace args {
+
+inline bool is_word_separator(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// appends the whitespace-separated words of s to words, as views into s
+template <typename Words>
+void split_words(StrView s, Words& words) {
+	std::size_t i = 0;
+
+	while (i < s.size()) {
+		while (i < s.size() && is_word_separator(s[i]))
+			i++;
+
+		std::size_t start = i;
+
+		while (i < s.size() && !is_word_separator(s[i]))
+			i++;
+
+		if (i > start)
+			words.push_back(s.substr(start, i - start));
+	}
+}
+
+// appends the lines of s to lines, without the '\n' (or "\r\n")
+inline void split_lines(StrView s, std::vector<StrView>& lines) {
+	std::size_t pos = 0;
+
+	while (pos < s.size()) {
+		auto nl = static_cast<const char*>(
+				std::memchr(s.c_str() + pos, '\n', s.size() - pos));
+
+		std::size_t end = nl ? nl - s.c_str() : s.size();
+		std::size_t len = end - pos;
+
+		if (len > 0 && s[end-1] == '\r')
+			len--;
+
+		lines.push_back(s.substr(pos, len));
+		pos = end + 1;
+	}
+}
+
+// Splits a command line like a POSIX shell: words are separated by
+// whitespace, '...' keeps everything literally, "..." only interprets \$ \`
+// \" \\ and \<newline>, and \ outside of quotes escapes any character.
+// Other shell syntax ($var, |, ;, ...) is kept as is. The words are appended to
+// words as views into s when they don't need unescaping (including words that
+// are a single quoted string), otherwise they are unescaped into buffer, which
+// is reserved to s.size() beforehand so the views stay valid until buffer is
+// modified. Returns false on an unterminated quote or a trailing backslash.
+// If word_ends is given, the offset in s of the end of every word is appended
+// to it. Defined for std::vector<StrView> and PolyVector<StrView>.
+template <typename Words>
+bool split_shell(StrView s, Words& words, std::string& buffer,
+		std::vector<std::size_t>* word_ends = nullptr);
+
+}
+
+#endif
+
+
+namespace args {
+
+// A value found by a source for the argument numbered `slot` (arguments are
+// numbered in declaration order across all the parsers)
+struct SourceValue {
+	uint slot;
+	StrView value;
+};
+
+
+// Sorted table of the source keys of all declared arguments
+class SourceIndex {
+	std::vector<std::pair<Str, uint>> entries;
+
+public:
+	static constexpr int not_found = -1;
+
+	void add(Str key, uint slot);
+
+	void sort();
+
+	int find(StrView key) const;
+
+	bool empty() const {
+		return entries.empty();
+	}
+};
+
+
+template <typename Source>
+struct SourceKeyCollector {
+	const Source& source;
+	SourceIndex& index;
+	uint slot = 0;
+
+	SourceKeyCollector(const Source& source, SourceIndex& index)
+		: source(source)
+		, index(index) {}
+
+	template <typename A>
+	void operator() (A& arg) {
+		if (!arg.source_key.empty())
+			index.add(source.index_key(arg.source_key), slot);
+
+		slot++;
+	}
+};
+
+
+// Feeds the values of a source to their arguments. Arguments that already
+// have been given (by argv or a source with a higher precedence) are skipped.
+class SourceApplier {
+	OwnedParserState& state;
+	Origin origin;
+	const std::vector<SourceValue>& values;
+	Argv tokens;
+
+	std::size_t next = 0;
+	uint slot = 0;
+
+
+	template <typename A>
+	ParseResultVoid apply(A& arg, StrView value) {
+		tokens.clear();
+
+		if (A::value_arity == 0) {
+			// flags without parameters are enabled by a boolean value
+			tokens.push_back(value);
+
+			ParserState bool_state(state.matched_args, tokens);
+			auto enabled = ParamParser<bool>::parse(bool_state);
+
+			if (!enabled.is_ok()) {
+				enabled.get_err().set_arg(&arg);
+				return enabled.get_err();
+			}
+
+			if (!enabled.get_ok())
+				return success();
+
+			tokens.clear();
+
+		} else if (A::value_arity == 1) {
+			tokens.push_back(value);
+
+		} else {
+			split_words(value, tokens);
+		}
+
+		ParserState value_state(state.matched_args, tokens);
+		value_state.resource = state.resource;
+
+		const auto& c_arg = arg;
+		auto res = arg.precond(c_arg, value_state);
+
+		if (res.is_ok())
+			res = arg.parse_value(value_state);
+
+		if (res.is_ok() && value_state.pos != tokens.size())
+			res = ParseError(InvalidParam("too many values", value));
+
+		if (res.is_ok()) {
+			arg.multiplicity++;
+			arg.origin = origin;
+			state.owned_matched_args.add(arg);
+		} else {
+			res.set_arg(&arg);
+		}
+
+		return res;
+	}
+
+public:
+	ParseResultVoid result = success();
+
+	SourceApplier(OwnedParserState& state, Origin origin,
+			const std::vector<SourceValue>& values)
+		: state(state)
+		, origin(origin)
+		, values(values) {}
+
+	template <typename A>
+	void operator() (A& arg) {
+		bool taken = arg.multiplicity > 0;
+
+		for (; next < values.size() && values[next].slot == slot; next++) {
+			if (result.is_ok() && !taken)
+				result = apply(arg, values[next].value);
+		}
+
+		slot++;
+	}
+};
+
+
+template <typename F>
+void for_each_arg(F&) {
+}
+
+template <typename F, typename ArgParser, typename... ArgParsers>
+void for_each_arg(F& f, ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+	arg_parser.for_each_arg(f);
+	for_each_arg(f, arg_parsers...);
+}
+
+
+// Looks up the keys of every argument in the source and parses the values
+// that were found. Values keep the order of the source for every argument.
+template <typename Source, typename... ArgParsers>
+ParseResultVoid apply_source(const Source& source,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	SourceIndex index;
+	SourceKeyCollector<Source> collector(source, index);
+	for_each_arg(collector, arg_parsers...);
+
+	if (index.empty())
+		return success();
+
+	index.sort();
+
+	std::vector<SourceValue> values;
+	auto res = source.scan(index, values);
+
+	if (!res.is_ok())
+		return res;
+
+	std::stable_sort(begin(values), end(values),
+		[](const SourceValue& lhs, const SourceValue& rhs) {
+			return lhs.slot < rhs.slot;
+		});
+
+	SourceApplier applier(state, source.origin(), values);
+	for_each_arg(applier, arg_parsers...);
+
+	return applier.result;
+}
+
+
+// Sources ordered by decreasing precedence. Every source only fills the
+// arguments that were not given by argv or the previous ones, so values that
+// would be overridden are never parsed.
+template <typename... Sources>
+struct Layers {
+	static constexpr std::size_t N = sizeof...(Sources);
+
+	std::tuple<Sources...> sources;
+
+	explicit Layers(Sources... sources) : sources(std::move(sources)...) {}
+};
+
+
+template <std::size_t I, typename... Sources, typename... ArgParsers>
+If<I == sizeof...(Sources)> apply_layers_iter(const Layers<Sources...>&,
+		OwnedParserState&, ArgParsers&...) {
+	return success();
+}
+
+template <std::size_t I, typename... Sources, typename... ArgParsers>
+If<I < sizeof...(Sources)> apply_layers_iter(const Layers<Sources...>& layers,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	auto res = apply_source(std::get<I>(layers.sources), state, arg_parsers...);
+
+	return res.is_ok()
+		? apply_layers_iter<I+1>(layers, state, arg_parsers...)
+		: res;
+}
+
+template <typename... Sources, typename... ArgParsers>
+ParseResultVoid apply_source(const Layers<Sources...>& layers,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	return apply_layers_iter<0>(layers, state, arg_parsers...);
+}
+
+
+template <typename... Sources>
+Layers<Sources...> layers(Sources... sources) {
+	return Layers<Sources...>(std::move(sources)...);
+}
+
+}
+
+#endif
+
+
+namespace args {
+
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+	return parse_impl(argv_begin, argv_end, arg_parsers...);
+}
+
+
+// like parse, but argv, the matched arguments and the results of the
+// arguments are allocated from resource during the parse (e.g. a
+// MonotonicBuffer per request). Previous results are forgotten. The results
+// are moved to new_delete_resource() before returning, so they stay valid
+// after resource is destroyed.
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(MemoryResource& resource,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	int expand[] = { 0, (arg_parsers.use_resource(&resource), 0)... };
+	(void) expand;
+
+	OwnedParserState state(argv_begin, argv_end, &resource);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = eval_postcond_iter(state, arg_parsers...);
+
+	int moved[] = { 0, (arg_parsers.move_results_to(new_delete_resource()), 0)... };
+	(void) moved;
+
+	return res;
+}
+
+
+// like parse, but arguments that are not given in argv are then looked up in
+// source (e.g. env_source("TOOL_")). Values in argv take precedence.
+template <typename Source, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse_with(const Source& source,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	OwnedParserState state(argv_begin, argv_end);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = apply_source(source, state, arg_parsers...);
+
+	return res.is_ok()? eval_postcond_iter(state, arg_parsers...) : res;
+}
+
+
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse_impl(InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	OwnedParserState state(argv_begin, argv_end);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	return res.is_ok()? eval_postcond_iter(state, arg_parsers...) : res;
+}
+
+
+// numbers the arguments that no Schema has numbered in declaration order
+// across arg_parsers, like a Schema of them would, so that the per-argument
+// statistics of ARGS_INSTRUMENT (see ArgCost) tell them apart. Numbered
+// arguments keep their id, so a Schema that contains them still works
+struct ArgNumberer {
+	uint next;
+
+	template <typename A>
+	void operator() (A& arg) {
+		if (arg.id == BaseArg::no_id)
+			arg.id = next;
+
+		next++;
+	}
+};
+
+template <typename... ArgParsers>
+void number_args(ArgParsers&... arg_parsers) {
+	ArgNumberer numberer { 0 };
+
+	int expand[] = { 0, (arg_parsers.for_each_arg(numberer), 0)... };
+	(void) expand;
+}
+
+
+template <typename... ArgParsers>
+ParseResultVoid parse_argv(OwnedParserState& state, ArgParsers&... arg_parsers) {
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
+	while (state.pos < state.argv.size()) {
+		auto res = parse_iter(state, arg_parsers...);
+
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers...);
+
+		if (!res.is_ok())
+			return res;
+	}
+
+	return success();
+}
+
+
+// fills the suggestion of an unknown argument with the closest name of the
+// arguments of the parsers
+template <typename... ArgParsers>
+void suggest(UnknownArg& err, const ArgParsers&... arg_parsers) {
+	if (err.str_off != 0)
+		return;
+
+	NameSuggester suggester(longopt_name(err.argv_element));
+
+	int expand[] = { 0, (suggester.add(arg_parsers.names()), 0)... };
+	(void) expand;
+
+	err.suggestion = suggester.suggestion();
+}
+
+
+inline ParseResultVoid parse_iter(const ParserState& state) {
+	return ParseError(UnknownArg(state));
+}
+
+template <typename ArgParser, typename... ArgParsers>
+ParseResultVoid parse_iter(OwnedParserState& state,
+		ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+
+	auto res = arg_parser.parse(state);
+
+	return is<UnknownArg>(res)? parse_iter(state, arg_parsers...) : res;
+}
+
+
+// forgets the results of a previous parse so that the arguments can be reused
+inline void reset() {
+}
+
+template <typename ArgParser, typename... ArgParsers>
+void reset(ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+	arg_parser.reset();
+	reset(arg_parsers...);
+}
+
+
+inline ParseResultVoid eval_postcond_iter(const OwnedParserState& state) {
+	return success();
+}
+
+template <typename ArgParser, typename... ArgParsers>
+ParseResultVoid eval_postcond_iter(const OwnedParserState& state,
+		ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+
+	auto res = arg_parser.eval_postcond(state);
+
+	return res.is_ok()? eval_postcond_iter(state, arg_parsers...) : res;
+}
+
+}
+
+#endif
+
+
+
+namespace args {
+
+template <typename... ArgParsers>
+class Schema;
+
+
+// Results of a parse with a Schema. Unlike args::parse, the arguments are not
+// modified: their results and multiplicities are stored here instead.
+template <typename... ArgParsers>
+class Results {
+	friend class Schema<ArgParsers...>;
+
+public:
+	using ParsersTuple = std::tuple<ArgParsers...>;
+	using ValuesTuple = std::tuple<typename ArgParsers::Values...>;
+
+private:
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	const ParsersTuple* arg_parsers = nullptr;
+
+	ValuesTuple values;
+	std::vector<uint> counts;
+	ParseResultVoid res = success();
+
+
+	template <typename A>
+	using ValuesPtr = const std::vector<typename A::value_type>*;
+
+	template <std::size_t P, typename A>
+	If<P == N, ValuesPtr<A>> find_values_iter(const A&) const {
+		return nullptr;
+	}
+
+	template <std::size_t P, typename A>
+	If<P < N, ValuesPtr<A>> find_values_iter(const A& arg) const {
+		auto found = std::get<P>(*arg_parsers).find_values(arg, std::get<P>(values));
+
+		return found ? found : find_values_iter<P+1>(arg);
+	}
+
+
+	template <std::size_t... Ps>
+	void clear(Indices<Ps...>) {
+		int expand[] = { 0, (clear_values(std::get<Ps>(values)), 0)... };
+		(void) expand;
+	}
+
+	template <typename... Vecs>
+	static void clear_values(std::tuple<Vecs...>& vecs) {
+		clear_vecs(vecs, BuildIndices<sizeof...(Vecs)>());
+	}
+
+	template <typename Tuple, std::size_t... Is>
+	static void clear_vecs(Tuple& vecs, Indices<Is...>) {
+		int expand[] = { 0, (std::get<Is>(vecs).clear(), 0)... };
+		(void) expand;
+	}
+
+	void clear(const ParsersTuple* arg_parsers, uint arg_count) {
+		this->arg_parsers = arg_parsers;
+		clear(BuildIndices<N>());
+		counts.assign(arg_count, 0);
+		res = success();
+	}
+
+public:
+
+	// the parse error, or success()
+	const ParseResultVoid& result() const {
+		return res;
+	}
+
+	bool is_ok() const {
+		return res.is_ok();
+	}
+
+	uint multiplicity(const BaseArg& arg) const {
+		return arg.id < counts.size() ? counts[arg.id] : 0;
+	}
+
+	bool has(const BaseArg& arg) const {
+		return multiplicity(arg) > 0;
+	}
+
+	// results of every argument, grouped by parser
+	const ValuesTuple& all_values() const {
+		return values;
+	}
+
+	// the equivalent of arg.result. arg must be part of the schema
+	template <typename A>
+	const std::vector<typename A::value_type>& operator[] (const A& arg) const {
+		static const std::vector<typename A::value_type> none;
+
+		auto found = arg_parsers ? find_values_iter<0>(arg) : nullptr;
+
+		return found ? *found : none;
+	}
+};
+
+
+// ChunkTraits of every argument of a set of parsers
+template <typename... ArgParsers>
+struct ParsersChunkTraits {
+	static constexpr bool chunkable = true;
+	static constexpr std::size_t max_arity = 0;
+};
+
+template <typename P, typename... ArgParsers>
+struct ParsersChunkTraits<P, ArgParsers...> {
+	using Rest = ParsersChunkTraits<ArgParsers...>;
+
+	static constexpr bool chunkable = P::Chunking::chunkable && Rest::chunkable;
+
+	static constexpr std::size_t max_arity = P::Chunking::max_arity > Rest::max_arity
+		? P::Chunking::max_arity : Rest::max_arity;
+};
+
+
+// computes where the values of every chunk of argv go in the merged results
+struct ChunkSizeValues {
+	std::vector<std::size_t>& bases;
+
+	template <typename T>
+	void operator() (const std::vector<T>& chunk, std::vector<T>& merged) {
+		bases.push_back(merged.size());
+		merged.resize(merged.size() + chunk.size());
+	}
+};
+
+// moves the values of a chunk of argv to the merged results
+struct ChunkMoveValues {
+	const std::vector<std::size_t>& bases;
+	std::size_t arg;
+
+	explicit ChunkMoveValues(const std::vector<std::size_t>& bases)
+		: bases(bases)
+		, arg(0) {}
+
+	template <typename T>
+	void operator() (std::vector<T>& chunk, std::vector<T>& merged) {
+		std::move(begin(chunk), end(chunk), begin(merged) + bases[arg++]);
+	}
+};
+
+
+// Read-only set of parsers that can be used by many threads at once, since
+// parsing stores everything in a Results object instead of the arguments.
+// Building a schema numbers its arguments (BaseArg::id), so an argument can
+// only belong to one schema. Custom arguments and conditions must not modify
+// themselves while parsing and must use ParserState::multiplicity().
+template <typename... ArgParsers>
+class Schema {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	std::tuple<ArgParsers...> arg_parsers;
+	uint arg_count = 0;
+
+	// see allocation_free
+	bool alloc_free = false;
+
+
+	struct IdAssigner {
+		uint next = 0;
+
+		template <typename A>
+		void operator() (A& arg) {
+			arg.id = next++;
+		}
+	};
+
+	template <std::size_t... Ps>
+	void assign_ids(Indices<Ps...>) {
+		IdAssigner assigner;
+		int expand[] = { 0, (std::get<Ps>(arg_parsers).for_each_arg(assigner), 0)... };
+		(void) expand;
+		arg_count = assigner.next;
+	}
+
+
+	template <std::size_t P>
+	If<P == N> parse_iter(OwnedParserState& state, Results<ArgParsers...>&) const {
+		return ParseError(UnknownArg(state));
+	}
+
+	template <std::size_t P>
+	If<P < N> parse_iter(OwnedParserState& state, Results<ArgParsers...>& out) const {
+		using Parser = typename std::tuple_element<P, std::tuple<ArgParsers...>>::type;
+
+		typename Parser::ValueSink sink { std::get<P>(out.values), out.counts.data() };
+
+		auto res = std::get<P>(arg_parsers).parse(state, sink);
+
+		return is<UnknownArg>(res) ? parse_iter<P+1>(state, out) : res;
+	}
+
+
+	// parses the remaining tokens of state, without the postconditions
+	const ParseResultVoid& parse_tokens(OwnedParserState& state,
+			Results<ArgParsers...>& out) const {
+
+		state.counts = out.counts.data();
+		state.count_size = arg_count;
+
+		while (state.pos < state.argv.size()) {
+			out.res = parse_iter<0>(state, out);
+
+			if (is<UnknownArg>(out.res))
+				suggest(out.res.template get<UnknownArg>(), BuildIndices<N>());
+
+			if (!out.res.is_ok())
+				break;
+		}
+
+		return out.res;
+	}
+
+	template <std::size_t... Ps>
+	void suggest(UnknownArg& err, Indices<Ps...>) const {
+		args::suggest(err, std::get<Ps>(arg_parsers)...);
+	}
+
+	const ParseResultVoid& parse_state(OwnedParserState& state,
+			Results<ArgParsers...>& out) const {
+
+		ARGS_TIME_PARSE();
+
+		out.clear(&arg_parsers, arg_count);
+
+		if (!parse_tokens(state, out).is_ok())
+			return out.res;
+
+		out.res = eval_postcond_iter<0>(state);
+		return out.res;
+	}
+
+	// whether a parse starting at argv[k] begins with a new argument, given
+	// that no argument consumes more than max_arity tokens after a flag and
+	// only one otherwise (see Arg::bounded_tokens)
+	static bool chunk_boundary(const ParserState& state, std::size_t k) {
+		std::size_t window = k < max_arity ? k : max_arity;
+
+		for (std::size_t t = k - window; t < k; t++) {
+			if (state.classes[t] != TokenClass::Positional)
+				return false;
+		}
+
+		return true;
+	}
+
+	template <std::size_t P>
+	If<P == N> eval_postcond_iter(const ParserState&) const {
+		return success();
+	}
+
+	template <std::size_t P>
+	If<P < N> eval_postcond_iter(const ParserState& state) const {
+		auto res = std::get<P>(arg_parsers).eval_postcond(state);
+
+		return res.is_ok() ? eval_postcond_iter<P+1>(state) : res;
+	}
+
+public:
+	// whether argv can be split and parsed in parallel (see parse below)
+	static constexpr bool chunkable = ParsersChunkTraits<ArgParsers...>::chunkable;
+
+	static constexpr std::size_t max_arity = ParsersChunkTraits<ArgParsers...>::max_arity;
+
+	explicit Schema(ArgParsers... arg_parsers)
+		: arg_parsers(std::move(arg_parsers)...) {
+
+		assign_ids(BuildIndices<N>());
+	}
+
+	uint size() const {
+		return arg_count;
+	}
+
+
+	const std::tuple<ArgParsers...>& parsers() const {
+		return arg_parsers;
+	}
+
+
+	// marks parses into warm buffers as allocation-free: in builds with
+	// ARGS_ALLOC_AUDIT (see AllocAudit), a successful parse into Results that
+	// were already parsed into, with a reused state, reports its allocations
+	// and aborts, so that a test fails. The first parse into out sizes the
+	// buffers and isn't checked, nor are failed parses (messages allocate)
+	Schema& allocation_free(bool on = true) & {
+		alloc_free = on;
+		return *this;
+	}
+
+	Schema&& allocation_free(bool on = true) && {
+		alloc_free = on;
+		return std::move(*this);
+	}
+
+	bool is_allocation_free() const {
+		return alloc_free;
+	}
+
+
+	// parses into out, reusing its storage and the one of state
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out, OwnedParserState& state) const {
+
+		if (!alloc_free || !out.arg_parsers || !AllocAudit::enabled()) {
+			state.assign(argv_begin, argv_end);
+			return parse_state(state, out);
+		}
+
+		AllocAudit audit;
+
+		state.assign(argv_begin, argv_end);
+		parse_state(state, out);
+
+		audit.stop();
+
+		if (audit.count() != 0 && out.res.is_ok()) {
+			std::cerr << "allocation in a parse with an allocation-free schema: ";
+			audit.report(std::cerr);
+			std::abort();
+		}
+
+		return out.res;
+	}
+
+	// Parses a very long argv into out using all the threads of the pool. argv
+	// is cut into chunks of at least min_chunk_tokens tokens where no argument
+	// can span two chunks, the chunks are parsed independently and their
+	// results are concatenated before evaluating the postconditions. This needs
+	// stateless preconditions and arguments that consume a bounded number of
+	// tokens (see chunkable), otherwise it's the same as the serial parse.
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out, ThreadPool& pool,
+			std::size_t min_chunk_tokens = 1 << 14) const {
+
+		OwnedParserState state(argv_begin, argv_end);
+		const auto& argv = state.argv;
+
+		std::size_t chunk_count = std::min(pool.size(),
+				argv.size() / std::max<std::size_t>(min_chunk_tokens, 1));
+
+		if (!chunkable || chunk_count < 2)
+			return parse_state(state, out);
+
+		ARGS_TIME_PARSE();
+
+		std::vector<std::size_t> bounds { 0 };
+
+		for (std::size_t c = 1; c < chunk_count; c++) {
+			std::size_t k = std::max(c * argv.size() / chunk_count, bounds.back() + 1);
+
+			while (k < argv.size() && !chunk_boundary(state, k))
+				k++;
+
+			if (k < argv.size())
+				bounds.push_back(k);
+		}
+
+		bounds.push_back(argv.size());
+		chunk_count = bounds.size() - 1;
+
+		std::vector<Results<ArgParsers...>> chunks(chunk_count);
+		std::vector<OwnedParserState> chunk_states(chunk_count);
+
+		pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+			auto& chunk_state = chunk_states[c];
+
+			chunk_state.assign(begin(argv) + bounds[c], begin(argv) + bounds[c+1]);
+			chunk_state.end_of_flags = state.end_of_flags_pos < bounds[c];
+			chunk_state.owned_matched_args.keep_positions(
+					state.owned_matched_args.keeps_positions());
+
+			chunks[c].clear(&arg_parsers, arg_count);
+			parse_tokens(chunk_state, chunks[c]);
+		});
+
+		out.clear(&arg_parsers, arg_count);
+
+		std::vector<std::vector<std::size_t>> bases(chunk_count);
+
+		for (std::size_t c = 0; c < chunk_count; c++) {
+			if (!chunks[c].res.is_ok()) {
+				out.res = std::move(chunks[c].res);
+				return out.res;
+			}
+
+			for (uint i = 0; i < arg_count; i++)
+				out.counts[i] += chunks[c].counts[i];
+
+			state.owned_matched_args.append(chunk_states[c].owned_matched_args, bounds[c]);
+
+			ChunkSizeValues size_values { bases[c] };
+			zip_nested(size_values, chunks[c].values, out.values);
+		}
+
+		pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+			ChunkMoveValues move_values { bases[c] };
+			zip_nested(move_values, chunks[c].values, out.values);
+		});
+
+		state.pos = argv.size();
+		state.end_of_flags = chunk_states.back().end_of_flags;
+		state.counts = out.counts.data();
+		state.count_size = arg_count;
+
+		out.res = eval_postcond_iter<0>(state);
+		return out.res;
+	}
+
+	// parses into out, reusing its storage
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out) const {
+
+		OwnedParserState state;
+		return parse(argv_begin, argv_end, out, state);
+	}
+
+	template <typename InputIt>
+	Results<ArgParsers...> parse(InputIt argv_begin, InputIt argv_end) const {
+		Results<ArgParsers...> out;
+		parse(argv_begin, argv_end, out);
+		return out;
+	}
+};
+
+
+template <typename... ArgParsers>
+Schema<ArgParsers...> schema(const ArgParsers&... arg_parsers) {
+	return Schema<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
+
+
+
+namespace args {
+
+// Values of one argument for every line of a batch. The values of line i are
+// values[offsets[i]] to values[offsets[i+1]-1], lines that failed have none.
+template <typename T>
+struct Column {
+	std::vector<T> values;
+	std::vector<std::size_t> offsets;
+
+	std::size_t count(std::size_t line) const {
+		return offsets[line+1] - offsets[line];
+	}
+};
+
+// Part of a Column built by one task, with the number of values per line
+template <typename T>
+struct ColumnChunk {
+	std::vector<T> values;
+	std::vector<uint> counts;
+};
+
+
+template <typename... ArgParsers>
+class BatchResults {
+	template <typename... Ps>
+	friend BatchResults<Ps...> parse_batch(const Schema<Ps...>&,
+			const std::vector<StrView>&, ThreadPool&, std::size_t);
+
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	using Columns = std::tuple<typename ArgParsers::template Slots<Column>...>;
+
+	const std::tuple<ArgParsers...>* arg_parsers = nullptr;
+	Columns columns;
+
+
+	template <typename A>
+	using ColumnPtr = const Column<typename A::value_type>*;
+
+	template <std::size_t P, typename A>
+	If<P == N, ColumnPtr<A>> find_column_iter(const A&) const {
+		return nullptr;
+	}
+
+	template <std::size_t P, typename A>
+	If<P < N, ColumnPtr<A>> find_column_iter(const A& arg) const {
+		auto found = std::get<P>(*arg_parsers).template find_slot<Column>(
+				arg, std::get<P>(columns));
+
+		return found ? found : find_column_iter<P+1>(arg);
+	}
+
+public:
+	// ParseError type index of every line, 0 (Nothing) on success
+	std::vector<unsigned char> status;
+
+	// errors of the lines that failed, ordered by line
+	std::vector<std::pair<std::size_t, ParseError>> errors;
+
+
+	std::size_t size() const {
+		return status.size();
+	}
+
+	bool is_ok(std::size_t line) const {
+		return status[line] == 0;
+	}
+
+	// values of arg for all lines. arg must be part of the schema
+	template <typename A>
+	const Column<typename A::value_type>& operator[] (const A& arg) const {
+		static const Column<typename A::value_type> none;
+
+		auto found = arg_parsers ? find_column_iter<0>(arg) : nullptr;
+
+		return found ? *found : none;
+	}
+};
+
+
+template <typename... ArgParsers>
+struct BatchChunk {
+	using ChunkColumns = std::tuple<typename ArgParsers::template Slots<ColumnChunk>...>;
+
+	ChunkColumns columns;
+	std::vector<std::size_t> bases;
+	std::vector<std::pair<std::size_t, ParseError>> errors;
+};
+
+template <typename... ArgParsers>
+struct BatchWorker {
+	Results<ArgParsers...> results;
+	OwnedParserState state;
+	std::vector<StrView> tokens;
+};
+
+
+// appends the results of a line to the columns of its chunk
+struct BatchAppendLine {
+	bool ok;
+
+	template <typename T>
+	void operator() (const std::vector<T>& values, ColumnChunk<T>& column) {
+		if (ok) {
+			column.values.insert(end(column.values), begin(values), end(values));
+			column.counts.push_back(values.size());
+		} else {
+			column.counts.push_back(0);
+		}
+	}
+};
+
+// computes where the values of every chunk go in the final columns
+struct BatchSizeColumns {
+	std::vector<std::size_t>& bases;
+
+	template <typename T>
+	void operator() (const ColumnChunk<T>& chunk, Column<T>& column) {
+		bases.push_back(column.values.size());
+		column.values.resize(column.values.size() + chunk.values.size());
+	}
+};
+
+// moves the values of a chunk to the final columns
+struct BatchMoveChunk {
+	const std::vector<std::size_t>& bases;
+	std::size_t first_line;
+	std::size_t arg;
+
+	BatchMoveChunk(const std::vector<std::size_t>& bases, std::size_t first_line)
+		: bases(bases)
+		, first_line(first_line)
+		, arg(0) {}
+
+	template <typename T>
+	void operator() (ColumnChunk<T>& chunk, Column<T>& column) {
+		std::size_t base = bases[arg++];
+
+		std::move(begin(chunk.values), end(chunk.values), begin(column.values) + base);
+
+		for (std::size_t i = 0; i < chunk.counts.size(); i++) {
+			column.offsets[first_line + i] = base;
+			base += chunk.counts[i];
+		}
+
+		chunk.values = std::vector<T>();
+	}
+};
+
+struct BatchFinishColumns {
+	std::size_t lines;
+
+	template <typename T>
+	void operator() (const ColumnChunk<T>&, Column<T>& column) {
+		column.offsets.resize(lines + 1);
+		column.offsets[lines] = column.values.size();
+	}
+};
+
+
+// Parses every line (split into words) against the schema using all the
+// threads of the pool, chunk_lines lines per task. The results are stored by
+// argument (see Column) in the order of the lines.
+template <typename... ArgParsers>
+BatchResults<ArgParsers...> parse_batch(const Schema<ArgParsers...>& schema,
+		const std::vector<StrView>& lines, ThreadPool& pool,
+		std::size_t chunk_lines = 1024) {
+
+	using Chunk = BatchChunk<ArgParsers...>;
+	using Worker = BatchWorker<ArgParsers...>;
+
+	BatchResults<ArgParsers...> out;
+	out.arg_parsers = &schema.parsers();
+	out.status.resize(lines.size());
+
+	std::size_t chunk_count = (lines.size() + chunk_lines - 1) / chunk_lines;
+
+	std::vector<Chunk> chunks(chunk_count);
+	std::vector<Worker> workers(pool.size());
+
+	pool.run(chunk_count, [&](std::size_t w, std::size_t c) {
+		auto& worker = workers[w];
+		auto& chunk = chunks[c];
+
+		std::size_t first = c * chunk_lines;
+		std::size_t last = std::min(lines.size(), first + chunk_lines);
+
+		for (std::size_t i = first; i < last; i++) {
+			worker.tokens.clear();
+			split_words(lines[i], worker.tokens);
+
+			const auto& res = schema.parse(
+				begin(worker.tokens), end(worker.tokens),
+				worker.results, worker.state);
+
+			out.status[i] = static_cast<unsigned char>(res.data.which());
+
+			if (!res.is_ok())
+				chunk.errors.emplace_back(i, res);
+
+			BatchAppendLine append { res.is_ok() };
+			zip_nested(append, worker.results.all_values(), chunk.columns);
+		}
+	});
+
+	for (auto& chunk : chunks) {
+		BatchSizeColumns size_columns { chunk.bases };
+		zip_nested(size_columns, chunk.columns, out.columns);
+
+		out.errors.insert(end(out.errors),
+				begin(chunk.errors), end(chunk.errors));
+	}
+
+	if (chunk_count > 0) {
+		BatchFinishColumns finish { lines.size() };
+		zip_nested(finish, chunks[0].columns, out.columns);
+	}
+
+	pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+		BatchMoveChunk move_chunk { chunks[c].bases, c * chunk_lines };
+		zip_nested(move_chunk, chunks[c].columns, out.columns);
+	});
+
+	return out;
+}
+
+// same as above with the lines of text (e.g. a MappedFile)
+template <typename... ArgParsers>
+BatchResults<ArgParsers...> parse_batch(const Schema<ArgParsers...>& schema,
+		StrView text, ThreadPool& pool, std::size_t chunk_lines = 1024) {
+
+	std::vector<StrView> lines;
+	split_lines(text, lines);
+
+	return parse_batch(schema, lines, pool, chunk_lines);
+}
+
+}
+
+#endif
+
+#ifndef ARGS_GRAMMAR_H
+#define ARGS_GRAMMAR_H
+
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+
+
+namespace args {
+
+// Positional arguments that are matched in declaration order, each any number
+// of times its conditions allow, where the parse may go back on a choice. With
+// a plain parse (args::parse(argv_begin, argv_end, ..., grammar)) it is a
+// greedy ArgParser, so "SRC... DST" can't be parsed: SRC takes every token.
+// Parsed with args::parse(grammar, ...) the positional tokens are split
+// between the arguments by a depth-first search, which goes on to the next
+// argument when taking one more token fails later on. Failed states (token,
+// argument, matches of the argument) are remembered, so every state is
+// explored at most once. The matches are part of the state since conditions
+// look at them, so there can be up to tokens * arguments * matches states:
+// linear in the tokens when a single argument repeats (SRC... DST), but
+// quadratic when two do (A... B... C), which lookahead_limit bounds.
+//
+// An argument's postcondition is checked when the search moves past it, so it
+// can only rely on the matches of the arguments before it (and on the other
+// parsers, see parse). Preconditions and postconditions that only look at the
+// argument's own multiplicity (min, max, between, exactly) always work.
+template <typename... ArgTs>
+class Grammar : public ArgParser<ArgTs...> {
+	static constexpr std::size_t N = sizeof...(ArgTs);
+
+	// states explored before giving up
+	std::size_t step_limit = 1 << 20;
+
+
+	// a state of the search: the argument k may match the token pos, and has
+	// been matched m times
+	struct Frame {
+		uint pos;
+		uint k;
+		uint m;
+
+		// 0: nothing tried, 1: matched arg k, 2: moved to arg k+1, 3: failed
+		unsigned char choice;
+		bool pushed;
+		std::size_t match_count;
+	};
+
+	// the state of f within its argument (see failed_at), pos and m are
+	// both 32 bits wide so it's exact
+	static std::uint64_t key(const Frame& f) {
+		return (std::uint64_t(f.pos) << 32) | f.m;
+	}
+
+
+	// matches arg at clone.pos, storing the value like ArgSink
+	struct Match {
+		ParserState& clone;
+		OwnedParserState& state;
+		ParseResultVoid res;
+
+		template <typename A>
+		void operator() (A& arg) {
+			const auto& c_arg = arg;
+			res = arg.precond(c_arg, clone);
+
+			if (!res.is_ok())
+				return;
+
+			auto parsed = arg.parse_impl(clone);
+
+			if (!parsed.is_ok()) {
+				res = std::move(parsed.get_err());
+				res.set_arg(&arg);
+				return;
+			}
+
+			arg.result.emplace_back(std::move(parsed.get_ok()));
+			arg.multiplicity++;
+			arg.origin = Origin::Argv;
+			state.owned_matched_args.add(arg, state.pos);
+		}
+	};
+
+	struct Unmatch {
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.result.pop_back();
+
+			if (--arg.multiplicity == 0)
+				arg.origin = Origin::None;
+		}
+	};
+
+	struct Postcond {
+		const ParserState& state;
+		ParseResultVoid res;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			res = arg.postcond(arg, state);
+
+			if (!res.is_ok())
+				res.set_arg(&arg);
+		}
+	};
+
+	struct Multiplicity {
+		uint m;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			m = arg.multiplicity;
+		}
+	};
+
+
+	template <std::size_t I, typename F>
+	If<I == N, void> apply_iter(std::size_t, F&) const {
+	}
+
+	template <std::size_t I, typename F>
+	If<I < N, void> apply_iter(std::size_t k, F& f) const {
+		if (k == I)
+			f(std::get<I>(this->const_args));
+		else
+			apply_iter<I+1>(k, f);
+	}
+
+	// calls f(arg) for the argument k
+	template <typename F>
+	void apply(std::size_t k, F& f) const {
+		apply_iter<0>(k, f);
+	}
+
+	uint multiplicity(std::size_t k) const {
+		Multiplicity get { 0 };
+
+		if (k < N)
+			apply(k, get);
+
+		return get.m;
+	}
+
+	// postconditions of the arguments from k on, when no token is left
+	ParseResultVoid accept(const ParserState& state, std::size_t k) const {
+		for (; k < N; k++) {
+			Postcond check { state, success() };
+			apply(k, check);
+
+			if (!check.res.is_ok())
+				return check.res;
+		}
+
+		return success();
+	}
+
+public:
+	using ArgParser<ArgTs...>::ArgParser;
+
+
+	// number of states the search may explore before it fails
+	Grammar& lookahead_limit(std::size_t steps) & {
+		step_limit = steps;
+		return *this;
+	}
+
+	Grammar&& lookahead_limit(std::size_t steps) && {
+		step_limit = steps;
+		return std::move(*this);
+	}
+
+
+	// matches every remaining token of state, which must all be positional.
+	// On failure, the error is the one found at the furthest token
+	ParseResultVoid parse_all(OwnedParserState& state) const {
+		const uint end = state.argv.size();
+
+		std::vector<Frame> stack;
+
+		// the failed states of every argument k (up to N), see key
+		std::vector<std::unordered_set<std::uint64_t>> failed_at(N + 1);
+		std::size_t steps = 0;
+
+		ParseResultVoid error = success();
+		uint error_pos = 0;
+
+		auto fail_at = [&](uint pos, ParseResultVoid res) {
+			if (error.is_ok() || pos > error_pos) {
+				error = std::move(res);
+				error_pos = pos;
+			}
+		};
+
+		stack.push_back(Frame { state.pos, 0, multiplicity(0), 0, false, state.matched_args.size() });
+
+		while (!stack.empty()) {
+			std::size_t top = stack.size() - 1;
+			Frame f = stack[top];
+
+			if (f.choice == 0) {
+				stack[top].choice = 1;
+
+				if (f.pos == end) {
+					state.pos = end;
+					auto res = accept(state, f.k);
+
+					if (res.is_ok())
+						return res;
+
+					fail_at(f.pos, std::move(res));
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (failed_at[f.k].count(key(f))) {
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (f.k == N) {
+					state.pos = f.pos;
+					fail_at(f.pos, ParseError(UnknownArg(state)));
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (++steps > step_limit) {
+					state.pos = f.pos;
+					return ParseError(InvalidParam("too ambiguous to parse", state.arg()));
+				}
+
+				state.pos = f.pos;
+				state.str_off = 0;
+
+				auto clone = ParserState(state);
+				Match match { clone, state, success() };
+				apply(f.k, match);
+
+				if (match.res.is_ok()) {
+					stack[top].pushed = true;
+
+					if (clone.pos > f.pos && clone.str_off == 0) {
+						stack.push_back(Frame { clone.pos, f.k, f.m + 1, 0, false, state.matched_args.size() });
+						continue;
+					}
+				} else if (!is<CondFailed>(match.res)) {
+					// a failed precondition only means that the next argument must match
+					fail_at(f.pos, std::move(match.res));
+				}
+			}
+
+			if (f.choice <= 1) {
+				stack[top].choice = 2;
+
+				if (stack[top].pushed) {
+					Unmatch unmatch;
+					apply(f.k, unmatch);
+					state.owned_matched_args.truncate(f.match_count);
+					stack[top].pushed = false;
+				}
+
+				Postcond check { state, success() };
+				apply(f.k, check);
+
+				if (check.res.is_ok()) {
+					stack.push_back(Frame { f.pos, f.k + 1, multiplicity(f.k + 1), 0, false, f.match_count });
+					continue;
+				}
+
+				fail_at(f.pos, std::move(check.res));
+			}
+
+			if (f.pos != end)
+				failed_at[f.k].insert(key(f));
+
+			stack.pop_back();
+		}
+
+		return error;
+	}
+};
+
+
+template <typename... ArgTs>
+Grammar<ArgTs...> grammar(ArgTs&... args) {
+	return Grammar<ArgTs...>(args...);
+}
+
+
+// like parse, but the positional tokens that the parsers don't take (every
+// token after "--", "-" and the ones that don't start with '-') are left to
+// grammar, which matches them after the other tokens with backtracking (see
+// Grammar). Positions in the values of its arguments (e.g. ArgSpan) are
+// relative to these tokens.
+template <typename... ArgTs, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(const Grammar<ArgTs...>& grammar,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
+	OwnedParserState state(argv_begin, argv_end);
+	std::vector<StrView> positionals;
+
+	while (state.pos < state.argv.size()) {
+		auto res = parse_iter(state, arg_parsers...);
+
+		auto token_class = state.str_off == 0
+			? state.token_class()
+			: TokenClass::ShortoptCluster;
+
+		bool positional = state.end_of_flags
+			|| token_class == TokenClass::Positional
+			|| token_class == TokenClass::Dash;
+
+		if (is<UnknownArg>(res) && positional) {
+			positionals.push_back(state.arg_next());
+			continue;
+		}
+
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers..., grammar);
+
+		if (!res.is_ok())
+			return res;
+	}
+
+	OwnedParserState rest(positionals.begin(), positionals.end());
+	rest.end_of_flags = true;
+	rest.owned_matched_args.append(state.matched_args);
+
+	auto res = grammar.parse_all(rest);
+
+	return res.is_ok()? eval_postcond_iter(rest, arg_parsers..., grammar) : res;
+}
+
+}
+
+#endif
+
+#ifndef ARGS_INCREMENTAL_H
+#define ARGS_INCREMENTAL_H
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+
+
+namespace args {
+
+// Whether results of type T may be views into the tokens they were parsed
+// from (StrView, Lazy, and any type not known to own its data)
+template <typename T, typename Enable = void>
+struct HoldsTokenViews : std::true_type {};
+
+template <typename T>
+struct HoldsTokenViews<T, typename std::enable_if<
+		std::is_arithmetic<T>::value || std::is_enum<T>::value
+	>::type> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<Str> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<PolyString> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<ArgSpan> : std::false_type {};
+
+template <PathKind K>
+struct HoldsTokenViews<CheckedPath<K>> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<std::tuple<>> : std::false_type {};
+
+template <typename T, typename... Ts>
+struct HoldsTokenViews<std::tuple<T, Ts...>> : std::integral_constant<bool,
+	HoldsTokenViews<T>::value || HoldsTokenViews<std::tuple<Ts...>>::value> {};
+
+
+// Parses a command line that is edited over time (e.g. validated as the user
+// types it). The state is checkpointed at every token boundary the parse
+// reaches, and after an edit the parse resumes from the last checkpoint before
+// the first changed token, so only the changed suffix is parsed again.
+// Every update splits its command into a chunk of its own, which is kept while
+// results that may view it (see HoldsTokenViews) are. Arguments must store
+// their results in themselves (no Schema), and parsers must not look at tokens
+// past the ones they consume.
+template <typename... ArgParsers>
+class IncrementalSession {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	struct Checkpoint {
+		uint pos;
+		bool end_of_flags;
+		std::size_t match_count;
+		std::size_t views;  // results that may view their chunk
+		std::size_t chunks; // chunks those results view
+	};
+
+	// the command of an update and its unescaped words
+	struct Chunk {
+		std::string line;
+		std::string buffer;
+	};
+
+	// multiplicity and result count of every argument at a checkpoint
+	struct Marks {
+		std::vector<uint>& marks;
+		std::size_t views;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			marks.push_back(arg.multiplicity);
+			marks.push_back(arg.result.size());
+
+			if (HoldsTokenViews<typename A::value_type>::value)
+				views += arg.result.size();
+		}
+	};
+
+	struct Rewind {
+		const uint* marks;
+
+		template <typename A>
+		void operator() (A& arg) {
+			arg.multiplicity = marks[0];
+			arg.result.erase(begin(arg.result) + marks[1], end(arg.result));
+
+			if (arg.multiplicity == 0)
+				arg.origin = Origin::None;
+
+			marks += 2;
+		}
+	};
+
+	std::tuple<ArgParsers&...> arg_parsers;
+	OwnedParserState state;
+
+	// a deque, so that the strings of a chunk never move
+	std::deque<Chunk> chunks;
+	std::vector<std::size_t> word_ends;
+
+	std::vector<Checkpoint> checkpoints;
+	std::vector<uint> marks;
+	std::size_t marks_per_checkpoint = 0;
+
+	bool started = false;
+	std::size_t reparsed = 0;
+
+
+	template <std::size_t... Is>
+	void checkpoint(Indices<Is...>) {
+		Marks add { marks, 0 };
+
+		int expand[] = { 0, (std::get<Is>(arg_parsers).for_each_arg(add), 0)... };
+		(void) expand;
+
+		// the results parsed since the last checkpoint only need the current
+		// chunk if some of them may view it
+		std::size_t needed = chunks.size();
+
+		if (!checkpoints.empty() && checkpoints.back().views == add.views)
+			needed = checkpoints.back().chunks;
+
+		checkpoints.push_back(Checkpoint {
+			state.pos,
+			state.end_of_flags,
+			state.matched_args.size(),
+			add.views,
+			needed
+		});
+	}
+
+	template <std::size_t... Is>
+	void rewind(std::size_t c, Indices<Is...>) {
+		const Checkpoint& cp = checkpoints[c];
+
+		Rewind apply { &marks[c * marks_per_checkpoint] };
+
+		int expand[] = { 0, (std::get<Is>(arg_parsers).for_each_arg(apply), 0)... };
+		(void) expand;
+
+		state.rewind(cp.pos, cp.end_of_flags, cp.match_count);
+
+		checkpoints.resize(c + 1);
+		marks.resize((c + 1) * marks_per_checkpoint);
+	}
+
+	template <std::size_t... Is>
+	void start(Indices<Is...>) {
+		args::reset(std::get<Is>(arg_parsers)...);
+		ARGS_NUMBER_ARGS(std::get<Is>(arg_parsers)...);
+
+		checkpoint(Indices<Is...>());
+		marks_per_checkpoint = marks.size();
+		started = true;
+	}
+
+	template <std::size_t... Is>
+	ParseResultVoid parse_suffix(Indices<Is...> indices) {
+		uint from = state.pos;
+
+		while (state.pos < state.argv.size()) {
+			auto res = parse_iter(state, std::get<Is>(arg_parsers)...);
+
+			if (is<UnknownArg>(res))
+				args::suggest(res.template get<UnknownArg>(), std::get<Is>(arg_parsers)...);
+
+			if (!res.is_ok()) {
+				reparsed = state.pos - from;
+				return res;
+			}
+
+			if (state.str_off == 0)
+				checkpoint(indices);
+		}
+
+		reparsed = state.pos - from;
+
+		return eval_postcond_iter(state, std::get<Is>(arg_parsers)...);
+	}
+
+	// the first token that may differ between the last line and command
+	std::size_t first_changed_token(StrView command) const {
+		StrView line = chunks.empty() ? StrView() : StrView(chunks.back().line);
+
+		std::size_t n = std::min(line.size(), command.size());
+		std::size_t prefix = 0;
+
+		while (prefix < n && line[prefix] == command[prefix])
+			prefix++;
+
+		// a token that ends where the lines start to differ may be extended
+		return std::lower_bound(begin(word_ends), end(word_ends), prefix) - begin(word_ends);
+	}
+
+public:
+	explicit IncrementalSession(ArgParsers&... arg_parsers)
+		: arg_parsers(arg_parsers...) {}
+
+	IncrementalSession(IncrementalSession&&) = default;
+
+
+	// parses command (split like a shell would, see split_shell) from the
+	// last checkpoint that the edit from the previous command didn't affect.
+	// Views into the command in the results stay valid as long as the results
+	// are kept, i.e. until an update changes their tokens or reset()
+	ParseResultVoid update(StrView command) {
+		ARGS_TIME_PARSE();
+
+		if (!started)
+			start(BuildIndices<N>());
+
+		std::size_t changed = first_changed_token(command);
+
+		// the last checkpoint at or before the first changed token
+		std::size_t c = checkpoints.size() - 1;
+
+		while (checkpoints[c].pos > changed)
+			c--;
+
+		rewind(c, BuildIndices<N>());
+
+		// the earlier chunks stay where the kept results view them
+		chunks.resize(checkpoints[c].chunks);
+		chunks.emplace_back();
+
+		Chunk& chunk = chunks.back();
+		chunk.line.assign(command.c_str(), command.size());
+
+		if (!state.replace_command(chunk.line, chunk.buffer, &word_ends)) {
+			rewind(0, BuildIndices<N>());
+			reparsed = 0;
+			return ParseError(InvalidParam("unterminated quote or escape", chunk.line));
+		}
+
+		return parse_suffix(BuildIndices<N>());
+	}
+
+	// forgets every checkpoint and result, the next update parses from scratch
+	void reset() {
+		started = false;
+		chunks.clear();
+		word_ends.clear();
+		checkpoints.clear();
+		marks.clear();
+		state.rewind(0, false, 0);
+	}
+
+	// tokens parsed by the last update
+	std::size_t tokens_reparsed() const {
+		return reparsed;
+	}
+
+	const ParserState& last_state() const {
+		return state;
+	}
+};
+
+
+template <typename... ArgParsers>
+IncrementalSession<ArgParsers...> incremental_session(ArgParsers&... arg_parsers) {
+	return IncrementalSession<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
+
+#ifndef ARGS_PARSE_SESSION_H
+#define ARGS_PARSE_SESSION_H
+
+#include <string>
+#include <tuple>
+
+
+
+namespace args {
+
+// Parses many argvs with the same parsers, e.g. in a long-running service.
+// Every parse resets the arguments and reuses the storage of the previous
+// ones (argv views, matched arguments and result vectors), so once the
+// buffers are large enough no memory is allocated other than for string
+// results and error messages.
+template <typename... ArgParsers>
+class ParseSession {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	std::tuple<ArgParsers&...> arg_parsers;
+	OwnedParserState state;
+	std::string command_buffer;
+
+
+	template <std::size_t... Is>
+	void reset(Indices<Is...>) {
+		args::reset(std::get<Is>(arg_parsers)...);
+	}
+
+	template <std::size_t... Is>
+	ParseResultVoid parse_argv(Indices<Is...>) {
+		auto res = args::parse_argv(state, std::get<Is>(arg_parsers)...);
+
+		return res.is_ok()
+			? eval_postcond_iter(state, std::get<Is>(arg_parsers)...)
+			: res;
+	}
+
+	template <typename Source, std::size_t... Is>
+	ParseResultVoid parse_argv_with(const Source& source, Indices<Is...>) {
+		auto res = args::parse_argv(state, std::get<Is>(arg_parsers)...);
+
+		if (res.is_ok())
+			res = apply_source(source, state, std::get<Is>(arg_parsers)...);
+
+		return res.is_ok()
+			? eval_postcond_iter(state, std::get<Is>(arg_parsers)...)
+			: res;
+	}
+
+public:
+	explicit ParseSession(ArgParsers&... arg_parsers)
+		: arg_parsers(arg_parsers...) {}
+
+	ParseSession(ParseSession&&) = default;
+
+
+	// forgets the results of the previous parse
+	void reset() {
+		reset(BuildIndices<N>());
+	}
+
+	template <typename InputIt>
+	ParseResultVoid parse(InputIt argv_begin, InputIt argv_end) {
+		ARGS_TIME_PARSE();
+
+		reset();
+		state.assign(argv_begin, argv_end);
+
+		return parse_argv(BuildIndices<N>());
+	}
+
+	template <typename Source, typename InputIt>
+	ParseResultVoid parse_with(const Source& source,
+			InputIt argv_begin, InputIt argv_end) {
+
+		ARGS_TIME_PARSE();
+
+		reset();
+		state.assign(argv_begin, argv_end);
+
+		return parse_argv_with(source, BuildIndices<N>());
+	}
+
+	// parses a command line given as a single string, split like a shell
+	// would (see split_shell)
+	ParseResultVoid parse_command(StrView command) {
+		ARGS_TIME_PARSE();
+
+		reset();
+
+		if (!state.assign_command(command, command_buffer))
+			return ParseError(InvalidParam("unterminated quote or escape", command));
+
+		return parse_argv(BuildIndices<N>());
+	}
+
+	// state of the last parse (e.g. to inspect the matched arguments)
+	const ParserState& last_state() const {
+		return state;
+	}
+};
+
+
+template <typename... ArgParsers>
+ParseSession<ArgParsers...> session(ArgParsers&... arg_parsers) {
+	return ParseSession<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
+
+#ifndef ARGS_RESULT_CACHE_H
+#define ARGS_RESULT_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+
+
+#ifndef ARGS_HASH_H
+#define ARGS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+namespace args {
+
+// 64-bit FNV-1a, for cache keys and fingerprints (not for untrusted input)
+class Fnv1a {
+	std::uint64_t h;
+
+public:
+	static constexpr std::uint64_t offset_basis = 14695981039346656037ull;
+	static constexpr std::uint64_t prime = 1099511628211ull;
+
+	explicit Fnv1a(std::uint64_t seed = offset_basis)
+		: h(seed) {}
+
+	Fnv1a& add(const void* data, std::size_t size) {
+		auto p = static_cast<const unsigned char*>(data);
+
+		for (std::size_t i = 0; i < size; i++) {
+			h ^= p[i];
+			h *= prime;
+		}
+
+		return *this;
+	}
+
+	// the size is hashed too, so that ("ab", "c") and ("a", "bc") differ
+	Fnv1a& add(const StrView& s) {
+		add_u64(s.size());
+		return add(s.c_str(), s.size());
+	}
+
+	Fnv1a& add_u64(std::uint64_t value) {
+		return add(&value, sizeof value);
+	}
+
+	std::uint64_t value() const {
+		return h;
+	}
+};
+
+}
+
+#endif
+
+#ifndef ARGS_MAPPED_FILE_H
+#define ARGS_MAPPED_FILE_H
+
+#include <cstddef>
+
+
+
+namespace args {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+	const char* m_data = nullptr;
+	std::size_t m_size = 0;
+	bool m_open = false;
+
+public:
+	MappedFile() = default;
+
+	explicit MappedFile(const char* path);
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator= (MappedFile&& other);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator= (const MappedFile&) = delete;
+
+	~MappedFile();
+
+
+	bool is_open() const {
+		return m_open;
+	}
+
+	StrView data() const {
+		return StrView(m_data ? m_data : "", m_size);
+	}
+
+	void close();
+};
+
+}
+
+#endif
+
+
+namespace args {
+
+// Something the results of a parse depend on besides argv: a file (e.g. a
+// path a validator resolved) or an environment variable, with a stamp of its
+// state (file metadata, variable value) when the results were cached
+struct CacheDependency {
+	enum class Kind : std::uint8_t { File, Env };
+
+	Kind kind;
+	Str name;
+	std::uint64_t stamp;
+};
+
+std::uint64_t file_stamp(const Str& path);
+
+std::uint64_t env_stamp(const Str& name);
+
+// Records the dependencies of the results of a parse made by parse_cached.
+// ParamParsers and arguments that look at files or the environment must call
+// these so that the cached results are discarded when those change: nothing
+// else detects it, and none of the built-in parameters report anything. The
+// checks of ExistingPath and friends are run by PathChecks after the parse,
+// so they are redone on every call and need no reporting, but custom
+// ParamParsers and LambdaArgs must report what they read. They do nothing
+// outside of parse_cached.
+void cache_depend_on_file(const Str& path);
+
+void cache_depend_on_env(const Str& name);
+
+
+// Collects the dependencies reported on this thread while it's alive
+class CacheRecorder {
+	CacheRecorder* previous;
+	std::vector<CacheDependency> deps;
+
+	friend void cache_depend_on_file(const Str&);
+	friend void cache_depend_on_env(const Str&);
+
+	void add(CacheDependency::Kind kind, const Str& name, std::uint64_t stamp);
+
+public:
+	CacheRecorder();
+
+	CacheRecorder(const CacheRecorder&) = delete;
+	CacheRecorder& operator= (const CacheRecorder&) = delete;
+
+	~CacheRecorder();
+
+	const std::vector<CacheDependency>& dependencies() const {
+		return deps;
+	}
+};
+
+
+// Directory of parse results (see parse_cached), one file per hash of the key
+// (argv and its context). An entry stores the whole key, and is only used if
+// the key is the same byte for byte and all its dependencies are unchanged.
+// Entries are replaced atomically, so concurrent processes can share the
+// directory. The directory must exist; failing to write an entry only makes
+// the next parse a miss.
+class ResultCache {
+	Str dir;
+	std::vector<Str> env_names;
+	std::uint64_t version;
+
+	// the entry of the last hit, which decoded views point into
+	MappedFile entry;
+
+	// the entry of the last load, until its results are decoded
+	MappedFile loaded;
+
+	std::size_t hit_count = 0;
+	std::size_t miss_count = 0;
+
+public:
+	// version is mixed into every key, to be bumped when the behavior of the
+	// arguments changes without changing their types or names
+	explicit ResultCache(Str dir, std::uint64_t version = 0);
+
+	// makes the value of an environment variable part of the key
+	ResultCache& env(Str name) {
+		env_names.push_back(std::move(name));
+		return *this;
+	}
+
+	// appends the program, the version and the environment variables of the
+	// key to key
+	void encode_context(std::string& key) const;
+
+	// maps the entry of key and checks it, payload is then the encoded results.
+	// The mapping of the last hit stays until keep_loaded() replaces it
+	bool load(const std::string& key, ByteReader& payload);
+
+	// makes the entry of the last load the one decoded views point into, once
+	// its results have been decoded
+	void keep_loaded() {
+		entry = std::move(loaded);
+	}
+
+	void store(const std::string& key,
+			const std::vector<CacheDependency>& deps, const std::string& payload);
+
+	void count(bool hit) {
+		(hit ? hit_count : miss_count)++;
+	}
+
+	std::size_t hits() const {
+		return hit_count;
+	}
+
+	std::size_t misses() const {
+		return miss_count;
+	}
+
+private:
+	Str entry_path(const std::string& key) const;
+};
+
+
+struct ResultEncoder {
+	std::string& out;
+
+	template <typename A>
+	void operator() (const A& arg) const {
+		using Codec = ResultCodec<typename A::value_type>;
+
+		ResultCodec<std::uint32_t>::encode(arg.multiplicity, out);
+		ResultCodec<Origin>::encode(arg.origin, out);
+		ResultCodec<std::uint32_t>::encode(arg.result.size(), out);
+
+		for (const auto& value : arg.result)
+			Codec::encode(value, out);
+	}
+};
+
+struct ResultDecoder {
+	ByteReader& in;
+	bool ok;
+
+	template <typename A>
+	void operator() (A& arg) {
+		using Codec = ResultCodec<typename A::value_type>;
+
+		std::uint32_t multiplicity, count;
+
+		ok = ok
+			&& ResultCodec<std::uint32_t>::decode(in, multiplicity)
+			&& ResultCodec<Origin>::decode(in, arg.origin)
+			&& ResultCodec<std::uint32_t>::decode(in, count);
+
+		for (std::uint32_t i = 0; ok && i < count; i++) {
+			typename A::value_type value;
+			ok = Codec::decode(in, value);
+
+			if (ok)
+				arg.result.push_back(std::move(value));
+		}
+
+		if (ok)
+			arg.multiplicity = multiplicity;
+	}
+};
+
+struct ArgFingerprint {
+	Fnv1a& h;
+
+	template <typename A>
+	void operator() (const A& arg) const {
+		h.add(typeid(typename A::value_type).name());
+		h.add(arg.to_str());
+		h.add(arg.source_key);
+	}
+};
+
+
+// hash of the types of the parsers and the names of their arguments, which
+// changes when the arguments or the types of their results do
+template <typename... ArgParsers>
+std::uint64_t cache_fingerprint(const ArgParsers&... arg_parsers) {
+	Fnv1a h;
+	ArgFingerprint add_arg { h };
+
+	int expand[] = { 0, (
+		h.add(typeid(ArgParsers).name()),
+		arg_parsers.for_each_arg(add_arg), 0)... };
+	(void) expand;
+
+	return h.value();
+}
+
+
+// Like parse, but the results are loaded from cache when the same argv (and
+// environment variables of cache, see ResultCache::env) has already been
+// parsed successfully by the same program, instead of being converted and
+// validated again. Postconditions are not evaluated again either. Failed
+// parses are not cached. The results of every argument need a ResultCodec.
+// Views in the results of a hit point into its entry, and are valid until the
+// next hit of cache.
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid parse_cached(ResultCache& cache,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
+
+	std::string key;
+	ResultCodec<std::uint64_t>::encode(cache_fingerprint(arg_parsers...), key);
+	cache.encode_context(key);
+
+	for (auto i = argv_begin; i != argv_end; ++i)
+		ResultCodec<StrView>::encode(StrView(*i), key);
+
+	ByteReader payload;
+
+	if (cache.load(key, payload)) {
+		reset(arg_parsers...);
+
+		ResultDecoder decoder { payload, true };
+
+		int expand[] = { 0, (arg_parsers.for_each_arg(decoder), 0)... };
+		(void) expand;
+
+		if (decoder.ok && payload.at_end()) {
+			cache.keep_loaded();
+			cache.count(true);
+			return success();
+		}
+	}
+
+	cache.count(false);
+	reset(arg_parsers...);
+
+	CacheRecorder recorder;
+	auto res = parse_impl(argv_begin, argv_end, arg_parsers...);
+
+	if (res.is_ok()) {
+		std::string encoded;
+		ResultEncoder encoder { encoded };
+
+		int expand[] = { 0, (arg_parsers.for_each_arg(encoder), 0)... };
+		(void) expand;
+
+		cache.store(key, recorder.dependencies(), encoded);
+	}
+
+	return res;
+}
+
+}
+
+#endif
+
+#ifndef ARGS_VALIDATION_H
+#define ARGS_VALIDATION_H
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+
+
+namespace args {
+
+// Check of every result of an argument, run after the parse by a
+// ValidationStage. check is called as check(const A::value_type&) and returns
+// a ParseResultVoid; it may be called by several threads at once.
+template <typename A, typename F>
+struct Validator {
+	A& arg;
+	F check;
+};
+
+template <typename A, typename F>
+Validator<A, F> validate(A& arg, F check) {
+	return Validator<A, F> { arg, std::move(check) };
+}
+
+
+// Runs expensive checks of the parse results (e.g. whether paths exist) in a
+// separate stage, on a ThreadPool, instead of during the serial token walk.
+// Every result of every validated argument is one task. The errors are
+// reported in argv order when the positions of the matches are known (see
+// parse_validated), otherwise in the order of the validators and results.
+template <typename... Validators>
+class ValidationStage {
+	static constexpr std::size_t N = sizeof...(Validators);
+
+	struct Failure {
+		uint pos;
+		std::size_t task;
+	};
+
+	std::tuple<Validators...> validators;
+
+	// first task of every validator, and the total at the end
+	std::vector<std::size_t> offsets;
+
+	// result of every task of the last run, and argv position of every task
+	std::vector<ParseError> task_errors;
+	std::vector<uint> task_pos;
+
+	std::vector<ParseError> failures;
+
+
+	template <std::size_t I>
+	If<I == N, void> count_tasks() {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> count_tasks() {
+		offsets[I+1] = offsets[I] + std::get<I>(validators).arg.result.size();
+		count_tasks<I+1>();
+	}
+
+	template <std::size_t I>
+	If<I == N, void> find_positions(const MatchLog&) {
+	}
+
+	// the k-th result of an argument comes from its k-th match
+	template <std::size_t I>
+	If<I < N, void> find_positions(const MatchLog& matched) {
+		const BaseArg* arg = &std::get<I>(validators).arg;
+		std::size_t task = offsets[I];
+		std::size_t i = 0;
+
+		for (const BaseArg* m : matched) {
+			if (m == arg && task < offsets[I+1])
+				task_pos[task++] = matched.position(i);
+
+			i++;
+		}
+
+		find_positions<I+1>(matched);
+	}
+
+	template <std::size_t I>
+	If<I == N, void> run_task(std::size_t) {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> run_task(std::size_t task) {
+		if (task >= offsets[I+1])
+			return run_task<I+1>(task);
+
+		auto& validator = std::get<I>(validators);
+		auto& err = task_errors[task];
+
+		err = validator.check(validator.arg.result[task - offsets[I]]);
+
+		if (!err.is_ok())
+			err.set_arg(&validator.arg);
+	}
+
+public:
+	explicit ValidationStage(Validators... validators)
+		: validators(std::move(validators)...)
+		, offsets(N + 1, 0) {}
+
+
+	// validates the current results of the arguments. state is the state of
+	// the parse, to order the errors by argv position
+	ParseResultVoid run(ThreadPool& pool, const ParserState* state = nullptr) {
+		count_tasks<0>();
+
+		std::size_t task_count = offsets[N];
+
+		task_errors.assign(task_count, success());
+		task_pos.assign(task_count, MatchLog::no_pos);
+		failures.clear();
+
+		if (state && state->matched_args.keeps_positions())
+			find_positions<0>(state->matched_args);
+
+		pool.run(task_count, [this](std::size_t, std::size_t task) {
+			run_task<0>(task);
+		});
+
+		std::vector<Failure> failed;
+
+		for (std::size_t task = 0; task < task_count; task++) {
+			if (!task_errors[task].is_ok())
+				failed.push_back(Failure { task_pos[task], task });
+		}
+
+		// values from sources have no position and go last
+		std::stable_sort(begin(failed), end(failed), [](const Failure& a, const Failure& b) {
+			return a.pos < b.pos;
+		});
+
+		for (const auto& f : failed)
+			failures.push_back(std::move(task_errors[f.task]));
+
+		return failures.empty() ? success() : failures.front();
+	}
+
+	// every error of the last run, in order
+	const std::vector<ParseError>& errors() const {
+		return failures;
+	}
+};
+
+template <typename... Validators>
+ValidationStage<Validators...> validation(Validators... validators) {
+	return ValidationStage<Validators...>(std::move(validators)...);
+}
+
+
+// like parse, then runs stage on pool if the parse succeeded. The first
+// validation error in argv order is returned, stage.errors() has all of them
+template <typename Stage, typename InputIt, typename... ArgParsers>
+ParseResultVoid parse_validated(Stage& stage, ThreadPool& pool,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	OwnedParserState state(argv_begin, argv_end);
+	state.owned_matched_args.keep_positions(true);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = eval_postcond_iter(state, arg_parsers...);
+
+	return res.is_ok() ? stage.run(pool, &state) : res;
+}
+
+}
+
+#endif
+
+#ifndef ARGS_VISITOR_H
+#define ARGS_VISITOR_H
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+
+namespace args {
+
+// Calls f with every value of arg, see visitor
+template <typename A, typename F>
+struct Handler {
+	using arg_type = A;
+
+	A& arg;
+	F f;
+};
+
+template <typename A, typename F>
+Handler<A, F> on(A& arg, F f) {
+	return Handler<A, F> { arg, std::move(f) };
+}
+
+
+// Hands the values of the arguments to their handlers as they are parsed,
+// instead of storing them in the arguments. Only the multiplicities, the
+// origins and the first match of every argument are kept (which is what the
+// conditions look at), so no memory is spent on the values. The parse still
+// copies argv into an OwnedParserState, a view and a token class per token.
+// Values of arguments without a handler are dropped.
+template <typename... Handlers>
+class Visitor {
+	static constexpr std::size_t N = sizeof...(Handlers);
+
+	std::tuple<Handlers...> handlers;
+
+
+	template <std::size_t J, typename A, typename T>
+	If<J == N, void> dispatch(A&, T&&) {
+	}
+
+	template <std::size_t J, typename A, typename T>
+	If<J < N, void> dispatch(A& arg, T&& value) {
+		using H = typename std::tuple_element<J, std::tuple<Handlers...>>::type;
+
+		if (!call_at(std::get<J>(handlers), arg, value, std::is_same<typename H::arg_type, A>()))
+			dispatch<J+1>(arg, std::forward<T>(value));
+	}
+
+	template <typename H, typename A, typename T>
+	static bool call_at(H& handler, const A& arg, T& value, std::true_type) {
+		if (&handler.arg != &arg)
+			return false;
+
+		handler.f(std::move(value));
+		return true;
+	}
+
+	template <typename H, typename A, typename T>
+	static bool call_at(H&, const A&, T&, std::false_type) {
+		return false;
+	}
+
+public:
+	explicit Visitor(Handlers... handlers)
+		: handlers(std::move(handlers)...) {}
+
+
+	// sink of ArgParser::parse
+	template <std::size_t I, typename A, typename T>
+	void push(A& arg, T&& value) {
+		arg.multiplicity++;
+		arg.origin = Origin::Argv;
+
+		dispatch<0>(arg, std::forward<T>(value));
+	}
+};
+
+
+template <typename... Handlers>
+Visitor<Handlers...> visitor(Handlers... handlers) {
+	return Visitor<Handlers...>(std::move(handlers)...);
+}
+
+
+template <typename... Handlers>
+ParseResultVoid parse_iter(OwnedParserState& state, Visitor<Handlers...>&) {
+	return ParseError(UnknownArg(state));
+}
+
+template <typename... Handlers, typename ArgParser, typename... ArgParsers>
+ParseResultVoid parse_iter(OwnedParserState& state, Visitor<Handlers...>& visitor,
+		ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+
+	auto res = arg_parser.parse(state, visitor);
+
+	return is<UnknownArg>(res)? parse_iter(state, visitor, arg_parsers...) : res;
+}
+
+
+// like parse, but the values are given to the handlers of visitor in argv
+// order as soon as they are parsed (so before the errors of later tokens and
+// the postconditions are found), and are not stored in the arguments:
+//
+//     auto res = args::parse(args::visitor(
+//             args::on(include_flag, [&](std::tuple<StrView> t) { ... }),
+//             args::on(file_arg, [&](std::string file) { ... })),
+//         argv+1, argv+argc, flag_parser, arg_parser);
+template <typename... Handlers, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(Visitor<Handlers...> visitor,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
+	OwnedParserState state(argv_begin, argv_end);
+	state.owned_matched_args.keep_runs(false);
+
+	while (state.pos < state.argv.size()) {
+		auto res = parse_iter(state, visitor, arg_parsers...);
+
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers...);
+
+		if (!res.is_ok())
+			return res;
+	}
+
+	return eval_postcond_iter(state, arg_parsers...);
+}
+
+}
+
+#endif
+
+
+#ifndef ARGS_DISPLAY_COMPLETE_H
+#define ARGS_DISPLAY_COMPLETE_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+
+
+
+namespace args {
+
+inline bool completion_less(const StrView& a, const StrView& b) {
+	return a < b;
+}
+
+inline bool completion_equal(const StrView& a, const StrView& b) {
+	return a == b;
+}
+
+template <typename ArgParser>
+void complete_names(StrView partial, std::vector<StrView>& out, const ArgParser& parser) {
+	auto range = parser.names().prefix_range(partial);
+	out.insert(end(out), range.first, range.second);
+}
+
+
+// appends the longopts and keywords of parsers starting with partial to out,
+// sorted and without duplicates
+template <typename... ArgParsers>
+void complete(StrView partial, std::vector<StrView>& out, const ArgParsers&... parsers) {
+	auto first = out.size();
+
+	int expand[] = { 0, (complete_names(partial, out, parsers), 0)... };
+	(void) expand;
+
+	if (sizeof...(ArgParsers) > 1) {
+		std::sort(begin(out) + first, end(out), completion_less);
+		out.erase(std::unique(begin(out) + first, end(out), completion_equal), end(out));
+	}
+}
+
+template <typename... ArgParsers, std::size_t... Ps>
+void complete_schema(StrView partial, std::vector<StrView>& out,
+		const Schema<ArgParsers...>& schema, Indices<Ps...>) {
+
+	complete(partial, out, std::get<Ps>(schema.parsers())...);
+}
+
+template <typename... ArgParsers>
+void complete(StrView partial, std::vector<StrView>& out, const Schema<ArgParsers...>& schema) {
+	complete_schema(partial, out, schema, BuildIndices<sizeof...(ArgParsers)>());
+}
+
+
+// Query mode for shell completion scripts: if argv[1] is "--complete", prints
+// the completions of argv[2] (everything if it's missing), one per line, and
+// returns true. Otherwise returns false and the program should parse argv.
+template <typename... ArgParsers>
+bool print_completions(int argc, const char* const* argv, std::ostream& o,
+		const ArgParsers&... parsers) {
+
+	if (argc < 2 || StrView(argv[1]) != "--complete")
+		return false;
+
+	std::vector<StrView> candidates;
+	complete(argc > 2 ? StrView(argv[2]) : StrView(), candidates, parsers...);
+
+	for (const auto& candidate : candidates)
+		o << candidate << '\n';
+
+	return true;
+}
+
+}
+
+#endif
+
+#ifndef ARGS_DISPLAY_HELP_H
+#define ARGS_DISPLAY_HELP_H
+
+#include <array>
+#include <iostream>
+
+
+
+
+namespace args {
+
+struct HelpFmt {
+	StrView indent = "";
+	std::size_t padding = 1;
+
+	HelpFmt() = default;
+	HelpFmt(const HelpFmt&) = default;
+	HelpFmt& operator=(const HelpFmt&) = default;
+
+	HelpFmt(StrView indent, std::size_t padding)
+		: indent(indent)
+		, padding(padding) {}
+};
+
+
+template <std::size_t I, std::size_t N, typename... ArgTs>
+typename std::enable_if<I == N>::type
+print_help_strs_iter(const ArgParser<ArgTs...>& arg_parser,
+		std::array<Str, N>& lhss, std::array<StrView, N>& rhss,
+		std::size_t& max_lhs_len) {
+}
+
+template <std::size_t I, std::size_t N, typename... ArgTs>
+typename std::enable_if<I < N>::type
+print_help_strs_iter(
+		const ArgParser<ArgTs...>& arg_parser,
+		std::array<Str, N>& lhss, std::array<StrView, N>& rhss,
+		std::size_t& max_lhs_len) {
+
+	const auto& arg = std::get<I>(arg_parser.const_args);
+
+	auto& lhs  = std::get<I>(lhss);
+	auto& rhs  = std::get<I>(rhss);
+
+	lhs = arg.to_str();
+	rhs = arg.doc_description;
+
+	max_lhs_len  = std::max(max_lhs_len, lhs.size());
+
+	print_help_strs_iter<I+1, N, ArgTs...>(arg_parser, lhss, rhss, max_lhs_len);
+}
+
+
+template <typename... ArgTs>
+void print_help(const ArgParser<ArgTs...>& arg_parser,
+		HelpFmt fmt = HelpFmt(), std::ostream& o = std::cout) {
+
+	constexpr auto N = ArgParser<ArgTs...>::N;
+
+	std::array<Str, N> lhss;
+	std::array<StrView, N> rhss;
+	std::size_t max_lhs_len = 0;
+
+	print_help_strs_iter<0, N, ArgTs...>(arg_parser, lhss, rhss, max_lhs_len);
+
+	auto flags = o.flags();
+	auto fill = o.fill();
+	auto width = o.width();
+	o.fill(' ');
+	o.setf(std::ios_base::left);
+
+	for (std::size_t i = 0; i < N; i++) {
+		o << fmt.indent;
+		o.width(max_lhs_len + fmt.padding);
+		o << lhss[i];
+		o << rhss[i];
+		o << '\n';
+	}
+
+	o.width(width);
+	o.fill(fill);
+	o.flags(flags);
+}
+
+}
+
+#endif
+
+
+
+#ifndef ARGS_CONFIG_SOURCE_H
+#define ARGS_CONFIG_SOURCE_H
+
+#include <utility>
+#include <vector>
+
+
+
+
+
+namespace args {
+
+// Takes values from a memory-mapped configuration file made of `key = value`
+// lines and `[section]` headers, with `#` or `;` comments. Keys inside a
+// section are looked up as "section.key". Values are views into the mapping,
+// so the file must outlive the parse results that refer to it (e.g. errors).
+// A missing file is treated as an empty one, check is_open() if it matters.
+class ConfigFile {
+	Str path;
+	MappedFile file;
+
+public:
+	explicit ConfigFile(Str path);
+
+	bool is_open() const {
+		return file.is_open();
+	}
+
+	Origin origin() const {
+		return Origin::File;
+	}
+
+	Str index_key(StrView key) const {
+		return key.str();
+	}
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+// Default values given as strings, parsed like any other source
+class Defaults {
+	std::vector<std::pair<Str, Str>> key_values;
+
+public:
+	explicit Defaults(std::vector<std::pair<Str, Str>> key_values)
+		: key_values(std::move(key_values)) {}
+
+	Origin origin() const {
+		return Origin::Default;
+	}
+
+	Str index_key(StrView key) const {
+		return key.str();
+	}
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+ConfigFile config_file(Str path);
+
+Defaults defaults(std::vector<std::pair<Str, Str>> key_values);
+
+}
+
+#endif
+
+#ifndef ARGS_ENV_SOURCE_H
+#define ARGS_ENV_SOURCE_H
+
+#include <vector>
+
+
+
+
+namespace args {
+
+// Takes values from environment variables named after the source key of the
+// arguments: with prefix "TOOL_", --cache-dir is read from TOOL_CACHE_DIR.
+// The environment is scanned only once per parse.
+class EnvSource {
+	Str prefix;
+	const char* const* envp;
+
+public:
+	EnvSource(Str prefix, const char* const* envp);
+
+	Origin origin() const {
+		return Origin::Env;
+	}
+
+	Str index_key(StrView key) const;
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+EnvSource env_source(Str prefix);
+
+EnvSource env_source(Str prefix, const char* const* envp);
+
+}
+
+#endif
+
+
+#ifndef ARGS_FILE_WATCH_H
+#define ARGS_FILE_WATCH_H
+
+
+
+namespace args {
+
+// Notifies changes of a file (e.g. a config file to reload) with inotify.
+// Replacing the file by renaming another one over it is also reported.
+// Never reports anything on systems without inotify.
+class FileWatch {
+	int m_fd = -1;
+	Str dir;
+	Str name;
+
+public:
+	explicit FileWatch(const Str& path);
+
+	FileWatch(const FileWatch&) = delete;
+	FileWatch& operator= (const FileWatch&) = delete;
+
+	~FileWatch();
+
+
+	bool is_open() const {
+		return m_fd >= 0;
+	}
+
+	// can be polled for readability to integrate with an event loop
+	int fd() const {
+		return m_fd;
+	}
+
+	// waits up to timeout_ms milliseconds (-1 waits forever) and returns
+	// whether the file was changed
+	bool changed(int timeout_ms = 0);
+};
+
+}
+
+#endif
+
+#ifndef ARGS_SNAPSHOTS_H
+#define ARGS_SNAPSHOTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+
+namespace args {
+
+// Immutable values (e.g. a configuration built from parse results) that can be
+// replaced while other threads read them. Reading is a single atomic load.
+//
+// Old values are reclaimed RCU-style: every thread that reads registers a
+// Reader and calls quiescent() whenever it holds no reference to a value (e.g.
+// between requests). A replaced value is deleted once all readers have been
+// quiescent after the replacement.
+template <typename T>
+class Snapshots {
+public:
+	class Reader {
+		friend class Snapshots;
+
+		Snapshots& owner;
+		std::atomic<std::uint64_t> seen_epoch;
+
+	public:
+		explicit Reader(Snapshots& owner)
+			: owner(owner)
+			, seen_epoch(owner.epoch.load()) {
+
+			std::lock_guard<std::mutex> lock(owner.writer);
+			owner.readers.push_back(this);
+		}
+
+		Reader(const Reader&) = delete;
+		Reader& operator= (const Reader&) = delete;
+
+		~Reader() {
+			std::lock_guard<std::mutex> lock(owner.writer);
+			auto& r = owner.readers;
+			r.erase(std::find(begin(r), end(r), this));
+			owner.reclaim();
+		}
+
+		const T& get() const {
+			return owner.get();
+		}
+
+		void quiescent() {
+			seen_epoch.store(owner.epoch.load(), std::memory_order_release);
+		}
+	};
+
+
+	explicit Snapshots(T initial = T())
+		: current(new T(std::move(initial))) {}
+
+	Snapshots(const Snapshots&) = delete;
+	Snapshots& operator= (const Snapshots&) = delete;
+
+	~Snapshots() {
+		for (const auto& r : retired)
+			delete r.second;
+
+		delete current.load();
+	}
+
+
+	const T& get() const {
+		return *current.load(std::memory_order_acquire);
+	}
+
+	void publish(T value) {
+		std::lock_guard<std::mutex> lock(writer);
+		publish_locked(std::unique_ptr<T>(new T(std::move(value))));
+	}
+
+	// builds a fresh value with f(T&), which returns a ParseResultVoid
+	// (typically after reset() and parse()), and publishes it only on success.
+	// Reloads are serialized, readers are never blocked.
+	template <typename F>
+	ParseResultVoid reload(F&& f) {
+		std::lock_guard<std::mutex> lock(writer);
+
+		std::unique_ptr<T> fresh(new T());
+		ParseResultVoid res = f(*fresh);
+
+		if (res.is_ok())
+			publish_locked(std::move(fresh));
+
+		return res;
+	}
+
+	// deletes the replaced values that no reader can still see
+	void collect() {
+		std::lock_guard<std::mutex> lock(writer);
+		reclaim();
+	}
+
+private:
+	std::atomic<const T*> current;
+	std::atomic<std::uint64_t> epoch { 1 };
+
+	std::mutex writer;
+	std::vector<Reader*> readers;
+	std::vector<std::pair<std::uint64_t, const T*>> retired;
+
+
+	void publish_locked(std::unique_ptr<T> fresh) {
+		const T* old = current.exchange(fresh.release());
+		retired.emplace_back(epoch.fetch_add(1) + 1, old);
+		reclaim();
+	}
+
+	void reclaim() {
+		auto min_seen = std::numeric_limits<std::uint64_t>::max();
+
+		for (const Reader* r : readers)
+			min_seen = std::min(min_seen, r->seen_epoch.load(std::memory_order_acquire));
+
+		auto safe = std::partition(begin(retired), end(retired),
+			[&](const std::pair<std::uint64_t, const T*>& r) {
+				return r.first > min_seen;
+			});
+
+		for (auto i = safe; i != end(retired); ++i)
+			delete i->second;
+
+		retired.erase(safe, end(retired));
+	}
+};
+
+}
+
+#endif
+
+#endif
+
+
+#if defined(ARGS_IMPLEMENTATION) && !defined(ARGS_IMPLEMENTATION_INCLUDED)
+#define ARGS_IMPLEMENTATION_INCLUDED
+
+// lib/args/flag/path_params.cpp
+
+#include <cerrno>
+#include <cstring>
+
+namespace args {
+
+
+// the directory of a path, as given ("dir/" for "dir/file", "." for "file")
+static Str parent_dir(const Str& path) {
+	auto end = path.find_last_not_of('/');
+
+	if (end == Str::npos)
+		return "/";
+
+	auto slash = path.rfind('/', end);
+
+	if (slash == Str::npos)
+		return ".";
+
+	return slash == 0 ? "/" : path.substr(0, slash + 1);
+}
+
+
+ParseResultVoid PathChecks::check(const Request& req, const PathStat& st) const {
+	bool parent = req.kind == PathKind::CreatableParent;
+
+	if (st.error == ENOENT)
+		return ParseError(InvalidParam(
+			parent ? "parent directory does not exist" : "does not exist",
+			*req.path, req.arg));
+
+	if (st.error != 0)
+		return ParseError(InvalidParam(std::strerror(st.error), *req.path, req.arg));
+
+	if (req.kind != PathKind::Existing && !st.is_dir)
+		return ParseError(InvalidParam(
+			parent ? "parent is not a directory" : "is not a directory",
+			*req.path, req.arg));
+
+	return success();
+}
+
+ParseResultVoid PathChecks::run(ThreadPool* pool, StatMethod method) {
+	parents.clear();
+	stat_paths.clear();
+
+	for (const auto& req : requests) {
+		if (req.kind == PathKind::CreatableParent)
+			parents.push_back(parent_dir(*req.path));
+	}
+
+	std::size_t parent = 0;
+
+	for (const auto& req : requests) {
+		stat_paths.push_back(req.kind == PathKind::CreatableParent
+			? parents[parent++].c_str()
+			: req.path->c_str());
+	}
+
+	stat_batch(stat_paths, stats, pool, method);
+
+	auto res = success();
+
+	for (std::size_t i = 0; i < requests.size() && res.is_ok(); i++)
+		res = check(requests[i], stats[i]);
+
+	requests.clear();
+
+	return res;
+}
+
+}
+
+// lib/common/match_log.cpp
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace args {
+
+
+constexpr uint MatchLog::no_pos;
+constexpr MatchLog::id_type MatchLog::no_id;
+
+
+MatchLog::id_type MatchLog::find(const BaseArg& arg) const {
+	// few distinct arguments are matched, a linear search beats hashing
+	for (std::size_t id = 0; id < ids.size(); id++) {
+		if (ids[id] == &arg)
+			return static_cast<id_type>(id);
+	}
+
+	return no_id;
+}
+
+MatchLog::id_type MatchLog::intern(const BaseArg& arg) {
+	id_type id = find(arg);
+
+	if (id == no_id) {
+		// the next id would be no_id, and the argument would then look
+		// unmatched to contains and first_before
+		if (ids.size() == no_id) {
+			std::cerr << "args::MatchLog: more than " << no_id
+				<< " distinct arguments matched in one parse\n";
+			std::abort();
+		}
+
+		id = static_cast<id_type>(ids.size());
+		ids.push_back(&arg);
+	}
+
+	return id;
+}
+
+void MatchLog::add_run(id_type id, uint count) {
+	const uint max_count = std::numeric_limits<std::uint16_t>::max();
+
+	if (!runs.empty() && runs.back().id == id) {
+		uint room = max_count - runs.back().count;
+		uint added = count < room ? count : room;
+
+		runs.back().count += added;
+		count -= added;
+	}
+
+	while (count > 0) {
+		uint added = count < max_count ? count : max_count;
+
+		Run run;
+		run.id = id;
+		run.count = static_cast<std::uint16_t>(added);
+		runs.push_back(run);
+
+		count -= added;
+	}
+}
+
+void MatchLog::append(const MatchLog& other, uint pos_offset) {
+	if (runs_kept && other.runs_kept) {
+		for (const Run& run : other.runs)
+			add_run(intern(*other.ids[run.id]), run.count);
+	} else {
+		for (const BaseArg* arg : other.ids)
+			intern(*arg);
+	}
+
+	if (positions_kept) {
+		for (std::size_t i = 0; i < other.match_count; i++) {
+			uint pos = other.position(i);
+			positions.push_back(pos == no_pos ? no_pos : pos + pos_offset);
+		}
+	}
+
+	match_count += other.match_count;
+}
+
+void MatchLog::truncate(std::size_t count) {
+	if (count >= match_count)
+		return;
+
+	std::size_t removed = match_count - count;
+
+	while (removed > 0) {
+		Run& last = runs.back();
+
+		if (last.count > removed) {
+			last.count -= removed;
+			break;
+		}
+
+		removed -= last.count;
+		runs.pop_back();
+	}
+
+	// ids follow the first matches, so the remaining ones are a prefix
+	std::size_t id_count = 0;
+
+	for (const Run& run : runs)
+		id_count = std::max<std::size_t>(id_count, run.id + 1);
+
+	ids.resize(id_count);
+
+	if (positions.size() > count)
+		positions.resize(count);
+
+	match_count = count;
+}
+
+void MatchLog::clear() {
+	ids.clear();
+	runs.clear();
+	positions.clear();
+	match_count = 0;
+}
+
+}
+
+// lib/common/parse_error.cpp
+
+
+namespace args {
+
+
+std::string CondFailed::message() const {
+	if (!condition)
+		return error_msg;
+
+	std::string msg = condition;
+
+	if (other) {
+		msg += ' ';
+		msg += other->to_str();
+	} else if (has_number) {
+		msg += ' ';
+		msg += std::to_string(number);
+	}
+
+	return msg;
+}
+
+}
+
+// lib/common/parser_state.cpp
+
+
+namespace args {
+
+
+ParserState::ParserState(const MatchLog& matched_args, const Argv& argv)
+	: matched_args(matched_args)
+	, argv(argv) {}
+
+
+uint ParserState::multiplicity(const BaseArg& arg) const {
+	if (!counts)
+		return arg.multiplicity;
+	else
+		return arg.id < count_size ? counts[arg.id] : 0;
+}
+
+
+bool OwnedParserState::assign_command(StrView command, std::string& buffer) {
+	rewind(0, false, 0);
+
+	return replace_command(command, buffer);
+}
+
+bool OwnedParserState::replace_command(StrView command, std::string& buffer,
+		std::vector<std::size_t>* word_ends) {
+
+	owned_argv.clear();
+
+	if (word_ends)
+		word_ends->clear();
+
+	bool ok = split_shell(command, owned_argv, buffer, word_ends);
+
+	classify();
+
+	return ok;
+}
+
+void OwnedParserState::rewind(uint pos, bool end_of_flags, std::size_t match_count) {
+	this->pos = pos;
+	this->str_off = 0;
+	this->end_of_flags = end_of_flags;
+	longopt_match = StrView();
+
+	owned_matched_args.truncate(match_count);
+}
+
+void OwnedParserState::classify() {
+	owned_classes.resize(owned_argv.size());
+	end_of_flags_pos = owned_argv.size();
+
+	for (uint i = 0; i < owned_argv.size(); i++) {
+		owned_classes[i] = classify_token(owned_argv[i]);
+
+		if (owned_classes[i] == TokenClass::EndOfFlags && end_of_flags_pos == owned_argv.size())
+			end_of_flags_pos = i;
+	}
+
+	classes = owned_classes.data();
+}
+
+}
+
+// lib/common/result_cache.cpp
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace args {
+
+
+namespace {
+
+thread_local CacheRecorder* current_recorder = nullptr;
+
+const char cache_magic[8] = { 'A', 'R', 'G', 'S', 'R', 'C', '0', '2' };
+
+void put_u64(std::string& out, std::uint64_t value) {
+	ResultCodec<std::uint64_t>::encode(value, out);
+}
+
+bool dependency_unchanged(const CacheDependency& dep) {
+	return dep.stamp == (dep.kind == CacheDependency::Kind::File
+		? file_stamp(dep.name)
+		: env_stamp(dep.name));
+}
+
+}
+
+
+std::uint64_t file_stamp(const Str& path) {
+	struct stat st;
+
+	// a missing file is a state too: creating it invalidates the results
+	if (::stat(path.c_str(), &st) != 0)
+		return 0;
+
+	Fnv1a h;
+	h.add_u64(st.st_dev);
+	h.add_u64(st.st_ino);
+	h.add_u64(st.st_size);
+	h.add_u64(st.st_mtim.tv_sec);
+	h.add_u64(st.st_mtim.tv_nsec);
+	h.add_u64(st.st_ctim.tv_sec);
+	h.add_u64(st.st_ctim.tv_nsec);
+
+	return h.value();
+}
+
+std::uint64_t env_stamp(const Str& name) {
+	const char* value = std::getenv(name.c_str());
+
+	Fnv1a h;
+	h.add_u64(value != nullptr);
+
+	if (value)
+		h.add(StrView(value));
+
+	return h.value();
+}
+
+
+void cache_depend_on_file(const Str& path) {
+	if (current_recorder)
+		current_recorder->add(CacheDependency::Kind::File, path, file_stamp(path));
+}
+
+void cache_depend_on_env(const Str& name) {
+	if (current_recorder)
+		current_recorder->add(CacheDependency::Kind::Env, name, env_stamp(name));
+}
+
+
+CacheRecorder::CacheRecorder()
+	: previous(current_recorder) {
+
+	current_recorder = this;
+}
+
+CacheRecorder::~CacheRecorder() {
+	current_recorder = previous;
+}
+
+void CacheRecorder::add(CacheDependency::Kind kind, const Str& name, std::uint64_t stamp) {
+	for (const auto& dep : deps) {
+		if (dep.kind == kind && dep.name == name)
+			return;
+	}
+
+	deps.push_back(CacheDependency { kind, name, stamp });
+}
+
+
+ResultCache::ResultCache(Str dir, std::uint64_t version)
+	: dir(std::move(dir))
+	, version(version) {}
+
+void ResultCache::encode_context(std::string& key) const {
+	// rebuilding the program may change how the arguments validate
+	put_u64(key, file_stamp("/proc/self/exe"));
+	put_u64(key, version);
+
+	for (const auto& name : env_names) {
+		const char* value = std::getenv(name.c_str());
+
+		ResultCodec<Str>::encode(name, key);
+		ResultCodec<bool>::encode(value != nullptr, key);
+		ResultCodec<StrView>::encode(value ? StrView(value) : StrView(), key);
+	}
+}
+
+Str ResultCache::entry_path(const std::string& key) const {
+	char name[32];
+	std::snprintf(name, sizeof name, "/%016llx.args",
+			static_cast<unsigned long long>(Fnv1a().add(key).value()));
+
+	return dir + name;
+}
+
+bool ResultCache::load(const std::string& key, ByteReader& payload) {
+	// mapped aside, so that the views of the last hit stay valid on a miss
+	MappedFile file(entry_path(key).c_str());
+
+	if (!file.is_open())
+		return false;
+
+	ByteReader in(file.data());
+
+	char magic[sizeof cache_magic];
+	StrView stored_key;
+	std::uint32_t dep_count;
+
+	// the hash only picks the file, the whole key must match
+	if (!in.read(magic, sizeof magic) || std::memcmp(magic, cache_magic, sizeof magic) != 0
+			|| !ResultCodec<StrView>::decode(in, stored_key) || stored_key != StrView(key)
+			|| !ResultCodec<std::uint32_t>::decode(in, dep_count))
+		return false;
+
+	for (std::uint32_t i = 0; i < dep_count; i++) {
+		CacheDependency dep;
+
+		if (!ResultCodec<CacheDependency::Kind>::decode(in, dep.kind)
+				|| !ResultCodec<Str>::decode(in, dep.name)
+				|| !ResultCodec<std::uint64_t>::decode(in, dep.stamp)
+				|| !dependency_unchanged(dep))
+			return false;
+	}
+
+	StrView data;
+	std::uint64_t payload_size;
+
+	if (!ResultCodec<std::uint64_t>::decode(in, payload_size)
+			|| !in.view(payload_size, data) || !in.at_end())
+		return false;
+
+	loaded = std::move(file);
+	payload = ByteReader(data);
+	return true;
+}
+
+void ResultCache::store(const std::string& key,
+		const std::vector<CacheDependency>& deps, const std::string& payload) {
+
+	std::string out(cache_magic, sizeof cache_magic);
+	ResultCodec<StrView>::encode(StrView(key), out);
+	ResultCodec<std::uint32_t>::encode(deps.size(), out);
+
+	for (const auto& dep : deps) {
+		ResultCodec<CacheDependency::Kind>::encode(dep.kind, out);
+		ResultCodec<Str>::encode(dep.name, out);
+		put_u64(out, dep.stamp);
+	}
+
+	put_u64(out, payload.size());
+	out += payload;
+
+	// written next to the entry and renamed over it, so that readers see
+	// either the old entry or the whole new one
+	Str path = entry_path(key);
+	Str tmp = path + "." + std::to_string(::getpid()) + ".tmp";
+
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+	if (fd < 0)
+		return;
+
+	std::size_t written = 0;
+
+	while (written < out.size()) {
+		ssize_t n = ::write(fd, out.data() + written, out.size() - written);
+
+		if (n <= 0)
+			break;
+
+		written += n;
+	}
+
+	::close(fd);
+
+	if (written != out.size() || ::rename(tmp.c_str(), path.c_str()) != 0)
+		::unlink(tmp.c_str());
+}
+
+}
+
+// lib/display/error.cpp
+
+
+
+static std::string err_arg_str(const args::BaseArg* arg) {
+	return arg
+		? arg->to_str() + " (" + std::to_string(arg->multiplicity) + ")"
+		: "(null)";
+}
+
+
+void args::report_error(const args::ParseError& err, std::ostream& o) {
+	using namespace args;
+
+	static_assert(ParseError::type_count == 6, "Mismatching types in args::report_error");
+
+	switch (err.data.which()) {
+		case ParseError::index_of<UnknownArg>(): {
+			const auto& e = err.get<UnknownArg>();
+
+			o << "unknown argument: " << e.argv_element << "\n";
+
+			if (!e.suggestion.empty())
+				o << "  did you mean " << e.suggestion << "?\n";
+
+		} break;
+
+		case ParseError::index_of<BoundError>(): {
+			const auto& e = err.get<BoundError>();
+
+			o << "<internal>: bound check failed in " << e.method_name << ":\n";
+
+			o << "  while parsing " << err_arg_str(e.arg) << "\n";
+
+		} break;
+
+		case ParseError::index_of<InvalidParam>(): {
+			const auto& e = err.get<InvalidParam>();
+
+			o << "invalid parameter for " << err_arg_str(e.arg) << ":\n";
+
+			o << "  could not parse '" << e.given << "':\n";
+			o << "    " << e.custom_msg << "\n";
+
+		} break;
+
+		case ParseError::index_of<InvalidShortoptList>(): {
+			const auto& e = err.get<InvalidShortoptList>();
+
+			o << "shortopt list contains " << err_arg_str(e.arg) << ":\n";
+
+			o << "  list: '" << e.shortopt_list << "':\n";
+
+		} break;
+
+		case ParseError::index_of<CondFailed>(): {
+			const auto& e = err.get<CondFailed>();
+
+			o << "condition failed for " << err_arg_str(e.arg) << ":\n";
+
+			o << "  " << e.message() << "\n";
+
+		} break;
+
+		case ParseError::index_of<Nothing>():
+			o << "expected error but found Nothing\n";
+			break;
+
+		default:
+			o << "unknown error " << err.data.which() << "\n";
+	}
+}
+
+
+std::ostream& operator<< (std::ostream& o, const args::ParseError& e) {
+	args::report_error(e, o);
+	return o;
+}
+
+
+std::string std::to_string(const args::ParseError& e) {
+	std::ostringstream s;
+	args::report_error(e, s);
+	return s.str();
+}
+
+// lib/functors/condition.cpp
+
+namespace args {
+namespace condition {
+
+
+ParseResultVoid Requires::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.multiplicity(self) == 0 || s.matched_args.contains(to_find))
+		return success();
+	else
+		return cond_fail("Requires", &to_find);
+}
+
+ParseResultVoid Conflicts::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.multiplicity(self) == 0 || !s.matched_args.contains(to_find))
+		return success();
+	else
+		return cond_fail("Conflicts", &to_find);
+}
+
+
+// ids are ordered by first match, so these only look at the distinct arguments
+
+ParseResultVoid Before::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.matched_args.first_before(to_find, self))
+		return cond_fail("Before", &to_find);
+
+	return success();
+}
+
+ParseResultVoid After::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.matched_args.first_before(self, to_find))
+		return cond_fail("After", &to_find);
+
+	return success();
+}
+
+
+ParseResultVoid Min::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.multiplicity(self) >= min_multiplicity)
+		return success();
+	else
+		return cond_fail("Min", min_multiplicity);
+}
+
+ParseResultVoid Max::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.multiplicity(self) <= max_multiplicity)
+		return success();
+	else
+		return cond_fail("Max", max_multiplicity);
+}
+
+}
+}
+
+// lib/sources/config_source.cpp
+
+#include <cstring>
+
+namespace args {
+
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static StrView trim(StrView s) {
+	std::size_t b = 0, e = s.size();
+
+	while (b < e && is_blank(s[b]))
+		b++;
+
+	while (e > b && is_blank(s[e-1]))
+		e--;
+
+	return s.substr(b, e - b);
+}
+
+static StrView unquote(StrView s) {
+	bool quoted = s.size() >= 2
+		&& (s[0] == '"' || s[0] == '\'')
+		&& s[s.size()-1] == s[0];
+
+	return quoted ? s.substr(1, s.size() - 2) : s;
+}
+
+
+ConfigFile::ConfigFile(Str path)
+	: path(std::move(path))
+	, file(this->path.c_str()) {}
+
+
+ParseResultVoid ConfigFile::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	auto data = file.data();
+
+	StrView section;
+	Str full_key;
+	uint line_no = 0;
+
+	std::size_t pos = 0;
+
+	while (pos < data.size()) {
+		const char* nl = static_cast<const char*>(
+				std::memchr(data.c_str() + pos, '\n', data.size() - pos));
+
+		std::size_t line_end = nl ? nl - data.c_str() : data.size();
+
+		auto line = trim(data.substr(pos, line_end - pos));
+		pos = line_end + 1;
+		line_no++;
+
+		if (line.empty() || line[0] == '#' || line[0] == ';')
+			continue;
+
+		if (line[0] == '[') {
+			if (line[line.size()-1] != ']')
+				return ParseError(InvalidParam(
+					path + ":" + std::to_string(line_no) + ": expected ']'", line));
+
+			section = trim(line.substr(1, line.size() - 2));
+			continue;
+		}
+
+		const char* eq = static_cast<const char*>(
+				std::memchr(line.c_str(), '=', line.size()));
+
+		if (!eq)
+			return ParseError(InvalidParam(
+				path + ":" + std::to_string(line_no) + ": expected 'key = value'", line));
+
+		std::size_t eq_pos = eq - line.c_str();
+
+		auto key   = trim(line.substr(0, eq_pos));
+		auto value = unquote(trim(line.substr(eq_pos + 1)));
+
+		int slot;
+
+		if (section.empty()) {
+			slot = index.find(key);
+		} else {
+			full_key.assign(section.c_str(), section.size());
+			full_key += '.';
+			full_key.append(key.c_str(), key.size());
+
+			slot = index.find(full_key);
+		}
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), value });
+	}
+
+	return success();
+}
+
+
+ParseResultVoid Defaults::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	for (const auto& kv : key_values) {
+		int slot = index.find(kv.first);
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), kv.second });
+	}
+
+	return success();
+}
+
+
+ConfigFile config_file(Str path) {
+	return ConfigFile(std::move(path));
+}
+
+Defaults defaults(std::vector<std::pair<Str, Str>> key_values) {
+	return Defaults(std::move(key_values));
+}
+
+}
+
+// lib/sources/env_source.cpp
+
+#include <cctype>
+
+extern char** environ;
+
+namespace args {
+
+
+EnvSource::EnvSource(Str prefix, const char* const* envp)
+	: prefix(std::move(prefix))
+	, envp(envp) {}
+
+
+Str EnvSource::index_key(StrView key) const {
+	Str name;
+	name.reserve(key.size());
+
+	for (char c : key) {
+		if (c == '-' || c == '.')
+			name += '_';
+		else
+			name += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	}
+
+	return name;
+}
+
+ParseResultVoid EnvSource::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	for (auto env = envp; env && *env; env++) {
+		StrView var(*env);
+
+		if (!var.starts_with(prefix))
+			continue;
+
+		const char* eq = static_cast<const char*>(
+				std::memchr(var.c_str(), '=', var.size()));
+
+		if (!eq || eq < var.c_str() + prefix.size())
+			continue;
+
+		std::size_t name_end = eq - var.c_str();
+		auto name = var.substr(prefix.size(), name_end - prefix.size());
+
+		int slot = index.find(name);
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), var.substr(name_end + 1) });
+	}
+
+	return success();
+}
+
+
+EnvSource env_source(Str prefix) {
+	return EnvSource(std::move(prefix), environ);
+}
+
+EnvSource env_source(Str prefix, const char* const* envp) {
+	return EnvSource(std::move(prefix), envp);
+}
+
+}
+
+// lib/sources/source_index.cpp
+
+namespace args {
+
+
+void SourceIndex::add(Str key, uint slot) {
+	entries.emplace_back(std::move(key), slot);
+}
+
+void SourceIndex::sort() {
+	std::sort(begin(entries), end(entries));
+}
+
+int SourceIndex::find(StrView key) const {
+	auto i = std::lower_bound(begin(entries), end(entries), key,
+		[](const std::pair<Str, uint>& entry, const StrView& key) {
+			return StrView(entry.first) < key;
+		});
+
+	if (i != end(entries) && StrView(i->first) == key)
+		return static_cast<int>(i->second);
+	else
+		return not_found;
+}
+
+}
+
+// lib/utils/alloc_audit.cpp
+
+#include <cstdlib>
+#include <new>
+
+#include <execinfo.h>
+
+namespace args {
+
+
+constexpr std::size_t AllocAudit::max_recorded;
+constexpr std::size_t AllocAudit::max_frames;
+
+
+// audit of the current thread, null if none
+static thread_local AllocAudit* current_audit = nullptr;
+
+
+bool AllocAudit::enabled() {
+#ifdef ARGS_ALLOC_AUDIT
+	return true;
+#else
+	return false;
+#endif
+}
+
+AllocAudit::AllocAudit()
+	: previous(current_audit) {
+
+	current_audit = this;
+}
+
+AllocAudit::~AllocAudit() {
+	stop();
+}
+
+void AllocAudit::stop() {
+	if (active) {
+		current_audit = previous;
+		active = false;
+	}
+}
+
+AllocExempt::AllocExempt()
+	: audit(current_audit) {
+
+	current_audit = nullptr;
+}
+
+AllocExempt::~AllocExempt() {
+	current_audit = audit;
+}
+
+void AllocAudit::record(std::size_t size) {
+	// backtrace() may allocate the first time it's called
+	if (recording)
+		return;
+
+	recording = true;
+
+	if (total < max_recorded) {
+		auto& allocation = recorded[total];
+		allocation.size = size;
+		allocation.frame_count = backtrace(allocation.frames, max_frames);
+	}
+
+	total++;
+	total_bytes += size;
+
+	recording = false;
+}
+
+void AllocAudit::report(std::ostream& o) const {
+	o << total << " allocations (" << total_bytes << " bytes)\n";
+
+	for (const auto& allocation : *this) {
+		o << "  " << allocation.size << " bytes at:\n";
+
+		// the first frames are record() and the allocation function
+		char** symbols = backtrace_symbols(allocation.frames, allocation.frame_count);
+
+		for (int i = 2; i < allocation.frame_count; i++) {
+			o << "    ";
+
+			if (symbols)
+				o << symbols[i] << '\n';
+			else
+				o << allocation.frames[i] << '\n';
+		}
+
+		std::free(symbols);
+	}
+
+	if (total > max_recorded)
+		o << "  (" << total - max_recorded << " more)\n";
+}
+
+
+}
+
+
+#ifdef ARGS_ALLOC_AUDIT
+
+#ifdef __GLIBC__
+
+// malloc, calloc and realloc are replaced too, forwarding to glibc's own
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* p, std::size_t size);
+
+static void* raw_alloc(std::size_t size) {
+	return __libc_malloc(size);
+}
+
+extern "C" void* malloc(std::size_t size) {
+	void* p = __libc_malloc(size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) {
+	void* p = __libc_calloc(count, size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(count * size);
+
+	return p;
+}
+
+extern "C" void* realloc(void* old, std::size_t size) {
+	void* p = __libc_realloc(old, size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+#else
+
+static void* raw_alloc(std::size_t size) {
+	return std::malloc(size);
+}
+
+#endif
+
+static void* audited_alloc(std::size_t size) {
+	void* p = raw_alloc(size ? size : 1);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+void* operator new(std::size_t size) {
+	void* p = audited_alloc(size);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	void* p = audited_alloc(size);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return audited_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return audited_alloc(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+#endif
+
+// lib/utils/file_watch.cpp
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace args {
+
+
+FileWatch::FileWatch(const Str& path) {
+	auto slash = path.rfind('/');
+
+	dir  = slash == Str::npos ? "." : path.substr(0, slash + 1);
+	name = slash == Str::npos ? path : path.substr(slash + 1);
+
+#ifdef __linux__
+	m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	// watching the directory also catches files replaced with rename()
+	if (m_fd >= 0 && ::inotify_add_watch(m_fd, dir.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+#endif
+}
+
+FileWatch::~FileWatch() {
+#ifdef __linux__
+	if (m_fd >= 0)
+		::close(m_fd);
+#endif
+}
+
+
+bool FileWatch::changed(int timeout_ms) {
+#ifdef __linux__
+	if (m_fd < 0)
+		return false;
+
+	pollfd p = { m_fd, POLLIN, 0 };
+
+	if (::poll(&p, 1, timeout_ms) <= 0)
+		return false;
+
+	alignas(inotify_event) char buf[4096];
+	bool found = false;
+	ssize_t len;
+
+	while ((len = ::read(m_fd, buf, sizeof buf)) > 0) {
+		for (char* i = buf; i < buf + len; ) {
+			auto ev = reinterpret_cast<const inotify_event*>(i);
+
+			if (ev->len > 0 && name == ev->name)
+				found = true;
+
+			i += sizeof(inotify_event) + ev->len;
+		}
+	}
+
+	return found;
+#else
+	(void) timeout_ms;
+	return false;
+#endif
+}
+
+}
+
+// lib/utils/instrument.cpp
+
+namespace args {
+namespace instrument {
+
+
+constexpr std::size_t LatencyHistogram::sub_buckets;
+constexpr std::size_t LatencyHistogram::bucket_count;
+constexpr std::size_t ParseStats::max_args;
+
+
+static unsigned msb(std::uint64_t value) {
+	return 63 - __builtin_clzll(value);
+}
+
+
+// values below 2 * sub_buckets are their own index. above, the value is
+// shifted so that its top 5 bits remain (16 to 31), and the index is made of
+// the shift (the power of two) and the 4 bits after the most significant one
+std::size_t LatencyHistogram::index(std::uint64_t value) {
+	if (value < 2 * sub_buckets)
+		return value;
+
+	unsigned shift = msb(value) - 4;
+	std::size_t top = value >> shift;
+
+	return (shift + 1) * sub_buckets + (top - sub_buckets);
+}
+
+std::uint64_t LatencyHistogram::lower_bound(std::size_t i) {
+	if (i < 2 * sub_buckets)
+		return i;
+
+	unsigned shift = i / sub_buckets - 1;
+	std::uint64_t top = sub_buckets + i % sub_buckets;
+
+	return top << shift;
+}
+
+std::uint64_t LatencyHistogram::count() const {
+	std::uint64_t total = 0;
+
+	for (const auto& bucket : buckets)
+		total += bucket.load(std::memory_order_relaxed);
+
+	return total;
+}
+
+std::uint64_t LatencyHistogram::percentile(double p) const {
+	std::uint64_t total = count();
+
+	if (total == 0)
+		return 0;
+
+	auto rank = static_cast<std::uint64_t>(p / 100 * (total - 1));
+	std::uint64_t seen = 0;
+
+	for (std::size_t i = 0; i < bucket_count; i++) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+
+		if (seen > rank)
+			return lower_bound(i);
+	}
+
+	return lower_bound(bucket_count - 1);
+}
+
+void LatencyHistogram::reset() {
+	for (auto& bucket : buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+
+void ParseStats::reset() {
+	for (auto* counter : { &parses, &match_attempts, &precond_evals, &state_clones,
+			&param_parses, &keyword_lookups, &postcond_evals, &result_allocations })
+		counter->store(0, std::memory_order_relaxed);
+
+	for (auto& phase : phase_cycles)
+		phase.store(0, std::memory_order_relaxed);
+
+	for (auto& cost : args) {
+		cost.attempts.store(0, std::memory_order_relaxed);
+		cost.matches.store(0, std::memory_order_relaxed);
+		cost.cycles.store(0, std::memory_order_relaxed);
+	}
+
+	parse_latency.reset();
+}
+
+void ParseStats::print(std::ostream& o) const {
+	static const char* const phase_names[] = { "parse", "match", "params", "postcond" };
+
+	auto line = [&](const char* name, std::uint64_t value) {
+		if (value != 0)
+			o << name << ' ' << value << '\n';
+	};
+
+	line("args_parses", parses);
+	line("args_match_attempts", match_attempts);
+	line("args_precond_evals", precond_evals);
+	line("args_state_clones", state_clones);
+	line("args_param_parses", param_parses);
+	line("args_keyword_lookups", keyword_lookups);
+	line("args_postcond_evals", postcond_evals);
+	line("args_result_allocations", result_allocations);
+
+	for (unsigned i = 0; i < static_cast<unsigned>(Phase::Count); i++) {
+		if (phase_cycles[i] != 0)
+			o << "args_phase_cycles{phase=\"" << phase_names[i] << "\"} " << phase_cycles[i] << '\n';
+	}
+
+	for (std::size_t id = 0; id < max_args; id++) {
+		const auto& cost = args[id];
+
+		if (cost.attempts == 0)
+			continue;
+
+		o << "args_arg_attempts{id=\"" << id << "\"} " << cost.attempts << '\n';
+		o << "args_arg_matches{id=\"" << id << "\"} " << cost.matches << '\n';
+		o << "args_arg_cycles{id=\"" << id << "\"} " << cost.cycles << '\n';
+	}
+
+	if (parse_latency.count() != 0) {
+		for (double p : { 50.0, 90.0, 99.0, 99.9 })
+			o << "args_parse_cycles{quantile=\"" << p / 100 << "\"} " << parse_latency.percentile(p) << '\n';
+
+		o << "args_parse_cycles_count " << parse_latency.count() << '\n';
+	}
+}
+
+
+ParseStats& stats() {
+	static ParseStats s;
+	return s;
+}
+
+}
+}
+
+// lib/utils/mapped_file.cpp
+
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace args {
+
+
+MappedFile::MappedFile(const char* path) {
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return;
+
+	struct stat st;
+
+	if (::fstat(fd, &st) == 0) {
+		m_size = static_cast<std::size_t>(st.st_size);
+
+		if (m_size == 0) {
+			m_open = true;
+
+		} else {
+			void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (p != MAP_FAILED) {
+				m_data = static_cast<const char*>(p);
+				m_open = true;
+			} else {
+				m_size = 0;
+			}
+		}
+	}
+
+	::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+	: m_data(other.m_data)
+	, m_size(other.m_size)
+	, m_open(other.m_open) {
+
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_open = false;
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& other) {
+	if (this != &other) {
+		close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_open, other.m_open);
+	}
+
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+void MappedFile::close() {
+	if (m_data)
+		::munmap(const_cast<char*>(m_data), m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
+
+}
+
+// lib/utils/memory_resource.cpp
+
+#include <algorithm>
+#include <cstdint>
+
+namespace args {
+
+
+namespace {
+
+class NewDeleteResource : public MemoryResource {
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t) override {
+		return ::operator new(bytes);
+	}
+
+	void do_deallocate(void* p, std::size_t, std::size_t) override {
+		::operator delete(p);
+	}
+};
+
+class NullResource : public MemoryResource {
+protected:
+	void* do_allocate(std::size_t, std::size_t) override {
+		throw std::bad_alloc();
+	}
+
+	void do_deallocate(void*, std::size_t, std::size_t) override {
+	}
+};
+
+}
+
+
+MemoryResource* new_delete_resource() {
+	static NewDeleteResource res;
+	return &res;
+}
+
+MemoryResource* null_resource() {
+	static NullResource res;
+	return &res;
+}
+
+
+MonotonicBuffer::MonotonicBuffer(void* buffer, std::size_t size, MemoryResource* upstream)
+	: initial_buffer(static_cast<char*>(buffer))
+	, initial_size(size)
+	, current(initial_buffer)
+	, remaining(size)
+	, next_chunk_size(std::max<std::size_t>(size, 1024))
+	, upstream(upstream) {}
+
+MonotonicBuffer::MonotonicBuffer(std::size_t initial_chunk_size, MemoryResource* upstream)
+	: initial_buffer(nullptr)
+	, initial_size(0)
+	, current(nullptr)
+	, remaining(0)
+	, next_chunk_size(std::max<std::size_t>(initial_chunk_size, 64))
+	, upstream(upstream) {}
+
+MonotonicBuffer::~MonotonicBuffer() {
+	release();
+}
+
+void MonotonicBuffer::release() {
+	while (chunks) {
+		Chunk* previous = chunks->previous;
+		upstream->deallocate(chunks, chunks->size);
+		chunks = previous;
+	}
+
+	current = initial_buffer;
+	remaining = initial_size;
+}
+
+void* MonotonicBuffer::do_allocate(std::size_t bytes, std::size_t align) {
+	auto addr = reinterpret_cast<std::uintptr_t>(current);
+	std::size_t padding = (align - addr % align) % align;
+
+	if (!current || padding + bytes > remaining) {
+		// the chunk header is followed by its memory
+		std::size_t size = std::max(next_chunk_size, sizeof(Chunk) + align + bytes);
+
+		auto chunk = static_cast<Chunk*>(upstream->allocate(size));
+		chunk->previous = chunks;
+		chunk->size = size;
+		chunks = chunk;
+
+		current = reinterpret_cast<char*>(chunk + 1);
+		remaining = size - sizeof(Chunk);
+		next_chunk_size = size * 2;
+
+		addr = reinterpret_cast<std::uintptr_t>(current);
+		padding = (align - addr % align) % align;
+	}
+
+	char* p = current + padding;
+	current = p + bytes;
+	remaining -= padding + bytes;
+
+	return p;
+}
+
+}
+
+// lib/utils/name_table.cpp
+
+#include <algorithm>
+#include <cstring>
+
+namespace args {
+
+
+static bool name_less(const StrView& a, const StrView& b) {
+	return a < b;
+}
+
+static bool name_equal(const StrView& a, const StrView& b) {
+	return a == b;
+}
+
+
+void NameTable::add(StrView name) {
+	if (!name.empty())
+		names.push_back(name);
+}
+
+void NameTable::sort() {
+	std::sort(names.begin(), names.end(), name_less);
+	names.erase(std::unique(names.begin(), names.end(), name_equal), names.end());
+}
+
+std::pair<NameTable::const_iterator, NameTable::const_iterator>
+NameTable::prefix_range(StrView prefix) const {
+	auto first = std::lower_bound(names.begin(), names.end(), prefix, name_less);
+
+	auto last = std::partition_point(first, names.end(),
+		[&](const StrView& name) {
+			return name.starts_with(prefix);
+		});
+
+	return { first, last };
+}
+
+StrView NameTable::resolve(StrView prefix) const {
+	auto i = std::lower_bound(names.begin(), names.end(), prefix, name_less);
+
+	if (i == names.end() || !i->starts_with(prefix))
+		return StrView();
+
+	if (i->size() == prefix.size())
+		return *i;
+
+	auto next = i + 1;
+
+	if (next != names.end() && next->starts_with(prefix))
+		return StrView();
+
+	return *i;
+}
+
+
+NameSuggester::NameSuggester(StrView token)
+	: token_size(token.size() <= 64 ? token.size() : 0)
+	, best_distance(std::max<std::size_t>(1, token.size() / 3) + 1) {
+
+	std::memset(char_masks, 0, sizeof(char_masks));
+
+	for (std::size_t i = 0; i < token_size; i++)
+		char_masks[static_cast<unsigned char>(token[i])] |= std::uint64_t(1) << i;
+}
+
+void NameSuggester::add(const NameTable& names) {
+	if (token_size == 0)
+		return;
+
+	for (const auto& name : names) {
+		std::size_t diff = name.size() > token_size
+			? name.size() - token_size
+			: token_size - name.size();
+
+		if (diff >= best_distance)
+			continue;
+
+		std::size_t d = distance(name, best_distance);
+
+		if (d < best_distance) {
+			best_distance = d;
+			best = name;
+		}
+	}
+}
+
+// Levenshtein distance between the token and name, with Hyyrö's formulation
+// of Myers' algorithm: bit i of pv/mv tells whether the distance between the
+// first i+1 characters of the token and the prefix of name grows/shrinks by
+// one from row i to row i+1. Stops early once the result can't be < bound.
+std::size_t NameSuggester::distance(StrView name, std::size_t bound) const {
+	const std::uint64_t high = std::uint64_t(1) << (token_size - 1);
+
+	std::uint64_t pv = token_size == 64 ? ~std::uint64_t(0) : (high << 1) - 1;
+	std::uint64_t mv = 0;
+	std::size_t score = token_size;
+
+	for (std::size_t j = 0; j < name.size(); j++) {
+		std::uint64_t eq = char_masks[static_cast<unsigned char>(name[j])];
+
+		std::uint64_t xv = eq | mv;
+		std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+
+		std::uint64_t ph = mv | ~(xh | pv);
+		std::uint64_t mh = pv & xh;
+
+		if (ph & high)
+			score++;
+		else if (mh & high)
+			score--;
+
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		std::size_t remaining = name.size() - j - 1;
+
+		if (score >= bound + remaining)
+			return score - remaining;
+	}
+
+	return score;
+}
+
+}
+
+// lib/utils/stat_batch.cpp
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ARGS_HAVE_IO_URING
+#endif
+#endif
+
+#ifdef ARGS_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace args {
+
+
+namespace {
+
+PathStat stat_one(const char* path) {
+	PathStat result;
+	struct stat st;
+
+	if (::stat(path, &st) != 0)
+		result.error = errno;
+	else
+		result.is_dir = S_ISDIR(st.st_mode);
+
+	return result;
+}
+
+
+#ifdef ARGS_HAVE_IO_URING
+
+// Minimal io_uring driven with raw syscalls (no liburing), used only to
+// submit statx requests in batches
+class StatRing {
+	int fd = -1;
+
+	unsigned sq_entries = 0;
+	unsigned cq_entries = 0;
+
+	void* sq_ring = MAP_FAILED;
+	void* cq_ring = MAP_FAILED;
+	std::size_t sq_ring_size = 0;
+	std::size_t cq_ring_size = 0;
+
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	std::size_t sqes_size = 0;
+
+	unsigned* sq_tail = nullptr;
+	unsigned* sq_mask = nullptr;
+	unsigned* sq_array = nullptr;
+
+	unsigned* cq_head = nullptr;
+	unsigned* cq_tail = nullptr;
+	unsigned* cq_mask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	std::vector<struct statx> buffers;
+
+	template <typename T>
+	static T* at(void* ring, unsigned offset) {
+		return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+	}
+
+	static unsigned load_acquire(unsigned* p) {
+		return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+	}
+
+	static void store_release(unsigned* p, unsigned value) {
+		__atomic_store_n(p, value, __ATOMIC_RELEASE);
+	}
+
+public:
+	explicit StatRing(unsigned entries) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof params);
+
+		fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+		if (fd < 0)
+			return;
+
+		sq_entries = params.sq_entries;
+		cq_entries = params.cq_entries;
+
+		sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+		if (single_mmap)
+			sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+		sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+		if (sq_ring == MAP_FAILED)
+			return;
+
+		cq_ring = single_mmap ? sq_ring : ::mmap(nullptr, cq_ring_size,
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+		if (cq_ring == MAP_FAILED)
+			return;
+
+		sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+		if (sqes == MAP_FAILED)
+			return;
+
+		sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+		sq_mask = at<unsigned>(sq_ring, params.sq_off.ring_mask);
+		sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+
+		cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+		cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+		cq_mask = at<unsigned>(cq_ring, params.cq_off.ring_mask);
+		cqes = at<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+		buffers.resize(sq_entries);
+	}
+
+	StatRing(const StatRing&) = delete;
+	StatRing& operator= (const StatRing&) = delete;
+
+	~StatRing() {
+		if (sqes != MAP_FAILED)
+			::munmap(sqes, sqes_size);
+
+		if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+			::munmap(cq_ring, cq_ring_size);
+
+		if (sq_ring != MAP_FAILED)
+			::munmap(sq_ring, sq_ring_size);
+
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	bool is_open() const {
+		return fd >= 0 && sqes != MAP_FAILED;
+	}
+
+	// waits for the completions of the requests still in flight, which write
+	// to buffers. False if the ring failed, buffers must then be leaked
+	bool drain(unsigned in_flight) {
+		while (in_flight > 0) {
+			long ret = ::syscall(__NR_io_uring_enter, fd, 0, in_flight,
+					IORING_ENTER_GETEVENTS, nullptr, 0);
+
+			if (ret < 0 && errno != EINTR)
+				return false;
+
+			unsigned head = *cq_head;
+			unsigned cq_end = load_acquire(cq_tail);
+
+			in_flight -= cq_end - head;
+			store_release(cq_head, cq_end);
+		}
+
+		return true;
+	}
+
+	// false if the kernel can't stat through io_uring, out is then incomplete.
+	// Every submitted request has completed when it returns
+	bool stat_all(const std::vector<const char*>& paths, std::vector<PathStat>& out) {
+		std::size_t next = 0;
+
+		while (next < paths.size()) {
+			// a batch never exceeds the rings, so it's submitted and reaped
+			// with a single io_uring_enter
+			unsigned batch = static_cast<unsigned>(std::min<std::size_t>(
+					std::min(sq_entries, cq_entries), paths.size() - next));
+
+			unsigned tail = *sq_tail;
+
+			for (unsigned i = 0; i < batch; i++) {
+				unsigned index = tail & *sq_mask;
+				io_uring_sqe& sqe = sqes[index];
+
+				std::memset(&sqe, 0, sizeof sqe);
+				sqe.opcode = IORING_OP_STATX;
+				sqe.fd = AT_FDCWD;
+				sqe.addr = reinterpret_cast<std::uintptr_t>(paths[next + i]);
+				sqe.len = STATX_TYPE;
+				sqe.off = reinterpret_cast<std::uintptr_t>(&buffers[i]);
+				sqe.statx_flags = AT_STATX_SYNC_AS_STAT;
+				sqe.user_data = i;
+
+				sq_array[index] = index;
+				tail++;
+			}
+
+			store_release(sq_tail, tail);
+
+			unsigned submitted = 0;
+			unsigned completed = 0;
+			bool supported = true;
+
+			while (completed < batch) {
+				long ret = ::syscall(__NR_io_uring_enter, fd,
+						batch - submitted, batch - completed,
+						IORING_ENTER_GETEVENTS, nullptr, 0);
+
+				if (ret < 0 && errno != EINTR) {
+					// the requests the kernel took still write to buffers
+					if (!drain(submitted - completed))
+						abandon_buffers();
+
+					return false;
+				}
+
+				if (ret > 0)
+					submitted += ret;
+
+				unsigned head = *cq_head;
+				unsigned cq_end = load_acquire(cq_tail);
+
+				for (; head != cq_end; head++) {
+					const io_uring_cqe& cqe = cqes[head & *cq_mask];
+
+					// statx is never invalid here, the opcode is unsupported
+					if (cqe.res == -EINVAL)
+						supported = false;
+
+					PathStat& result = out[next + cqe.user_data];
+
+					result.error = cqe.res < 0 ? -cqe.res : 0;
+					result.is_dir = cqe.res == 0 && S_ISDIR(buffers[cqe.user_data].stx_mode);
+
+					completed++;
+				}
+
+				store_release(cq_head, head);
+			}
+
+			if (!supported)
+				return false;
+
+			next += batch;
+		}
+
+		return true;
+	}
+
+private:
+	// for when the ring failed with requests in flight: the kernel may still
+	// write to buffers after the ring is closed, so they're never freed
+	void abandon_buffers() {
+		new std::vector<struct statx>(std::move(buffers));
+	}
+};
+
+#endif
+
+}
+
+
+void stat_batch(const std::vector<const char*>& paths, std::vector<PathStat>& out,
+		ThreadPool* pool, StatMethod method) {
+
+	out.assign(paths.size(), PathStat());
+
+	if (paths.empty())
+		return;
+
+#ifdef ARGS_HAVE_IO_URING
+	if (method == StatMethod::IoUring) {
+		unsigned entries = 1;
+
+		while (entries < paths.size() && entries < 4096)
+			entries *= 2;
+
+		StatRing ring(entries);
+
+		if (ring.is_open() && ring.stat_all(paths, out))
+			return;
+	}
+#else
+	(void) method;
+#endif
+
+	if (pool) {
+		pool->run(paths.size(), [&](std::size_t, std::size_t i) {
+			out[i] = stat_one(paths[i]);
+		});
+
+	} else {
+		for (std::size_t i = 0; i < paths.size(); i++)
+			out[i] = stat_one(paths[i]);
+	}
+}
+
+}
+
+// lib/utils/thread_pool.cpp
+
+#include <algorithm>
+
+namespace args {
+
+
+ThreadPool::ThreadPool(std::size_t threads) {
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	ranges.reset(new Range[threads]);
+
+	for (std::size_t w = 0; w < threads; w++) {
+		ranges[w].next = 0;
+		ranges[w].end = 0;
+	}
+
+	for (std::size_t w = 1; w < threads; w++)
+		workers.emplace_back(&ThreadPool::worker_loop, this, w);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	start_cv.notify_all();
+
+	for (auto& t : workers)
+		t.join();
+}
+
+
+void ThreadPool::run(std::size_t count, const Task& task) {
+	std::size_t n = size();
+
+	for (std::size_t w = 0; w < n; w++) {
+		ranges[w].next.store(count * w / n, std::memory_order_relaxed);
+		ranges[w].end = count * (w + 1) / n;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		running = workers.size();
+		generation++;
+	}
+
+	start_cv.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done_cv.wait(lock, [&] { return running == 0; });
+	this->task = nullptr;
+}
+
+
+void ThreadPool::work(std::size_t worker) {
+	std::size_t n = size();
+
+	for (std::size_t k = 0; k < n; k++) {
+		// own range first, then steal from the next ones
+		Range& r = ranges[(worker + k) % n];
+
+		for (;;) {
+			std::size_t i = r.next.fetch_add(1, std::memory_order_relaxed);
+
+			if (i >= r.end)
+				break;
+
+			(*task)(worker, i);
+		}
+	}
+}
+
+void ThreadPool::worker_loop(std::size_t worker) {
+	std::size_t seen = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start_cv.wait(lock, [&] { return stopping || generation != seen; });
+
+			if (stopping)
+				return;
+
+			seen = generation;
+		}
+
+		work(worker);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (--running == 0)
+			done_cv.notify_one();
+	}
+}
+
+}
+
+// lib/utils/tokenizer.cpp
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace args {
+
+
+namespace {
+
+bool is_shell_special(char c) {
+	return is_word_separator(c) || c == '\'' || c == '"' || c == '\\';
+}
+
+bool is_dquote_special(char c) {
+	return c == '"' || c == '\\';
+}
+
+bool is_dquote_escape(char c) {
+	return c == '$' || c == '`' || c == '"' || c == '\\';
+}
+
+#ifdef __SSE2__
+
+// bit i is set if the byte i of v is c
+int match(__m128i v, char c) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+int ctz(int mask) {
+	return __builtin_ctz(static_cast<unsigned>(mask));
+}
+
+#endif
+
+// first word separator, quote or backslash in [p, end), or end
+const char* find_shell_special(const char* p, const char* end) {
+#ifdef __SSE2__
+	for (; end - p >= 16; p += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		int mask = match(v, ' ') | match(v, '\t') | match(v, '\n') | match(v, '\r')
+			| match(v, '\'') | match(v, '"') | match(v, '\\');
+
+		if (mask != 0)
+			return p + ctz(mask);
+	}
+#endif
+
+	while (p < end && !is_shell_special(*p))
+		p++;
+
+	return p;
+}
+
+// first '"' or backslash in [p, end), or end
+const char* find_dquote_special(const char* p, const char* end) {
+#ifdef __SSE2__
+	for (; end - p >= 16; p += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		int mask = match(v, '"') | match(v, '\\');
+
+		if (mask != 0)
+			return p + ctz(mask);
+	}
+#endif
+
+	while (p < end && !is_dquote_special(*p))
+		p++;
+
+	return p;
+}
+
+
+// A word being built from runs of literal characters. It stays a view into
+// the input as long as the runs are contiguous, and is copied into buffer
+// once they aren't.
+struct ShellWord {
+	std::string& buffer;
+	const char* data;
+	std::size_t size;
+	bool copied;
+
+	ShellWord(std::string& buffer, const char* start)
+		: buffer(buffer)
+		, data(start)
+		, size(0)
+		, copied(false) {}
+
+	void append(const char* p, std::size_t n) {
+		if (n == 0)
+			return;
+
+		if (!copied) {
+			if (size == 0)
+				data = p;
+
+			if (data + size == p) {
+				size += n;
+				return;
+			}
+
+			std::size_t start = buffer.size();
+			buffer.append(data, size);
+			data = &buffer[start];
+			copied = true;
+		}
+
+		buffer.append(p, n);
+		size += n;
+	}
+
+	StrView view() const {
+		return StrView(data, size);
+	}
+};
+
+}
+
+
+template <typename Words>
+bool split_shell(StrView s, Words& words, std::string& buffer,
+		std::vector<std::size_t>* word_ends) {
+	buffer.clear();
+	buffer.reserve(s.size());
+
+	const char* p = s.begin();
+	const char* end = s.end();
+
+	while (true) {
+		while (p < end && is_word_separator(*p))
+			p++;
+
+		if (p == end)
+			return true;
+
+		ShellWord word(buffer, p);
+
+		while (p < end && !is_word_separator(*p)) {
+			const char* q = find_shell_special(p, end);
+			word.append(p, q - p);
+			p = q;
+
+			if (p == end || is_word_separator(*p))
+				break;
+
+			char c = *p++;
+
+			if (c == '\\') {
+				if (p == end)
+					return false;
+
+				if (*p != '\n')
+					word.append(p, 1);
+
+				p++;
+
+			} else if (c == '\'') {
+				q = static_cast<const char*>(std::memchr(p, '\'', end - p));
+
+				if (!q)
+					return false;
+
+				word.append(p, q - p);
+				p = q + 1;
+
+			} else {
+				while (true) {
+					q = find_dquote_special(p, end);
+					word.append(p, q - p);
+					p = q;
+
+					if (p == end)
+						return false;
+
+					if (*p++ == '"')
+						break;
+
+					if (p == end)
+						return false;
+
+					if (is_dquote_escape(*p))
+						word.append(p++, 1);
+					else if (*p == '\n')
+						p++;
+					else
+						word.append(p - 1, 1);
+				}
+			}
+		}
+
+		words.push_back(word.view());
+
+		if (word_ends)
+			word_ends->push_back(p - s.begin());
+	}
+}
+
+template bool split_shell(StrView, std::vector<StrView>&, std::string&,
+		std::vector<std::size_t>*);
+template bool split_shell(StrView, PolyVector<StrView>&, std::string&,
+		std::vector<std::size_t>*);
+
+}
+
+#endif
@@ -20,19 +20,48 @@
 #include "args/flag.hpp"
 #include "args/lambda_arg.hpp"
 #include "args/map_lookup_arg.hpp"
+#include "args/rest_arg.hpp"
 
+#include "args/flag/lazy_param.hpp"
 #include "args/flag/param_parsers.hpp"
+#include "args/flag/path_params.hpp"
 
 #include "common/arg.hpp"
+#include "common/batch.hpp"
+#include "common/grammar.hpp"
+#include "common/incremental.hpp"
+#include "common/match_log.hpp"
 #include "common/parse_error.hpp"
+#include "common/parse_session.hpp"
 #include "common/parser.hpp"
 #include "common/parser_state.hpp"
+#include "common/result_cache.hpp"
+#include "common/result_codec.hpp"
+#include "common/schema.hpp"
 #include "common/types.hpp"
+#include "common/validation.hpp"
+#include "common/visitor.hpp"
 
+#include "display/complete.hpp"
 #include "display/error.hpp"
 #include "display/help.hpp"
 
 #include "functors/condition.hpp"
 
+#include "sources/config_source.hpp"
+#include "sources/env_source.hpp"
+#include "sources/source.hpp"
+
+#include "utils/alloc_audit.hpp"
+#include "utils/file_watch.hpp"
+#include "utils/hash.hpp"
+#include "utils/instrument.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/memory_resource.hpp"
+#include "utils/name_table.hpp"
 #include "utils/result.hpp"
+#include "utils/snapshots.hpp"
+#include "utils/stat_batch.hpp"
 #include "utils/string_view.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/tokenizer.hpp"
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Parse throughput of the build configurations, see `make bench`: linked
+// against lib/libargs.so, or with args.hpp and ARGS_IMPLEMENTATION, and for
+// reference linked against the shared library from before the parse hot path
+// moved into the headers.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "args.hpp"
+
+
+template <typename F>
+double ns_per_token(std::size_t tokens, std::size_t rounds, F&& f) {
+	using Clock = std::chrono::steady_clock;
+
+	double best = 0;
+
+	// best of 5, to leave out the noise of the machine
+	for (int run = 0; run < 5; run++) {
+		auto start = Clock::now();
+
+		for (std::size_t i = 0; i < rounds; i++)
+			f();
+
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+		double per_token = static_cast<double>(ns.count()) / (tokens * rounds);
+
+		if (run == 0 || per_token < best)
+			best = per_token;
+	}
+
+	return best;
+}
+
+
+int main() {
+	using namespace args::condition;
+
+	auto verbose = args::flag('v', "verbose");
+	auto jobs = args::flag<int>('j', "jobs");
+	auto output = args::flag<std::string>('o', "output");
+	auto define = args::flag<args::StrView, args::StrView>('D', "define");
+	auto dry_run = args::flag('n', "dry-run");
+
+	enum class Command { BUILD, RUN, TEST };
+	auto command = args::map_lookup_arg<Command>({
+		{ "build", Command::BUILD },
+		{ "run",   Command::RUN   },
+		{ "test",  Command::TEST  }
+	});
+
+	auto flags = args::flags(verbose, jobs, output, define, dry_run);
+	auto positionals = args::args(command);
+
+	// a typical command line
+	std::vector<const char*> short_argv = {
+		"-vv", "build", "--jobs", "8", "-o", "out/bin", "--define", "KEY", "value",
+		"-n", "test", "--verbose", "-j4", "--output=out/lib", "run"
+	};
+
+	// a huge generated one
+	std::vector<std::string> storage;
+
+	for (int i = 0; i < 20000; i++) {
+		storage.push_back("-v");
+		storage.push_back("--jobs=" + std::to_string(i % 64));
+		storage.push_back("build");
+		storage.push_back("-D");
+		storage.push_back("K" + std::to_string(i));
+		storage.push_back("V");
+	}
+
+	std::vector<const char*> long_argv;
+
+	for (const auto& token : storage)
+		long_argv.push_back(token.c_str());
+
+
+	auto session = args::session(flags, positionals);
+	bool ok = true;
+
+	auto parse_short = [&]() {
+		ok &= session.parse(begin(short_argv), end(short_argv)).is_ok();
+	};
+
+	auto parse_long = [&]() {
+		ok &= session.parse(begin(long_argv), end(long_argv)).is_ok();
+	};
+
+	double short_ns = ns_per_token(short_argv.size(), 100000, parse_short);
+	double long_ns = ns_per_token(long_argv.size(), 20, parse_long);
+
+	if (!ok) {
+		std::fprintf(stderr, "parse failed\n");
+		return 1;
+	}
+
+	std::printf("short argv (%zu tokens): %.2f ns/token\n", short_argv.size(), short_ns);
+	std::printf("long argv (%zu tokens): %.2f ns/token\n", long_argv.size(), long_ns);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Checks that the views kept in the results of an IncrementalSession stay
+// valid while the line is edited, see `make incremental_test`. Built with
+// AddressSanitizer, so a view into a freed line or buffer is reported.
+// Checks the views that ResultCache hits load into the results, see
+// `make cache_test`. Built with AddressSanitizer, so a view into an unmapped
+// entry is reported.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "args.hpp"
+
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+int main() {
+	char dir[] = "/tmp/args_cache_test.XXXXXX";
+
+	if (!mkdtemp(dir)) {
+		std::printf("FAILED: mkdtemp\n");
+		return 1;
+	}
+
+	args::ResultCache cache(dir);
+
+	auto name = args::flag<args::StrView>('n', "name");
+	auto name_parser = args::flags(name);
+
+	auto jobs = args::flag<int>('j', "jobs");
+	auto jobs_parser = args::flags(jobs);
+
+	const char* named[] = { "-n", "a name read from the cache" };
+	const char* other[] = { "-j", "4" };
+
+	// the first parse stores the entry, the second one loads it
+	for (int i = 0; i < 2; i++)
+		check(args::parse_cached(cache, named, named + 2, name_parser).is_ok(), "named parse");
+
+	check(cache.hits() == 1, "hit");
+	check(std::get<0>(name.result[0]).c_str() != named[1], "name loaded from the entry");
+
+	// a miss, and a missing entry, must not unmap the entry of the hit
+	check(args::parse_cached(cache, other, other + 2, jobs_parser).is_ok(), "other parse");
+	check(cache.misses() == 2, "miss");
+
+	check(std::get<0>(name.result[0]) == "a name read from the cache", "view kept across a miss");
+
+	std::system((std::string("rm -rf ") + dir).c_str());
+
+
+	if (failures == 0)
+		std::printf("cache_test: OK\n");
+
+	return failures == 0 ? 0 : 1;
+}
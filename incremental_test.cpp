@@ -0,0 +1,77 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Checks that the views kept in the results of an IncrementalSession stay
+// valid while the line is edited, see `make incremental_test`. Built with
+// AddressSanitizer, so a view into a freed line or buffer is reported.
+
+#include <cstdio>
+#include <string>
+
+#include "args.hpp"
+
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+int main() {
+	auto name = args::flag<args::StrView>('n', "name");
+	auto verbose = args::flag('v', "verbose");
+	auto lazy = args::flag<args::Lazy<int>>('l', "lazy");
+	auto parser = args::flags(name, verbose, lazy);
+
+	auto editing = args::incremental_session(parser);
+
+	// 'ab cd' is unescaped into the buffer of the update, -l 12 is a view
+	// into its line
+	std::string line = "-n 'ab cd' -l 12 -v";
+	check(editing.update(line).is_ok(), "first update");
+
+	for (int i = 0; i < 50; i++) {
+		line += " -v";
+		check(editing.update(line).is_ok(), "appending update");
+		// the last token may have been extended, so it is parsed again too
+		check(editing.tokens_reparsed() == 2, "only the last tokens are parsed");
+	}
+
+	check(std::get<0>(name.result[0]) == "ab cd", "unescaped view kept across updates");
+	check(std::get<0>(lazy.result[0]).get() == 12, "view into the line kept across updates");
+	check(verbose.multiplicity == 51, "every appended flag counted");
+
+	// editing the value parses it again, into a new buffer
+	line.replace(7, 2, "xy");
+	check(editing.update(line).is_ok(), "editing update");
+	check(std::get<0>(name.result[0]) == "ab xy", "edited value");
+
+	line += " -v";
+	check(editing.update(line).is_ok(), "appending after the edit");
+	check(std::get<0>(name.result[0]) == "ab xy", "edited value kept");
+
+
+	if (failures == 0)
+		std::printf("incremental_test: OK\n");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -31,6 +31,7 @@
 #include "functors/condition.hpp"
 
 #include "flag/flag_matcher.hpp"
+#include "flag/lazy_param.hpp"
 #include "flag/param_parser.hpp"
 
 
@@ -79,7 +80,9 @@ class Flag : public Arg<
 		return res;
 	}
 
-	TupResult parse_params(ParserState& s) {
+	static TupResult parse_params(ParserState& s) {
+		ARGS_TIME_PHASE(Params);
+
 		ParamsTuple tup;
 
 		auto res = parse_params_iter<0>(s, tup);
@@ -90,6 +93,17 @@ class Flag : public Arg<
 			return TupResult::err(std::move(res));
 	}
 
+	template <std::size_t I>
+	If<I == N, void> set_owner_iter(ParamsTuple&) const {
+	}
+
+	// lets Lazy parameters report their conversion errors for this flag
+	template <std::size_t I>
+	If<I < N, void> set_owner_iter(ParamsTuple& tup) const {
+		set_param_owner(std::get<I>(tup), this);
+		set_owner_iter<I+1>(tup);
+	}
+
 	void fmt_metavars(Str& s) const {
 		if (!doc_metavars.empty()) {
 			s += " ";
@@ -99,25 +113,56 @@ class Flag : public Arg<
 
 public:
 
+	static constexpr std::size_t value_arity = N;
+
 	Str doc_metavars;
 
 
 	Flag(char shortopt, Str longopt, PreCond precond, PostCond postcond)
 		: Arg<ParamsTuple, PreCond, PostCond, Flag>(
 				std::move(precond), std::move(postcond))
-		, matcher(shortopt, std::move(longopt)) {}
+		, matcher(shortopt, std::move(longopt)) {
+
+		if (matcher.longopt.compare(0, 2, "--") == 0)
+			this->source_key = matcher.longopt.substr(2);
+	}
 
 	Flag(Flag&&) = default;
 
 
-	TupResult parse_impl(ParserState& s) {
+	TupResult parse_impl(ParserState& s) const {
 		if (!s.bounds_check() || !s.offset_check())
 			return TupResult::err(BoundError("Flag::parse"));
 
-		if (matcher.match(s))
-			return parse_params(s);
-		else
+		if (!matcher.match(s))
 			return TupResult::err(ParseError(UnknownArg(s)));
+
+		auto res = parse_params(s);
+
+		// "--name=value" where the flag has no parameters
+		if (res.is_ok() && s.str_off != 0 && s.token_class() == TokenClass::LongoptValue) {
+			return TupResult::err(ParseError(InvalidParam(
+				"unexpected value",
+				s.arg().substr(s.str_off))));
+		}
+
+		if (res.is_ok())
+			set_owner_iter<0>(res.get_ok());
+
+		return res;
+	}
+
+	TupResult parse_value_impl(ParserState& s) const {
+		auto res = parse_params(s);
+
+		if (res.is_ok())
+			set_owner_iter<0>(res.get_ok());
+
+		return res;
+	}
+
+	void collect_names(NameTable& names) const {
+		names.add(matcher.longopt);
 	}
 
 
@@ -152,26 +197,42 @@ public:
 
 template <typename... FlagTs>
 class FlagParser : public ArgParser<FlagTs...> {
-
-	bool found_endflags = false;
-
 public:
 
 	using ArgParser<FlagTs...>::ArgParser;
 
-	ParseResultVoid parse(OwnedParserState& s) {
-		if (s.bounds_check() && s.arg() == "--")
-			found_endflags = true;
+	ParseResultVoid parse(OwnedParserState& s) const {
+		ArgSink sink;
+		return parse(s, sink);
+	}
+
+	template <typename Sink>
+	ParseResultVoid parse(OwnedParserState& s, Sink& sink) const {
+		auto token_class = s.token_class();
+
+		// the first "--" is consumed here, every token after it is positional
+		if (token_class == TokenClass::EndOfFlags && !s.end_of_flags) {
+			s.end_of_flags = true;
+			s.pos++;
+			return success();
+		}
+
+		bool longopt = token_class == TokenClass::Longopt
+			|| token_class == TokenClass::LongoptValue;
 
-		const auto& arg = s.arg();
+		s.longopt_match = longopt && !s.end_of_flags
+			? this->names().resolve(longopt_name(s.arg()))
+			: StrView();
 
-		if (found_endflags || arg == "-" || (arg.size() >= 1 && arg[0] != '-'))
+		if (s.end_of_flags
+				|| token_class == TokenClass::Positional
+				|| token_class == TokenClass::Dash)
 			return ParseError(UnknownArg(s));
 
-		if (s.str_off == 0 && arg.size() >= 2 && arg[0] == '-' && arg[1] != '-')
+		if (s.str_off == 0 && token_class == TokenClass::ShortoptCluster)
 			FlagMatcher::advance_shortopt(s);
 
-		return this->ArgParser<FlagTs...>::parse(s);
+		return this->ArgParser<FlagTs...>::parse(s, sink);
 	}
 };
 
@@ -15,15 +15,54 @@ struct FlagMatcher {
 	char shortopt;
 	Str longopt;
 
-	FlagMatcher(char shortopt, Str longopt);
+	FlagMatcher(char shortopt, Str longopt)
+		: shortopt(shortopt)
+		, longopt(std::move(longopt)) {}
 
-	bool match_shortopt(const ParserState& s) const;
+	bool match_shortopt(const ParserState& s) const {
+		return shortopt != no_shortopt && s.ch() == shortopt;
+	}
 
-	bool match_longopt(const ParserState& s) const;
+	bool match_longopt(const ParserState& s) const {
+		auto token_class = s.token_class();
 
-	bool match(ParserState& s) const;
+		if (s.str_off != 0 ||
+				(token_class != TokenClass::Longopt && token_class != TokenClass::LongoptValue))
+			return false;
 
-	static void advance_shortopt(ParserState& s);
+		return s.longopt_match.empty()
+			? longopt_name(s.arg()) == longopt
+			: s.longopt_match == longopt;
+	}
+
+	bool match(ParserState& s) const {
+		if (match_shortopt(s)) {
+			advance_shortopt(s);
+			return true;
+		}
+
+		else if (match_longopt(s)) {
+			// the value of "--name=value" is read by ParserState::param_next
+			if (s.token_class() == TokenClass::LongoptValue)
+				s.str_off = longopt_name(s.arg()).size() + 1;
+			else
+				s.pos++;
+
+			return true;
+		}
+
+		else
+			return false;
+	}
+
+	static void advance_shortopt(ParserState& s) {
+		s.str_off++;
+
+		if (s.str_off == s.arg().size()) {
+			s.str_off = 0;
+			s.pos++;
+		}
+	}
 };
 
 }
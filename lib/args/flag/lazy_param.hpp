@@ -0,0 +1,147 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_LAZY_PARAM_H
+#define ARGS_LAZY_PARAM_H
+
+#include "common/types.hpp"
+#include "common/match_log.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+
+#include "args/flag/param_parser.hpp"
+
+#include "utils/instrument.hpp"
+
+
+namespace args {
+
+// Cheap check of a parameter of type Lazy<T> at parse time, before it's
+// converted. Accepts everything unless specialized.
+template <typename T>
+struct ParamCheck {
+	static ParseResultVoid check(const StrView&) {
+		return success();
+	}
+};
+
+
+// Parameter that is only converted by ParamParser<T> when it's first read
+// (e.g. flag<Lazy<Regex>>), for parameters that are expensive to convert and
+// rarely used. Until then only the token is stored, as a view: argv (or the
+// source the value came from) must outlive it. The conversion is cached, and
+// it's not thread-safe.
+template <typename T>
+class Lazy {
+	StrView param;
+	const BaseArg* owner = nullptr;
+
+	mutable bool converted = false;
+	mutable T value = T();
+	mutable ParseError error = success();
+
+	void convert() const {
+		if (converted)
+			return;
+
+		converted = true;
+
+		Argv tokens(1, param);
+		MatchLog matched;
+		ParserState s(matched, tokens);
+
+		auto res = ParamParser<T>::parse(s);
+
+		if (res.is_ok()) {
+			value = std::move(res.get_ok());
+		} else {
+			error = std::move(res.get_err());
+			error.set_arg(owner);
+		}
+	}
+
+public:
+	Lazy() = default;
+
+	explicit Lazy(StrView param)
+		: param(param) {}
+
+
+	// the unconverted parameter
+	const StrView& token() const {
+		return param;
+	}
+
+	// the argument the parameter belongs to, reported with conversion errors
+	void set_owner(const BaseArg* arg) {
+		owner = arg;
+	}
+
+	// converts the parameter if it hasn't been yet. success(), or the error of
+	// ParamParser<T> (e.g. for report_error)
+	const ParseError& status() const {
+		convert();
+		return error;
+	}
+
+	bool ok() const {
+		return status().is_ok();
+	}
+
+	// the converted parameter, T() if the conversion failed
+	const T& get() const {
+		convert();
+		return value;
+	}
+};
+
+
+template <typename T>
+void set_param_owner(T&, const BaseArg*) {
+}
+
+template <typename T>
+void set_param_owner(Lazy<T>& param, const BaseArg* arg) {
+	param.set_owner(arg);
+}
+
+
+template <typename T>
+struct ParamParser<Lazy<T>> {
+	using Result = ParseResult<Lazy<T>>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<Lazy>"));
+
+		auto param = s.param_next();
+		auto res = ParamCheck<T>::check(param);
+
+		if (!res.is_ok())
+			return Result::err(std::move(res));
+
+		return Result::ok(param);
+	}
+};
+
+}
+
+#endif
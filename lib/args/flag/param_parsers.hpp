@@ -20,7 +20,11 @@
 #ifndef ARGS_PARAM_PARSERS_H
 #define ARGS_PARAM_PARSERS_H
 
-#include <sstream>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 
 #include "common/types.hpp"
 #include "common/parse_error.hpp"
@@ -28,6 +32,9 @@
 
 #include "args/flag/param_parser.hpp"
 
+#include "utils/alloc_audit.hpp"
+#include "utils/instrument.hpp"
+
 
 namespace args {
 
@@ -36,14 +43,14 @@ struct ParamParser<bool> {
 	using Result = ParseResult<bool>;
 
 	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
 		if (!s.bounds_check())
 			return Result::err(BoundError("ParamParser<bool>"));
 
-		const auto& arg = s.arg_next();
+		auto arg = s.param_next();
 
-		if (s.str_off != 0)
-			return Result::err(ParseError(InvalidShortoptList(arg)));
-		else if (arg == "true")
+		if (arg == "true")
 			return Result::ok(true);
 		else if (arg == "false")
 			return Result::ok(false);
@@ -57,20 +64,44 @@ struct ParamParser<int> {
 	using Result = ParseResult<int>;
 
 	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
 		if (!s.bounds_check())
 			return Result::err(BoundError("ParamParser<int>"));
 
-		const auto& arg = s.arg_next();
+		auto arg = s.param_next();
 
 		int result;
 
-		if (s.str_off != 0)
-			return Result::err(ParseError(InvalidShortoptList(arg)));
-		else if (std::istringstream(arg.c_str()) >> result)
+		if (parse_int(arg, result))
 			return Result::ok(result);
 		else
 			return Result::err(ParseError(InvalidParam("could not parse int", arg)));
 	}
+
+	// the whole argument must be a base 10 integer in range. no allocations,
+	// the argument is copied to the stack so that it doesn't need a '\0'
+	static bool parse_int(const StrView& arg, int& result) {
+		char buf[32];
+
+		if (arg.empty() || arg.size() >= sizeof buf)
+			return false;
+
+		std::memcpy(buf, arg.c_str(), arg.size());
+		buf[arg.size()] = '\0';
+
+		char* end;
+		errno = 0;
+		long value = std::strtol(buf, &end, 10);
+
+		if (errno != 0 || end != buf + arg.size() || std::isspace(static_cast<unsigned char>(buf[0])) ||
+				value < std::numeric_limits<int>::min() ||
+				value > std::numeric_limits<int>::max())
+			return false;
+
+		result = static_cast<int>(value);
+		return true;
+	}
 };
 
 template <>
@@ -78,15 +109,48 @@ struct ParamParser<Str> {
 	using Result = ParseResult<Str>;
 
 	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
 		if (!s.bounds_check())
 			return Result::err(BoundError("ParamParser<Str>"));
 
-		const auto& arg = s.arg_next();
+		auto param = s.param_next();
+		AllocExempt owned_data;
 
-		if (s.str_off != 0)
-			return Result::err(ParseError(InvalidShortoptList(arg)));
-		else
-			return Result::ok(arg.str());
+		return Result::ok(param.str());
+	}
+};
+
+// the parameter as a view into argv, which must outlive the results
+template <>
+struct ParamParser<StrView> {
+	using Result = ParseResult<StrView>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<StrView>"));
+
+		return Result::ok(s.param_next());
+	}
+};
+
+// the parameter allocated from the resource of the state
+template <>
+struct ParamParser<PolyString> {
+	using Result = ParseResult<PolyString>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<PolyString>"));
+
+		auto param = s.param_next();
+		AllocExempt owned_data;
+
+		return Result::ok(PolyString(param.c_str(), param.size(), s.resource));
 	}
 };
 
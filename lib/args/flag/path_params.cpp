@@ -0,0 +1,73 @@
+#include "args/flag/path_params.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+namespace args {
+
+
+// the directory of a path, as given ("dir/" for "dir/file", "." for "file")
+static Str parent_dir(const Str& path) {
+	auto end = path.find_last_not_of('/');
+
+	if (end == Str::npos)
+		return "/";
+
+	auto slash = path.rfind('/', end);
+
+	if (slash == Str::npos)
+		return ".";
+
+	return slash == 0 ? "/" : path.substr(0, slash + 1);
+}
+
+
+ParseResultVoid PathChecks::check(const Request& req, const PathStat& st) const {
+	bool parent = req.kind == PathKind::CreatableParent;
+
+	if (st.error == ENOENT)
+		return ParseError(InvalidParam(
+			parent ? "parent directory does not exist" : "does not exist",
+			*req.path, req.arg));
+
+	if (st.error != 0)
+		return ParseError(InvalidParam(std::strerror(st.error), *req.path, req.arg));
+
+	if (req.kind != PathKind::Existing && !st.is_dir)
+		return ParseError(InvalidParam(
+			parent ? "parent is not a directory" : "is not a directory",
+			*req.path, req.arg));
+
+	return success();
+}
+
+ParseResultVoid PathChecks::run(ThreadPool* pool, StatMethod method) {
+	parents.clear();
+	stat_paths.clear();
+
+	for (const auto& req : requests) {
+		if (req.kind == PathKind::CreatableParent)
+			parents.push_back(parent_dir(*req.path));
+	}
+
+	std::size_t parent = 0;
+
+	for (const auto& req : requests) {
+		stat_paths.push_back(req.kind == PathKind::CreatableParent
+			? parents[parent++].c_str()
+			: req.path->c_str());
+	}
+
+	stat_batch(stat_paths, stats, pool, method);
+
+	auto res = success();
+
+	for (std::size_t i = 0; i < requests.size() && res.is_ok(); i++)
+		res = check(requests[i], stats[i]);
+
+	requests.clear();
+
+	return res;
+}
+
+}
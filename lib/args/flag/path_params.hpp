@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_PATH_PARAMS_H
+#define ARGS_PATH_PARAMS_H
+
+#include <tuple>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/result_codec.hpp"
+
+#include "args/flag/param_parser.hpp"
+
+#include "utils/alloc_audit.hpp"
+#include "utils/instrument.hpp"
+#include "utils/stat_batch.hpp"
+#include "utils/thread_pool.hpp"
+
+
+namespace args {
+
+enum class PathKind : unsigned char {
+	Existing,       // must exist
+	Directory,      // must be an existing directory
+	CreatableParent // its parent must be an existing directory
+};
+
+// Path parameter (e.g. flag<ExistingPath>) checked by PathChecks after the
+// parse, so that the checks of all paths can be batched. The parse itself
+// only stores the path
+template <PathKind K>
+struct CheckedPath {
+	static constexpr PathKind kind = K;
+
+	Str path;
+
+	const Str& str() const {
+		return path;
+	}
+};
+
+using ExistingPath = CheckedPath<PathKind::Existing>;
+using ExistingDir = CheckedPath<PathKind::Directory>;
+using CreatablePath = CheckedPath<PathKind::CreatableParent>;
+
+
+template <PathKind K>
+struct ParamParser<CheckedPath<K>> {
+	using Result = ParseResult<CheckedPath<K>>;
+
+	static Result parse(ParserState& s) {
+		ARGS_COUNT(param_parses);
+
+		if (!s.bounds_check())
+			return Result::err(BoundError("ParamParser<CheckedPath>"));
+
+		auto param = s.param_next();
+		AllocExempt owned_data;
+
+		CheckedPath<K> path;
+		path.path = param.str();
+
+		return Result::ok(std::move(path));
+	}
+};
+
+template <PathKind K>
+struct ResultCodec<CheckedPath<K>> {
+	static void encode(const CheckedPath<K>& value, std::string& out) {
+		ResultCodec<Str>::encode(value.path, out);
+	}
+
+	static bool decode(ByteReader& in, CheckedPath<K>& value) {
+		return ResultCodec<Str>::decode(in, value.path);
+	}
+};
+
+
+// Checks the CheckedPath results of arguments (directly, or in the parameters
+// of flags) in one batch, see stat_batch
+class PathChecks {
+	struct Request {
+		const Str* path;
+		PathKind kind;
+		const BaseArg* arg;
+	};
+
+	std::vector<Request> requests;
+	std::vector<Str> parents;
+
+	std::vector<const char*> stat_paths;
+	std::vector<PathStat> stats;
+
+
+	template <typename T>
+	void collect(const T&, const BaseArg*) {
+	}
+
+	template <PathKind K>
+	void collect(const CheckedPath<K>& path, const BaseArg* arg) {
+		requests.push_back(Request { &path.path, K, arg });
+	}
+
+	template <typename... Ts>
+	void collect(const std::tuple<Ts...>& tup, const BaseArg* arg) {
+		collect_iter<0>(tup, arg);
+	}
+
+	template <std::size_t I, typename... Ts>
+	If<I == sizeof...(Ts), void> collect_iter(const std::tuple<Ts...>&, const BaseArg*) {
+	}
+
+	template <std::size_t I, typename... Ts>
+	If<I < sizeof...(Ts), void> collect_iter(const std::tuple<Ts...>& tup, const BaseArg* arg) {
+		collect(std::get<I>(tup), arg);
+		collect_iter<I+1>(tup, arg);
+	}
+
+	ParseResultVoid check(const Request& req, const PathStat& st) const;
+
+public:
+	// adds the paths among the current results of arg, which must not change
+	// until run()
+	template <typename A>
+	PathChecks& add(const A& arg) {
+		for (const auto& value : arg.result)
+			collect(value, &arg);
+
+		return *this;
+	}
+
+	// stats every path (see stat_batch) and returns the first failed check,
+	// in the order the paths were added, as an InvalidParam of its argument.
+	// The paths are forgotten afterwards
+	ParseResultVoid run(ThreadPool* pool = nullptr,
+			StatMethod method = StatMethod::Syscalls);
+};
+
+}
+
+#endif
@@ -33,6 +33,9 @@ namespace args {
 
 template <typename T, typename Parser, typename PreCond, typename PostCond>
 struct LambdaArg : public Arg<T, PreCond, PostCond, LambdaArg<T, Parser, PreCond, PostCond>> {
+	// the parser may consume any number of tokens
+	static constexpr bool bounded_tokens = false;
+
 	Parser parser;
 
 	LambdaArg(Parser&& parser, PreCond precond, PostCond postcond)
@@ -42,7 +45,7 @@ struct LambdaArg : public Arg<T, PreCond, PostCond, LambdaArg<T, Parser, PreCond
 
 		, parser(std::move(parser)) {}
 
-	ParseResult<T> parse_impl(ParserState& s) {
+	ParseResult<T> parse_impl(ParserState& s) const {
 		return parser(*this, s);
 	}
 
@@ -20,8 +20,10 @@
 #ifndef ARGS_MAP_LOOKUP_ARG_H
 #define ARGS_MAP_LOOKUP_ARG_H
 
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "common/types.hpp"
 #include "common/parse_error.hpp"
@@ -41,10 +43,23 @@ struct MapLookupArg : public Arg<T, PreCond, PostCond, MapLookupArg<T, PreCond,
 		: Arg<T, PreCond, PostCond, MapLookupArg>(
 				std::move(precond),
 				std::move(postcond))
-		, lookup_map(std::move(lookup_map)) {}
+		, lookup_map(std::move(lookup_map)) {
 
+		index_keys();
+	}
+
+	MapLookupArg(const MapLookupArg& other)
+		: Arg<T, PreCond, PostCond, MapLookupArg>(other)
+		, lookup_map(other.lookup_map) {
+
+		index_keys();
+	}
+
+	// the nodes of lookup_map are moved along with it, so the index stays valid
+	MapLookupArg(MapLookupArg&&) = default;
 
-	ParseResult<T> parse_impl(ParserState& s) {
+
+	ParseResult<T> parse_impl(ParserState& s) const {
 		using R = ParseResult<T>;
 
 		if (!s.bounds_check())
@@ -52,44 +67,82 @@ struct MapLookupArg : public Arg<T, PreCond, PostCond, MapLookupArg<T, PreCond,
 
 		const auto& arg = s.arg_next();
 
+		ARGS_COUNT(keyword_lookups);
+
 		if (s.str_off != 0)
 			return R::err(ParseError(InvalidShortoptList(arg)));
 
-		auto i = lookup_map.find(arg.str());
+		auto value = find(arg);
 
-		if (i == end(lookup_map)) {
+		if (!value) {
 			return R::err(ParseError(InvalidParam(
 				"expected one of " + fmt_keys("(", ", ", ")"),
 				arg)));
 		} else {
-			return R::ok(i->second);
+			return R::ok(*value);
 		}
 	}
 
+	// the value of key, null if it's not in lookup_map. unlike
+	// lookup_map.find(), this doesn't build a string from the token
+	const T* find(const StrView& key) const {
+		auto i = std::lower_bound(begin(sorted_keys), end(sorted_keys), key, key_less);
+
+		return i != end(sorted_keys) && i->first == key ? i->second : nullptr;
+	}
+
 	virtual Str to_str() const override {
 		return fmt_keys("", ", ", "");
 	}
 
 
+	void collect_names(NameTable& names) const {
+		for (const auto& entry : lookup_map)
+			names.add(entry.first);
+	}
+
 	Str fmt_keys(StrView lhs, StrView sep, StrView rhs) const {
 		auto i   = std::begin(lookup_map);
 		auto end = std::end(lookup_map);
 
-		Str s = lhs.c_str();
+		Str s = lhs.str();
 
 		if (!lookup_map.empty()) {
 			s += i->first;
 
 			while (++i != end) {
-				s += sep.c_str();
+				s += sep.str();
 				s += i->first;
 			}
 		}
 
-		s += rhs.c_str();
+		s += rhs.str();
 
 		return s;
 	}
+
+private:
+	using KeyEntry = std::pair<StrView, const T*>;
+
+	// the keys of lookup_map, sorted. lookup_map must not be modified after
+	// the argument is built
+	std::vector<KeyEntry> sorted_keys;
+
+	static bool key_less(const KeyEntry& entry, const StrView& key) {
+		return entry.first < key;
+	}
+
+	void index_keys() {
+		sorted_keys.clear();
+
+		for (const auto& entry : lookup_map)
+			sorted_keys.emplace_back(StrView(entry.first), &entry.second);
+
+		std::sort(begin(sorted_keys), end(sorted_keys),
+			[](const KeyEntry& a, const KeyEntry& b) {
+				return a.first < b.first;
+			});
+	}
 };
 
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_REST_ARG_H
+#define ARGS_REST_ARG_H
+
+#include <utility>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/arg.hpp"
+#include "functors/condition.hpp"
+
+
+namespace args {
+
+// Range of argv positions [first, last), relative to the argv given to parse.
+// The tokens aren't copied: they are argv[first] to argv[last-1]
+struct ArgSpan {
+	uint first = 0;
+	uint last = 0;
+
+	uint size() const {
+		return last - first;
+	}
+
+	bool empty() const {
+		return first == last;
+	}
+};
+
+// where a RestArg starts claiming the tokens
+enum class RestFrom {
+	EndOfFlags,     // after "--"
+	FirstPositional // at the first token that isn't a flag, or after "--"
+};
+
+
+// Claims the whole tail of argv in one step, as a single ArgSpan. It does not
+// take values from sources
+template <typename PreCond, typename PostCond>
+struct RestArg : public Arg<ArgSpan, PreCond, PostCond, RestArg<PreCond, PostCond>> {
+	// the tail may have any number of tokens
+	static constexpr bool bounded_tokens = false;
+
+	RestFrom from;
+
+	RestArg(RestFrom from, PreCond precond, PostCond postcond)
+		: Arg<ArgSpan, PreCond, PostCond, RestArg>(
+				std::move(precond),
+				std::move(postcond))
+		, from(from) {}
+
+	ParseResult<ArgSpan> parse_impl(ParserState& s) const {
+		using R = ParseResult<ArgSpan>;
+
+		if (!s.bounds_check())
+			return R::err(ParseError(BoundError("RestArg::parse()")));
+
+		auto token_class = s.token_class();
+
+		ArgSpan span;
+		span.first = s.pos;
+		span.last = s.argv.size();
+
+		if (!s.end_of_flags && token_class == TokenClass::EndOfFlags) {
+			// "--" hasn't been consumed by a FlagParser
+			span.first++;
+
+		} else if (!s.end_of_flags && (from == RestFrom::EndOfFlags
+				|| token_class != TokenClass::Positional)) {
+
+			return R::err(ParseError(UnknownArg(s)));
+		}
+
+		s.pos = span.last;
+		s.str_off = 0;
+
+		return R::ok(span);
+	}
+
+	virtual Str to_str() const override {
+		return "...";
+	}
+};
+
+
+template <
+	typename PreCond = condition::True,
+	typename PostCond = condition::True
+>
+RestArg<PreCond, PostCond>
+rest_arg(
+		RestFrom from = RestFrom::EndOfFlags,
+		PreCond precond = PreCond(),
+		PostCond postcond = PostCond()) {
+
+	return RestArg<PreCond, PostCond> {
+		from,
+		std::move(precond),
+		std::move(postcond)
+	};
+}
+
+}
+
+#endif
@@ -24,39 +24,90 @@
 #include "common/parser_state.hpp"
 #include "functors/condition.hpp"
 
+#include "utils/instrument.hpp"
+#include "utils/name_table.hpp"
+
 
 namespace args {
 
 template <typename T>
 struct ArgState : public BaseArg {
-	std::vector<T> result;
+	using value_type = T;
+
+	PolyVector<T> result;
+
+	// forgets the results of the previous parse, keeping the storage
+	void reset() {
+		result.clear();
+		multiplicity = 0;
+		origin = Origin::None;
+	}
+
+	// forgets the results of the previous parse, and allocates the next ones
+	// from res. The storage is freed through res, so before res is destroyed
+	// the results must be moved out of it (see move_results_to) or dropped by
+	// calling this with another resource
+	void use_resource(MemoryResource* res) {
+		result = PolyVector<T>(res);
+		multiplicity = 0;
+		origin = Origin::None;
+	}
+
+	// moves the results (and the strings they allocated) to storage from res,
+	// keeping them
+	void move_results_to(MemoryResource* res) {
+		PolyVector<T> moved { PolyAllocator<T>(res) };
+		moved.reserve(result.size());
+
+		for (auto& value : result) {
+			moved.push_back(std::move(value));
+			rebind_value(moved.back(), res);
+		}
+
+		result = std::move(moved);
+	}
 };
 
 template <typename T, typename PreCond, typename PostCond, typename Derived>
 struct Arg : public ArgState<T> {
+	using precond_type = PreCond;
+
+	// number of tokens a value from a source (see parse_with) is split into
+	static constexpr std::size_t value_arity = 1;
+
+	// whether parse_impl consumes a single token when it doesn't start with '-',
+	// and at most 1 + value_arity tokens otherwise
+	static constexpr bool bounded_tokens = true;
+
 	PreCond precond;
 	PostCond postcond;
 	StrView doc_description;
 
+	// name used to look up the argument in sources other than argv,
+	// empty if it can only be given in argv
+	Str source_key;
+
 	Arg(PreCond precond, PostCond postcond)
 		: ArgState<T>()
 		, precond(std::move(precond))
 		, postcond(std::move(postcond)) {}
 
 	ParseResultVoid parse(ParserState& s) {
-		auto res = success();
-
-		derived().parse_impl(s)
+		return store(derived().parse_impl(s));
+	}
 
-		.if_ok([&](T&& parsed) {
-			this->result.emplace_back(std::move(parsed));
-		})
+	// parses a value given by a source, where s only contains the value tokens
+	ParseResultVoid parse_value(ParserState& s) {
+		return store(derived().parse_value_impl(s));
+	}
 
-		.if_err([&](ParseError&& err) {
-			res = err;
-		});
+	ParseResult<T> parse_value_impl(ParserState& s) const {
+		return derived().parse_impl(s);
+	}
 
-		return res;
+	// adds the names that select the argument on the command line (e.g. its
+	// longopt), which the parsers use for abbreviations and completion
+	void collect_names(NameTable&) const {
 	}
 
 	Derived& description(StrView desc) & {
@@ -69,58 +120,258 @@ struct Arg : public ArgState<T> {
 		return std::move(derived());
 	}
 
+	Derived& key(Str key) & {
+		this->source_key = std::move(key);
+		return derived();
+	}
+
+	Derived&& key(Str key) && {
+		this->source_key = std::move(key);
+		return std::move(derived());
+	}
+
 private:
+	ParseResultVoid store(ParseResult<T>&& parsed) {
+		auto res = success();
+
+		std::move(parsed)
+
+		.if_ok([&](T&& value) {
+			this->result.emplace_back(std::move(value));
+		})
+
+		.if_err([&](ParseError&& err) {
+			res = err;
+		});
+
+		return res;
+	}
+
 	Derived& derived() & {
 		return *static_cast<Derived*>(this);
 	}
 
+	const Derived& derived() const& {
+		return *static_cast<const Derived*>(this);
+	}
+
 	Derived&& derived() && {
 		return std::move(*static_cast<Derived*>(this));
 	}
 };
 
 
+// Stores parse results in the arguments themselves
+struct ArgSink {
+	template <std::size_t I, typename A, typename T>
+	void push(A& arg, T&& value) {
+		ARGS_COUNT_IF(arg.result.size() == arg.result.capacity(), result_allocations);
+
+		arg.result.emplace_back(std::forward<T>(value));
+		arg.multiplicity++;
+		arg.origin = Origin::Argv;
+	}
+};
+
+
+// Whether argv can be split into chunks that are parsed independently by a
+// set of arguments, and how many tokens after the first one an argument may
+// consume (see Schema::parse)
+template <typename... ArgTs>
+struct ChunkTraits {
+	static constexpr bool chunkable = true;
+	static constexpr std::size_t max_arity = 0;
+};
+
+template <typename A, typename... ArgTs>
+struct ChunkTraits<A, ArgTs...> {
+	using Rest = ChunkTraits<ArgTs...>;
+
+	static constexpr bool chunkable = A::bounded_tokens
+		&& condition::is_stateless<typename A::precond_type>::value
+		&& Rest::chunkable;
+
+	static constexpr std::size_t max_arity =
+		A::value_arity > Rest::max_arity ? A::value_arity : Rest::max_arity;
+};
+
+
 template <typename... ArgTs>
 struct ArgParser {
 	static constexpr std::size_t N = sizeof...(ArgTs);
 
+	using Chunking = ChunkTraits<ArgTs...>;
+
+	// one Slot<T> per argument, where T is its value_type
+	template <template <typename> class Slot>
+	using Slots = std::tuple<Slot<typename ArgTs::value_type>...>;
+
+	template <typename T>
+	using Vector = std::vector<T>;
+
+	// makes every argument allocate its results from res
+	struct ResourceSetter {
+		MemoryResource* res;
+
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.use_resource(res);
+		}
+	};
+
+	// moves the results of every argument to res
+	struct ResultMover {
+		MemoryResource* res;
+
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.move_results_to(res);
+		}
+	};
+
+	// adds the names of every argument to a NameTable
+	struct NameCollector {
+		NameTable& names;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			arg.collect_names(names);
+		}
+	};
+
+	// results of every argument when they are stored out of the arguments
+	using Values = Slots<Vector>;
+
+	// Stores parse results in Values, and multiplicities in counts, which is
+	// indexed by BaseArg::id
+	struct ValueSink {
+		Values& values;
+		uint* counts;
+
+		template <std::size_t I, typename A, typename T>
+		void push(const A& arg, T&& value) {
+			auto& vec = std::get<I>(values);
+
+			ARGS_COUNT_IF(vec.size() == vec.capacity(), result_allocations);
+
+			vec.emplace_back(std::forward<T>(value));
+			counts[arg.id]++;
+		}
+	};
+
 private:
 
+	template <std::size_t I>
+	using ArgType = typename std::tuple_element<I, std::tuple<ArgTs...>>::type;
+
 	std::tuple<ArgTs&...> args;
+	NameTable name_table;
 
 
-	template <std::size_t I>
-	If<I == N> parse_iter(OwnedParserState& state) {
+	template <std::size_t I, typename Sink>
+	If<I == N> parse_iter(OwnedParserState& state, Sink&) const {
 		return ParseError(UnknownArg(state));
 	}
 
-	template <std::size_t I>
-	If<I < N> parse_iter(OwnedParserState& state) {
-		auto state_clone = ParserState(state);
+	template <std::size_t I, typename Sink>
+	If<I < N> parse_iter(OwnedParserState& state, Sink& sink) const {
+		bool skipped = false;
+		auto res = parse_arg<I>(state, sink, skipped);
 
+		return skipped ? parse_iter<I+1>(state, sink) : res;
+	}
+
+	// tries the argument I. skipped is set if the next ones should be tried
+	template <std::size_t I, typename Sink>
+	ParseResultVoid parse_arg(OwnedParserState& state, Sink& sink, bool& skipped) const {
 		auto& arg = std::get<I>(args);
 
+		ARGS_TIME_ARG(arg.id);
+		ARGS_COUNT(state_clones);
+
+		auto state_clone = ParserState(state);
+
+		ARGS_COUNT(precond_evals);
+
 		const auto& c_arg = arg;
 		auto res = arg.precond(c_arg, state_clone);
 
-		if (!res.is_ok())
-		  return is<CondFailed>(res) ? parse_iter<I+1>(state) : res;
+		if (!res.is_ok()) {
+			skipped = is<CondFailed>(res);
+			return res;
+		}
 
-		res = arg.parse(state_clone);
+		ARGS_COUNT(match_attempts);
 
-		if (res.is_ok()) {
-			arg.multiplicity++;
-			state.owned_matched_args.push_back(&arg);
+		auto parsed = arg.parse_impl(state_clone);
+
+		if (parsed.is_ok()) {
+			ARGS_COUNT_ARG_MATCH(arg.id);
+
+			sink.template push<I>(arg, std::move(parsed.get_ok()));
+			state.owned_matched_args.add(arg, state.pos);
 			state.update(state_clone);
-			return res;
+			return success();
+		}
 
-		} else if (is<UnknownArg>(res)) {
-			return parse_iter<I+1>(state);
+		res = std::move(parsed.get_err());
 
+		if (is<UnknownArg>(res)) {
+			skipped = true;
 		} else {
 			res.set_arg(&arg);
-			return res;
 		}
+
+		return res;
+	}
+
+
+	template <std::size_t I>
+	If<I == N, void> reset_iter() {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> reset_iter() {
+		std::get<I>(args).reset();
+		reset_iter<I+1>();
+	}
+
+
+	template <std::size_t I, typename F>
+	If<I == N, void> for_each_arg_iter(F&) const {
+	}
+
+	template <std::size_t I, typename F>
+	If<I < N, void> for_each_arg_iter(F& f) const {
+		f(std::get<I>(args));
+		for_each_arg_iter<I+1>(f);
+	}
+
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	If<I == N, const Slot<typename A::value_type>*>
+	find_slot_iter(const A&, const Slots<Slot>&) const {
+		return nullptr;
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	If<I < N, const Slot<typename A::value_type>*>
+	find_slot_iter(const A& arg, const Slots<Slot>& slots) const {
+		auto found = find_slot_at<Slot, I>(arg, slots, std::is_same<ArgType<I>, A>());
+
+		return found ? found : find_slot_iter<Slot, I+1>(arg, slots);
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	const Slot<typename A::value_type>*
+	find_slot_at(const A& arg, const Slots<Slot>& slots, std::true_type) const {
+		return &std::get<I>(args) == &arg ? &std::get<I>(slots) : nullptr;
+	}
+
+	template <template <typename> class Slot, std::size_t I, typename A>
+	const Slot<typename A::value_type>*
+	find_slot_at(const A&, const Slots<Slot>&, std::false_type) const {
+		return nullptr;
 	}
 
 
@@ -131,6 +382,8 @@ private:
 
 	template <std::size_t I>
 	If<I < N> eval_postcond_iter(const ParserState& s) const {
+		ARGS_COUNT(postcond_evals);
+
 		const auto& arg = std::get<I>(args);
 		auto res = arg.postcond(arg, s);
 
@@ -147,15 +400,72 @@ public:
 
 
 	ArgParser(ArgTs&... args)
-		: args(std::tie(args...)) {}
+		: args(std::tie(args...)) {
 
-	ParseResultVoid parse(OwnedParserState& state) {
-		return parse_iter<0>(state);
+		NameCollector collector { name_table };
+		for_each_arg(collector);
+		name_table.sort();
+	}
+
+	ArgParser(const ArgParser& other)
+		: args(other.args)
+		, name_table(other.name_table) {}
+
+
+	ParseResultVoid parse(OwnedParserState& state) const {
+		ArgSink sink;
+		return parse(state, sink);
+	}
+
+	template <typename Sink>
+	ParseResultVoid parse(OwnedParserState& state, Sink& sink) const {
+		ARGS_TIME_PHASE(Match);
+		return parse_iter<0>(state, sink);
+	}
+
+	// the names of the arguments, sorted
+	const NameTable& names() const {
+		return name_table;
 	}
 
 	ParseResultVoid eval_postcond(const ParserState& state) const {
+		ARGS_TIME_PHASE(Postcond);
 		return eval_postcond_iter<0>(state);
 	}
+
+	void reset() {
+		reset_iter<0>();
+	}
+
+	// see ArgState::use_resource
+	void use_resource(MemoryResource* res) {
+		ResourceSetter setter { res };
+		for_each_arg(setter);
+	}
+
+	// see ArgState::move_results_to
+	void move_results_to(MemoryResource* res) {
+		ResultMover mover { res };
+		for_each_arg(mover);
+	}
+
+	// calls f(arg) for every argument, in declaration order
+	template <typename F>
+	void for_each_arg(F& f) const {
+		for_each_arg_iter<0>(f);
+	}
+
+	// the slot of arg, null if arg is not managed by this parser
+	template <template <typename> class Slot, typename A>
+	const Slot<typename A::value_type>* find_slot(const A& arg, const Slots<Slot>& slots) const {
+		return find_slot_iter<Slot, 0>(arg, slots);
+	}
+
+	// results of arg in values, null if arg is not managed by this parser
+	template <typename A>
+	const std::vector<typename A::value_type>* find_values(const A& arg, const Values& values) const {
+		return find_slot<Vector>(arg, values);
+	}
 };
 
 
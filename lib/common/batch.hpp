@@ -0,0 +1,275 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_BATCH_H
+#define ARGS_BATCH_H
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/schema.hpp"
+
+#include "utils/thread_pool.hpp"
+#include "utils/tokenizer.hpp"
+
+
+namespace args {
+
+// Values of one argument for every line of a batch. The values of line i are
+// values[offsets[i]] to values[offsets[i+1]-1], lines that failed have none.
+template <typename T>
+struct Column {
+	std::vector<T> values;
+	std::vector<std::size_t> offsets;
+
+	std::size_t count(std::size_t line) const {
+		return offsets[line+1] - offsets[line];
+	}
+};
+
+// Part of a Column built by one task, with the number of values per line
+template <typename T>
+struct ColumnChunk {
+	std::vector<T> values;
+	std::vector<uint> counts;
+};
+
+
+template <typename... ArgParsers>
+class BatchResults {
+	template <typename... Ps>
+	friend BatchResults<Ps...> parse_batch(const Schema<Ps...>&,
+			const std::vector<StrView>&, ThreadPool&, std::size_t);
+
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	using Columns = std::tuple<typename ArgParsers::template Slots<Column>...>;
+
+	const std::tuple<ArgParsers...>* arg_parsers = nullptr;
+	Columns columns;
+
+
+	template <typename A>
+	using ColumnPtr = const Column<typename A::value_type>*;
+
+	template <std::size_t P, typename A>
+	If<P == N, ColumnPtr<A>> find_column_iter(const A&) const {
+		return nullptr;
+	}
+
+	template <std::size_t P, typename A>
+	If<P < N, ColumnPtr<A>> find_column_iter(const A& arg) const {
+		auto found = std::get<P>(*arg_parsers).template find_slot<Column>(
+				arg, std::get<P>(columns));
+
+		return found ? found : find_column_iter<P+1>(arg);
+	}
+
+public:
+	// ParseError type index of every line, 0 (Nothing) on success
+	std::vector<unsigned char> status;
+
+	// errors of the lines that failed, ordered by line
+	std::vector<std::pair<std::size_t, ParseError>> errors;
+
+
+	std::size_t size() const {
+		return status.size();
+	}
+
+	bool is_ok(std::size_t line) const {
+		return status[line] == 0;
+	}
+
+	// values of arg for all lines. arg must be part of the schema
+	template <typename A>
+	const Column<typename A::value_type>& operator[] (const A& arg) const {
+		static const Column<typename A::value_type> none;
+
+		auto found = arg_parsers ? find_column_iter<0>(arg) : nullptr;
+
+		return found ? *found : none;
+	}
+};
+
+
+template <typename... ArgParsers>
+struct BatchChunk {
+	using ChunkColumns = std::tuple<typename ArgParsers::template Slots<ColumnChunk>...>;
+
+	ChunkColumns columns;
+	std::vector<std::size_t> bases;
+	std::vector<std::pair<std::size_t, ParseError>> errors;
+};
+
+template <typename... ArgParsers>
+struct BatchWorker {
+	Results<ArgParsers...> results;
+	OwnedParserState state;
+	std::vector<StrView> tokens;
+};
+
+
+// appends the results of a line to the columns of its chunk
+struct BatchAppendLine {
+	bool ok;
+
+	template <typename T>
+	void operator() (const std::vector<T>& values, ColumnChunk<T>& column) {
+		if (ok) {
+			column.values.insert(end(column.values), begin(values), end(values));
+			column.counts.push_back(values.size());
+		} else {
+			column.counts.push_back(0);
+		}
+	}
+};
+
+// computes where the values of every chunk go in the final columns
+struct BatchSizeColumns {
+	std::vector<std::size_t>& bases;
+
+	template <typename T>
+	void operator() (const ColumnChunk<T>& chunk, Column<T>& column) {
+		bases.push_back(column.values.size());
+		column.values.resize(column.values.size() + chunk.values.size());
+	}
+};
+
+// moves the values of a chunk to the final columns
+struct BatchMoveChunk {
+	const std::vector<std::size_t>& bases;
+	std::size_t first_line;
+	std::size_t arg;
+
+	BatchMoveChunk(const std::vector<std::size_t>& bases, std::size_t first_line)
+		: bases(bases)
+		, first_line(first_line)
+		, arg(0) {}
+
+	template <typename T>
+	void operator() (ColumnChunk<T>& chunk, Column<T>& column) {
+		std::size_t base = bases[arg++];
+
+		std::move(begin(chunk.values), end(chunk.values), begin(column.values) + base);
+
+		for (std::size_t i = 0; i < chunk.counts.size(); i++) {
+			column.offsets[first_line + i] = base;
+			base += chunk.counts[i];
+		}
+
+		chunk.values = std::vector<T>();
+	}
+};
+
+struct BatchFinishColumns {
+	std::size_t lines;
+
+	template <typename T>
+	void operator() (const ColumnChunk<T>&, Column<T>& column) {
+		column.offsets.resize(lines + 1);
+		column.offsets[lines] = column.values.size();
+	}
+};
+
+
+// Parses every line (split into words) against the schema using all the
+// threads of the pool, chunk_lines lines per task. The results are stored by
+// argument (see Column) in the order of the lines.
+template <typename... ArgParsers>
+BatchResults<ArgParsers...> parse_batch(const Schema<ArgParsers...>& schema,
+		const std::vector<StrView>& lines, ThreadPool& pool,
+		std::size_t chunk_lines = 1024) {
+
+	using Chunk = BatchChunk<ArgParsers...>;
+	using Worker = BatchWorker<ArgParsers...>;
+
+	BatchResults<ArgParsers...> out;
+	out.arg_parsers = &schema.parsers();
+	out.status.resize(lines.size());
+
+	std::size_t chunk_count = (lines.size() + chunk_lines - 1) / chunk_lines;
+
+	std::vector<Chunk> chunks(chunk_count);
+	std::vector<Worker> workers(pool.size());
+
+	pool.run(chunk_count, [&](std::size_t w, std::size_t c) {
+		auto& worker = workers[w];
+		auto& chunk = chunks[c];
+
+		std::size_t first = c * chunk_lines;
+		std::size_t last = std::min(lines.size(), first + chunk_lines);
+
+		for (std::size_t i = first; i < last; i++) {
+			worker.tokens.clear();
+			split_words(lines[i], worker.tokens);
+
+			const auto& res = schema.parse(
+				begin(worker.tokens), end(worker.tokens),
+				worker.results, worker.state);
+
+			out.status[i] = static_cast<unsigned char>(res.data.which());
+
+			if (!res.is_ok())
+				chunk.errors.emplace_back(i, res);
+
+			BatchAppendLine append { res.is_ok() };
+			zip_nested(append, worker.results.all_values(), chunk.columns);
+		}
+	});
+
+	for (auto& chunk : chunks) {
+		BatchSizeColumns size_columns { chunk.bases };
+		zip_nested(size_columns, chunk.columns, out.columns);
+
+		out.errors.insert(end(out.errors),
+				begin(chunk.errors), end(chunk.errors));
+	}
+
+	if (chunk_count > 0) {
+		BatchFinishColumns finish { lines.size() };
+		zip_nested(finish, chunks[0].columns, out.columns);
+	}
+
+	pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+		BatchMoveChunk move_chunk { chunks[c].bases, c * chunk_lines };
+		zip_nested(move_chunk, chunks[c].columns, out.columns);
+	});
+
+	return out;
+}
+
+// same as above with the lines of text (e.g. a MappedFile)
+template <typename... ArgParsers>
+BatchResults<ArgParsers...> parse_batch(const Schema<ArgParsers...>& schema,
+		StrView text, ThreadPool& pool, std::size_t chunk_lines = 1024) {
+
+	std::vector<StrView> lines;
+	split_lines(text, lines);
+
+	return parse_batch(schema, lines, pool, chunk_lines);
+}
+
+}
+
+#endif
@@ -0,0 +1,367 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_GRAMMAR_H
+#define ARGS_GRAMMAR_H
+
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/arg.hpp"
+#include "common/parser.hpp"
+
+
+namespace args {
+
+// Positional arguments that are matched in declaration order, each any number
+// of times its conditions allow, where the parse may go back on a choice. With
+// a plain parse (args::parse(argv_begin, argv_end, ..., grammar)) it is a
+// greedy ArgParser, so "SRC... DST" can't be parsed: SRC takes every token.
+// Parsed with args::parse(grammar, ...) the positional tokens are split
+// between the arguments by a depth-first search, which goes on to the next
+// argument when taking one more token fails later on. Failed states (token,
+// argument, matches of the argument) are remembered, so every state is
+// explored at most once. The matches are part of the state since conditions
+// look at them, so there can be up to tokens * arguments * matches states:
+// linear in the tokens when a single argument repeats (SRC... DST), but
+// quadratic when two do (A... B... C), which lookahead_limit bounds.
+//
+// An argument's postcondition is checked when the search moves past it, so it
+// can only rely on the matches of the arguments before it (and on the other
+// parsers, see parse). Preconditions and postconditions that only look at the
+// argument's own multiplicity (min, max, between, exactly) always work.
+template <typename... ArgTs>
+class Grammar : public ArgParser<ArgTs...> {
+	static constexpr std::size_t N = sizeof...(ArgTs);
+
+	// states explored before giving up
+	std::size_t step_limit = 1 << 20;
+
+
+	// a state of the search: the argument k may match the token pos, and has
+	// been matched m times
+	struct Frame {
+		uint pos;
+		uint k;
+		uint m;
+
+		// 0: nothing tried, 1: matched arg k, 2: moved to arg k+1, 3: failed
+		unsigned char choice;
+		bool pushed;
+		std::size_t match_count;
+	};
+
+	// the state of f within its argument (see failed_at), pos and m are
+	// both 32 bits wide so it's exact
+	static std::uint64_t key(const Frame& f) {
+		return (std::uint64_t(f.pos) << 32) | f.m;
+	}
+
+
+	// matches arg at clone.pos, storing the value like ArgSink
+	struct Match {
+		ParserState& clone;
+		OwnedParserState& state;
+		ParseResultVoid res;
+
+		template <typename A>
+		void operator() (A& arg) {
+			const auto& c_arg = arg;
+			res = arg.precond(c_arg, clone);
+
+			if (!res.is_ok())
+				return;
+
+			auto parsed = arg.parse_impl(clone);
+
+			if (!parsed.is_ok()) {
+				res = std::move(parsed.get_err());
+				res.set_arg(&arg);
+				return;
+			}
+
+			arg.result.emplace_back(std::move(parsed.get_ok()));
+			arg.multiplicity++;
+			arg.origin = Origin::Argv;
+			state.owned_matched_args.add(arg, state.pos);
+		}
+	};
+
+	struct Unmatch {
+		template <typename A>
+		void operator() (A& arg) const {
+			arg.result.pop_back();
+
+			if (--arg.multiplicity == 0)
+				arg.origin = Origin::None;
+		}
+	};
+
+	struct Postcond {
+		const ParserState& state;
+		ParseResultVoid res;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			res = arg.postcond(arg, state);
+
+			if (!res.is_ok())
+				res.set_arg(&arg);
+		}
+	};
+
+	struct Multiplicity {
+		uint m;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			m = arg.multiplicity;
+		}
+	};
+
+
+	template <std::size_t I, typename F>
+	If<I == N, void> apply_iter(std::size_t, F&) const {
+	}
+
+	template <std::size_t I, typename F>
+	If<I < N, void> apply_iter(std::size_t k, F& f) const {
+		if (k == I)
+			f(std::get<I>(this->const_args));
+		else
+			apply_iter<I+1>(k, f);
+	}
+
+	// calls f(arg) for the argument k
+	template <typename F>
+	void apply(std::size_t k, F& f) const {
+		apply_iter<0>(k, f);
+	}
+
+	uint multiplicity(std::size_t k) const {
+		Multiplicity get { 0 };
+
+		if (k < N)
+			apply(k, get);
+
+		return get.m;
+	}
+
+	// postconditions of the arguments from k on, when no token is left
+	ParseResultVoid accept(const ParserState& state, std::size_t k) const {
+		for (; k < N; k++) {
+			Postcond check { state, success() };
+			apply(k, check);
+
+			if (!check.res.is_ok())
+				return check.res;
+		}
+
+		return success();
+	}
+
+public:
+	using ArgParser<ArgTs...>::ArgParser;
+
+
+	// number of states the search may explore before it fails
+	Grammar& lookahead_limit(std::size_t steps) & {
+		step_limit = steps;
+		return *this;
+	}
+
+	Grammar&& lookahead_limit(std::size_t steps) && {
+		step_limit = steps;
+		return std::move(*this);
+	}
+
+
+	// matches every remaining token of state, which must all be positional.
+	// On failure, the error is the one found at the furthest token
+	ParseResultVoid parse_all(OwnedParserState& state) const {
+		const uint end = state.argv.size();
+
+		std::vector<Frame> stack;
+
+		// the failed states of every argument k (up to N), see key
+		std::vector<std::unordered_set<std::uint64_t>> failed_at(N + 1);
+		std::size_t steps = 0;
+
+		ParseResultVoid error = success();
+		uint error_pos = 0;
+
+		auto fail_at = [&](uint pos, ParseResultVoid res) {
+			if (error.is_ok() || pos > error_pos) {
+				error = std::move(res);
+				error_pos = pos;
+			}
+		};
+
+		stack.push_back(Frame { state.pos, 0, multiplicity(0), 0, false, state.matched_args.size() });
+
+		while (!stack.empty()) {
+			std::size_t top = stack.size() - 1;
+			Frame f = stack[top];
+
+			if (f.choice == 0) {
+				stack[top].choice = 1;
+
+				if (f.pos == end) {
+					state.pos = end;
+					auto res = accept(state, f.k);
+
+					if (res.is_ok())
+						return res;
+
+					fail_at(f.pos, std::move(res));
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (failed_at[f.k].count(key(f))) {
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (f.k == N) {
+					state.pos = f.pos;
+					fail_at(f.pos, ParseError(UnknownArg(state)));
+					stack[top].choice = 3;
+					continue;
+				}
+
+				if (++steps > step_limit) {
+					state.pos = f.pos;
+					return ParseError(InvalidParam("too ambiguous to parse", state.arg()));
+				}
+
+				state.pos = f.pos;
+				state.str_off = 0;
+
+				auto clone = ParserState(state);
+				Match match { clone, state, success() };
+				apply(f.k, match);
+
+				if (match.res.is_ok()) {
+					stack[top].pushed = true;
+
+					if (clone.pos > f.pos && clone.str_off == 0) {
+						stack.push_back(Frame { clone.pos, f.k, f.m + 1, 0, false, state.matched_args.size() });
+						continue;
+					}
+				} else if (!is<CondFailed>(match.res)) {
+					// a failed precondition only means that the next argument must match
+					fail_at(f.pos, std::move(match.res));
+				}
+			}
+
+			if (f.choice <= 1) {
+				stack[top].choice = 2;
+
+				if (stack[top].pushed) {
+					Unmatch unmatch;
+					apply(f.k, unmatch);
+					state.owned_matched_args.truncate(f.match_count);
+					stack[top].pushed = false;
+				}
+
+				Postcond check { state, success() };
+				apply(f.k, check);
+
+				if (check.res.is_ok()) {
+					stack.push_back(Frame { f.pos, f.k + 1, multiplicity(f.k + 1), 0, false, f.match_count });
+					continue;
+				}
+
+				fail_at(f.pos, std::move(check.res));
+			}
+
+			if (f.pos != end)
+				failed_at[f.k].insert(key(f));
+
+			stack.pop_back();
+		}
+
+		return error;
+	}
+};
+
+
+template <typename... ArgTs>
+Grammar<ArgTs...> grammar(ArgTs&... args) {
+	return Grammar<ArgTs...>(args...);
+}
+
+
+// like parse, but the positional tokens that the parsers don't take (every
+// token after "--", "-" and the ones that don't start with '-') are left to
+// grammar, which matches them after the other tokens with backtracking (see
+// Grammar). Positions in the values of its arguments (e.g. ArgSpan) are
+// relative to these tokens.
+template <typename... ArgTs, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(const Grammar<ArgTs...>& grammar,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
+	OwnedParserState state(argv_begin, argv_end);
+	std::vector<StrView> positionals;
+
+	while (state.pos < state.argv.size()) {
+		auto res = parse_iter(state, arg_parsers...);
+
+		auto token_class = state.str_off == 0
+			? state.token_class()
+			: TokenClass::ShortoptCluster;
+
+		bool positional = state.end_of_flags
+			|| token_class == TokenClass::Positional
+			|| token_class == TokenClass::Dash;
+
+		if (is<UnknownArg>(res) && positional) {
+			positionals.push_back(state.arg_next());
+			continue;
+		}
+
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers..., grammar);
+
+		if (!res.is_ok())
+			return res;
+	}
+
+	OwnedParserState rest(positionals.begin(), positionals.end());
+	rest.end_of_flags = true;
+	rest.owned_matched_args.append(state.matched_args);
+
+	auto res = grammar.parse_all(rest);
+
+	return res.is_ok()? eval_postcond_iter(rest, arg_parsers..., grammar) : res;
+}
+
+}
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_INCREMENTAL_H
+#define ARGS_INCREMENTAL_H
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/parser.hpp"
+
+#include "args/rest_arg.hpp"
+#include "args/flag/path_params.hpp"
+
+
+namespace args {
+
+// Whether results of type T may be views into the tokens they were parsed
+// from (StrView, Lazy, and any type not known to own its data)
+template <typename T, typename Enable = void>
+struct HoldsTokenViews : std::true_type {};
+
+template <typename T>
+struct HoldsTokenViews<T, typename std::enable_if<
+		std::is_arithmetic<T>::value || std::is_enum<T>::value
+	>::type> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<Str> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<PolyString> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<ArgSpan> : std::false_type {};
+
+template <PathKind K>
+struct HoldsTokenViews<CheckedPath<K>> : std::false_type {};
+
+template <>
+struct HoldsTokenViews<std::tuple<>> : std::false_type {};
+
+template <typename T, typename... Ts>
+struct HoldsTokenViews<std::tuple<T, Ts...>> : std::integral_constant<bool,
+	HoldsTokenViews<T>::value || HoldsTokenViews<std::tuple<Ts...>>::value> {};
+
+
+// Parses a command line that is edited over time (e.g. validated as the user
+// types it). The state is checkpointed at every token boundary the parse
+// reaches, and after an edit the parse resumes from the last checkpoint before
+// the first changed token, so only the changed suffix is parsed again.
+// Every update splits its command into a chunk of its own, which is kept while
+// results that may view it (see HoldsTokenViews) are. Arguments must store
+// their results in themselves (no Schema), and parsers must not look at tokens
+// past the ones they consume.
+template <typename... ArgParsers>
+class IncrementalSession {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	struct Checkpoint {
+		uint pos;
+		bool end_of_flags;
+		std::size_t match_count;
+		std::size_t views;  // results that may view their chunk
+		std::size_t chunks; // chunks those results view
+	};
+
+	// the command of an update and its unescaped words
+	struct Chunk {
+		std::string line;
+		std::string buffer;
+	};
+
+	// multiplicity and result count of every argument at a checkpoint
+	struct Marks {
+		std::vector<uint>& marks;
+		std::size_t views;
+
+		template <typename A>
+		void operator() (const A& arg) {
+			marks.push_back(arg.multiplicity);
+			marks.push_back(arg.result.size());
+
+			if (HoldsTokenViews<typename A::value_type>::value)
+				views += arg.result.size();
+		}
+	};
+
+	struct Rewind {
+		const uint* marks;
+
+		template <typename A>
+		void operator() (A& arg) {
+			arg.multiplicity = marks[0];
+			arg.result.erase(begin(arg.result) + marks[1], end(arg.result));
+
+			if (arg.multiplicity == 0)
+				arg.origin = Origin::None;
+
+			marks += 2;
+		}
+	};
+
+	std::tuple<ArgParsers&...> arg_parsers;
+	OwnedParserState state;
+
+	// a deque, so that the strings of a chunk never move
+	std::deque<Chunk> chunks;
+	std::vector<std::size_t> word_ends;
+
+	std::vector<Checkpoint> checkpoints;
+	std::vector<uint> marks;
+	std::size_t marks_per_checkpoint = 0;
+
+	bool started = false;
+	std::size_t reparsed = 0;
+
+
+	template <std::size_t... Is>
+	void checkpoint(Indices<Is...>) {
+		Marks add { marks, 0 };
+
+		int expand[] = { 0, (std::get<Is>(arg_parsers).for_each_arg(add), 0)... };
+		(void) expand;
+
+		// the results parsed since the last checkpoint only need the current
+		// chunk if some of them may view it
+		std::size_t needed = chunks.size();
+
+		if (!checkpoints.empty() && checkpoints.back().views == add.views)
+			needed = checkpoints.back().chunks;
+
+		checkpoints.push_back(Checkpoint {
+			state.pos,
+			state.end_of_flags,
+			state.matched_args.size(),
+			add.views,
+			needed
+		});
+	}
+
+	template <std::size_t... Is>
+	void rewind(std::size_t c, Indices<Is...>) {
+		const Checkpoint& cp = checkpoints[c];
+
+		Rewind apply { &marks[c * marks_per_checkpoint] };
+
+		int expand[] = { 0, (std::get<Is>(arg_parsers).for_each_arg(apply), 0)... };
+		(void) expand;
+
+		state.rewind(cp.pos, cp.end_of_flags, cp.match_count);
+
+		checkpoints.resize(c + 1);
+		marks.resize((c + 1) * marks_per_checkpoint);
+	}
+
+	template <std::size_t... Is>
+	void start(Indices<Is...>) {
+		args::reset(std::get<Is>(arg_parsers)...);
+		ARGS_NUMBER_ARGS(std::get<Is>(arg_parsers)...);
+
+		checkpoint(Indices<Is...>());
+		marks_per_checkpoint = marks.size();
+		started = true;
+	}
+
+	template <std::size_t... Is>
+	ParseResultVoid parse_suffix(Indices<Is...> indices) {
+		uint from = state.pos;
+
+		while (state.pos < state.argv.size()) {
+			auto res = parse_iter(state, std::get<Is>(arg_parsers)...);
+
+			if (is<UnknownArg>(res))
+				args::suggest(res.template get<UnknownArg>(), std::get<Is>(arg_parsers)...);
+
+			if (!res.is_ok()) {
+				reparsed = state.pos - from;
+				return res;
+			}
+
+			if (state.str_off == 0)
+				checkpoint(indices);
+		}
+
+		reparsed = state.pos - from;
+
+		return eval_postcond_iter(state, std::get<Is>(arg_parsers)...);
+	}
+
+	// the first token that may differ between the last line and command
+	std::size_t first_changed_token(StrView command) const {
+		StrView line = chunks.empty() ? StrView() : StrView(chunks.back().line);
+
+		std::size_t n = std::min(line.size(), command.size());
+		std::size_t prefix = 0;
+
+		while (prefix < n && line[prefix] == command[prefix])
+			prefix++;
+
+		// a token that ends where the lines start to differ may be extended
+		return std::lower_bound(begin(word_ends), end(word_ends), prefix) - begin(word_ends);
+	}
+
+public:
+	explicit IncrementalSession(ArgParsers&... arg_parsers)
+		: arg_parsers(arg_parsers...) {}
+
+	IncrementalSession(IncrementalSession&&) = default;
+
+
+	// parses command (split like a shell would, see split_shell) from the
+	// last checkpoint that the edit from the previous command didn't affect.
+	// Views into the command in the results stay valid as long as the results
+	// are kept, i.e. until an update changes their tokens or reset()
+	ParseResultVoid update(StrView command) {
+		ARGS_TIME_PARSE();
+
+		if (!started)
+			start(BuildIndices<N>());
+
+		std::size_t changed = first_changed_token(command);
+
+		// the last checkpoint at or before the first changed token
+		std::size_t c = checkpoints.size() - 1;
+
+		while (checkpoints[c].pos > changed)
+			c--;
+
+		rewind(c, BuildIndices<N>());
+
+		// the earlier chunks stay where the kept results view them
+		chunks.resize(checkpoints[c].chunks);
+		chunks.emplace_back();
+
+		Chunk& chunk = chunks.back();
+		chunk.line.assign(command.c_str(), command.size());
+
+		if (!state.replace_command(chunk.line, chunk.buffer, &word_ends)) {
+			rewind(0, BuildIndices<N>());
+			reparsed = 0;
+			return ParseError(InvalidParam("unterminated quote or escape", chunk.line));
+		}
+
+		return parse_suffix(BuildIndices<N>());
+	}
+
+	// forgets every checkpoint and result, the next update parses from scratch
+	void reset() {
+		started = false;
+		chunks.clear();
+		word_ends.clear();
+		checkpoints.clear();
+		marks.clear();
+		state.rewind(0, false, 0);
+	}
+
+	// tokens parsed by the last update
+	std::size_t tokens_reparsed() const {
+		return reparsed;
+	}
+
+	const ParserState& last_state() const {
+		return state;
+	}
+};
+
+
+template <typename... ArgParsers>
+IncrementalSession<ArgParsers...> incremental_session(ArgParsers&... arg_parsers) {
+	return IncrementalSession<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
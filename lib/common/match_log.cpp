@@ -0,0 +1,124 @@
+#include "common/match_log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace args {
+
+
+constexpr uint MatchLog::no_pos;
+constexpr MatchLog::id_type MatchLog::no_id;
+
+
+MatchLog::id_type MatchLog::find(const BaseArg& arg) const {
+	// few distinct arguments are matched, a linear search beats hashing
+	for (std::size_t id = 0; id < ids.size(); id++) {
+		if (ids[id] == &arg)
+			return static_cast<id_type>(id);
+	}
+
+	return no_id;
+}
+
+MatchLog::id_type MatchLog::intern(const BaseArg& arg) {
+	id_type id = find(arg);
+
+	if (id == no_id) {
+		// the next id would be no_id, and the argument would then look
+		// unmatched to contains and first_before
+		if (ids.size() == no_id) {
+			std::cerr << "args::MatchLog: more than " << no_id
+				<< " distinct arguments matched in one parse\n";
+			std::abort();
+		}
+
+		id = static_cast<id_type>(ids.size());
+		ids.push_back(&arg);
+	}
+
+	return id;
+}
+
+void MatchLog::add_run(id_type id, uint count) {
+	const uint max_count = std::numeric_limits<std::uint16_t>::max();
+
+	if (!runs.empty() && runs.back().id == id) {
+		uint room = max_count - runs.back().count;
+		uint added = count < room ? count : room;
+
+		runs.back().count += added;
+		count -= added;
+	}
+
+	while (count > 0) {
+		uint added = count < max_count ? count : max_count;
+
+		Run run;
+		run.id = id;
+		run.count = static_cast<std::uint16_t>(added);
+		runs.push_back(run);
+
+		count -= added;
+	}
+}
+
+void MatchLog::append(const MatchLog& other, uint pos_offset) {
+	if (runs_kept && other.runs_kept) {
+		for (const Run& run : other.runs)
+			add_run(intern(*other.ids[run.id]), run.count);
+	} else {
+		for (const BaseArg* arg : other.ids)
+			intern(*arg);
+	}
+
+	if (positions_kept) {
+		for (std::size_t i = 0; i < other.match_count; i++) {
+			uint pos = other.position(i);
+			positions.push_back(pos == no_pos ? no_pos : pos + pos_offset);
+		}
+	}
+
+	match_count += other.match_count;
+}
+
+void MatchLog::truncate(std::size_t count) {
+	if (count >= match_count)
+		return;
+
+	std::size_t removed = match_count - count;
+
+	while (removed > 0) {
+		Run& last = runs.back();
+
+		if (last.count > removed) {
+			last.count -= removed;
+			break;
+		}
+
+		removed -= last.count;
+		runs.pop_back();
+	}
+
+	// ids follow the first matches, so the remaining ones are a prefix
+	std::size_t id_count = 0;
+
+	for (const Run& run : runs)
+		id_count = std::max<std::size_t>(id_count, run.id + 1);
+
+	ids.resize(id_count);
+
+	if (positions.size() > count)
+		positions.resize(count);
+
+	match_count = count;
+}
+
+void MatchLog::clear() {
+	ids.clear();
+	runs.clear();
+	positions.clear();
+	match_count = 0;
+}
+
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_MATCH_LOG_H
+#define ARGS_MATCH_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+#include "utils/memory_resource.hpp"
+
+
+namespace args {
+
+struct BaseArg;
+
+// The arguments matched during a parse, in order. Every distinct argument gets
+// a 16-bit id when it's first matched (so ids are ordered by first match, and
+// at most 65535 distinct arguments can be logged: matching one more aborts),
+// and consecutive matches of the same argument ("-v -v -v", runs of
+// positionals) are stored as a single run. The argv position of every match is only kept
+// when asked for (see keep_positions), and the runs can be dropped when only
+// the first matches are needed (see keep_runs).
+class MatchLog {
+public:
+	using id_type = std::uint16_t;
+
+	static constexpr uint no_pos = std::numeric_limits<uint>::max();
+
+	struct Run {
+		id_type id;
+		std::uint16_t count;
+	};
+
+	class const_iterator {
+		const MatchLog* log;
+		std::size_t run;
+		uint offset;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = const BaseArg*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = value_type;
+
+		const_iterator(const MatchLog* log, std::size_t run)
+			: log(log), run(run), offset(0) {}
+
+		const BaseArg* operator* () const {
+			return log->arg(log->runs[run].id);
+		}
+
+		const_iterator& operator++ () {
+			if (++offset == log->runs[run].count) {
+				run++;
+				offset = 0;
+			}
+
+			return *this;
+		}
+
+		const_iterator operator++ (int) {
+			auto old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator== (const const_iterator& other) const {
+			return run == other.run && offset == other.offset;
+		}
+
+		bool operator!= (const const_iterator& other) const {
+			return !(*this == other);
+		}
+	};
+
+
+	explicit MatchLog(MemoryResource* res = new_delete_resource())
+		: ids(res), runs(res), positions(res) {}
+
+	// whether to keep the argv position of every match (off by default)
+	void keep_positions(bool keep) {
+		positions_kept = keep;
+	}
+
+	bool keeps_positions() const {
+		return positions_kept;
+	}
+
+	// whether to keep the order of every match (on by default). Without the
+	// runs the log only grows with the number of distinct arguments: size,
+	// contains and first_before still work, but iteration and truncate don't
+	void keep_runs(bool keep) {
+		runs_kept = keep;
+	}
+
+	bool keeps_runs() const {
+		return runs_kept;
+	}
+
+	// pos is the argv position of the match, no_pos if it's not from argv
+	void add(const BaseArg& arg, uint pos = no_pos) {
+		if (!runs_kept)
+			intern(arg);
+		else if (!runs.empty() && ids[runs.back().id] == &arg
+				&& runs.back().count != std::numeric_limits<std::uint16_t>::max())
+			runs.back().count++;
+		else
+			add_run(intern(arg), 1);
+
+		if (positions_kept)
+			positions.push_back(pos);
+
+		match_count++;
+	}
+
+	// appends the matches of other, whose positions are offset by pos_offset
+	void append(const MatchLog& other, uint pos_offset = 0);
+
+	void clear();
+
+	// forgets every match after the first count
+	void truncate(std::size_t count);
+
+
+	// number of matches
+	std::size_t size() const {
+		return match_count;
+	}
+
+	bool empty() const {
+		return match_count == 0;
+	}
+
+	// whether arg has been matched
+	bool contains(const BaseArg& arg) const {
+		return find(arg) != no_id;
+	}
+
+	// whether a has first been matched before b. false if a has not been
+	// matched, true if only a has been matched
+	bool first_before(const BaseArg& a, const BaseArg& b) const {
+		id_type id_a = find(a);
+		return id_a != no_id && id_a < find(b);
+	}
+
+	// the id of arg, no_id if it has not been matched
+	id_type find(const BaseArg& arg) const;
+
+	const BaseArg* arg(id_type id) const {
+		return ids[id];
+	}
+
+	// the distinct matched arguments, indexed by id
+	const PolyVector<const BaseArg*>& args() const {
+		return ids;
+	}
+
+	const PolyVector<Run>& run_list() const {
+		return runs;
+	}
+
+	// argv position of the i-th match, no_pos if positions aren't kept
+	uint position(std::size_t i) const {
+		return i < positions.size() ? positions[i] : no_pos;
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, runs.size());
+	}
+
+	static constexpr id_type no_id = std::numeric_limits<id_type>::max();
+
+private:
+	PolyVector<const BaseArg*> ids;
+	PolyVector<Run> runs;
+	PolyVector<uint> positions;
+
+	std::size_t match_count = 0;
+	bool positions_kept = false;
+	bool runs_kept = true;
+
+	id_type intern(const BaseArg& arg);
+
+	void add_run(id_type id, uint count);
+};
+
+}
+
+#endif
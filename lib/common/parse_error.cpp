@@ -0,0 +1,25 @@
+#include "common/parse_error.hpp"
+
+#include "common/types.hpp"
+
+namespace args {
+
+
+std::string CondFailed::message() const {
+	if (!condition)
+		return error_msg;
+
+	std::string msg = condition;
+
+	if (other) {
+		msg += ' ';
+		msg += other->to_str();
+	} else if (has_number) {
+		msg += ' ';
+		msg += std::to_string(number);
+	}
+
+	return msg;
+}
+
+}
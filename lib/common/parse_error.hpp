@@ -55,6 +55,9 @@ struct UnknownArg {
 	StrView argv_element;
 	uint str_off;
 
+	// closest known name (see NameSuggester), empty if there is none
+	StrView suggestion;
+
 	explicit UnknownArg(const ParserState& state)
 		: argv_element(state.arg())
 		, str_off(state.str_off) {}
@@ -91,12 +94,39 @@ struct InvalidShortoptList : public BaseArgError {
 		, shortopt_list(std::move(shortopt_list)) {}
 };
 
+// The message of a failed condition is only built by message(), so that a
+// failing precondition (which just skips an argument) doesn't allocate.
+// Conditions give either a custom error_msg, or the name of the condition and
+// the argument or number it refers to.
 struct CondFailed : public BaseArgError {
 	std::string error_msg;
 
+	const char* condition = nullptr;
+	const BaseArg* other = nullptr;
+	uint number = 0;
+	bool has_number = false;
+
 	CondFailed(std::string error_msg, const BaseArg* arg = nullptr)
 		: BaseArgError(arg)
 		, error_msg(std::move(error_msg)) {}
+
+	static CondFailed lazy(const char* condition, const BaseArg* other) {
+		CondFailed e("");
+		e.condition = condition;
+		e.other = other;
+		return e;
+	}
+
+	static CondFailed lazy(const char* condition, uint number) {
+		CondFailed e("");
+		e.condition = condition;
+		e.number = number;
+		e.has_number = true;
+		return e;
+	}
+
+	// e.g. "Requires -f, --flag" or "Min 1"
+	std::string message() const;
 };
 
 
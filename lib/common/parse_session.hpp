@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_PARSE_SESSION_H
+#define ARGS_PARSE_SESSION_H
+
+#include <string>
+#include <tuple>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/parser.hpp"
+
+
+namespace args {
+
+// Parses many argvs with the same parsers, e.g. in a long-running service.
+// Every parse resets the arguments and reuses the storage of the previous
+// ones (argv views, matched arguments and result vectors), so once the
+// buffers are large enough no memory is allocated other than for string
+// results and error messages.
+template <typename... ArgParsers>
+class ParseSession {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	std::tuple<ArgParsers&...> arg_parsers;
+	OwnedParserState state;
+	std::string command_buffer;
+
+
+	template <std::size_t... Is>
+	void reset(Indices<Is...>) {
+		args::reset(std::get<Is>(arg_parsers)...);
+	}
+
+	template <std::size_t... Is>
+	ParseResultVoid parse_argv(Indices<Is...>) {
+		auto res = args::parse_argv(state, std::get<Is>(arg_parsers)...);
+
+		return res.is_ok()
+			? eval_postcond_iter(state, std::get<Is>(arg_parsers)...)
+			: res;
+	}
+
+	template <typename Source, std::size_t... Is>
+	ParseResultVoid parse_argv_with(const Source& source, Indices<Is...>) {
+		auto res = args::parse_argv(state, std::get<Is>(arg_parsers)...);
+
+		if (res.is_ok())
+			res = apply_source(source, state, std::get<Is>(arg_parsers)...);
+
+		return res.is_ok()
+			? eval_postcond_iter(state, std::get<Is>(arg_parsers)...)
+			: res;
+	}
+
+public:
+	explicit ParseSession(ArgParsers&... arg_parsers)
+		: arg_parsers(arg_parsers...) {}
+
+	ParseSession(ParseSession&&) = default;
+
+
+	// forgets the results of the previous parse
+	void reset() {
+		reset(BuildIndices<N>());
+	}
+
+	template <typename InputIt>
+	ParseResultVoid parse(InputIt argv_begin, InputIt argv_end) {
+		ARGS_TIME_PARSE();
+
+		reset();
+		state.assign(argv_begin, argv_end);
+
+		return parse_argv(BuildIndices<N>());
+	}
+
+	template <typename Source, typename InputIt>
+	ParseResultVoid parse_with(const Source& source,
+			InputIt argv_begin, InputIt argv_end) {
+
+		ARGS_TIME_PARSE();
+
+		reset();
+		state.assign(argv_begin, argv_end);
+
+		return parse_argv_with(source, BuildIndices<N>());
+	}
+
+	// parses a command line given as a single string, split like a shell
+	// would (see split_shell)
+	ParseResultVoid parse_command(StrView command) {
+		ARGS_TIME_PARSE();
+
+		reset();
+
+		if (!state.assign_command(command, command_buffer))
+			return ParseError(InvalidParam("unterminated quote or escape", command));
+
+		return parse_argv(BuildIndices<N>());
+	}
+
+	// state of the last parse (e.g. to inspect the matched arguments)
+	const ParserState& last_state() const {
+		return state;
+	}
+};
+
+
+template <typename... ArgParsers>
+ParseSession<ArgParsers...> session(ArgParsers&... arg_parsers) {
+	return ParseSession<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
@@ -27,6 +27,8 @@
 #include "common/parser_state.hpp"
 #include "common/arg.hpp"
 
+#include "sources/source.hpp"
+
 
 namespace args {
 
@@ -37,20 +39,125 @@ parse(InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
 }
 
 
+// like parse, but argv, the matched arguments and the results of the
+// arguments are allocated from resource during the parse (e.g. a
+// MonotonicBuffer per request). Previous results are forgotten. The results
+// are moved to new_delete_resource() before returning, so they stay valid
+// after resource is destroyed.
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(MemoryResource& resource,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	int expand[] = { 0, (arg_parsers.use_resource(&resource), 0)... };
+	(void) expand;
+
+	OwnedParserState state(argv_begin, argv_end, &resource);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = eval_postcond_iter(state, arg_parsers...);
+
+	int moved[] = { 0, (arg_parsers.move_results_to(new_delete_resource()), 0)... };
+	(void) moved;
+
+	return res;
+}
+
+
+// like parse, but arguments that are not given in argv are then looked up in
+// source (e.g. env_source("TOOL_")). Values in argv take precedence.
+template <typename Source, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse_with(const Source& source,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	OwnedParserState state(argv_begin, argv_end);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = apply_source(source, state, arg_parsers...);
+
+	return res.is_ok()? eval_postcond_iter(state, arg_parsers...) : res;
+}
+
+
 template <typename InputIt, typename... ArgParsers>
 ParseResultVoid
 parse_impl(InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
 
+	ARGS_TIME_PARSE();
+
 	OwnedParserState state(argv_begin, argv_end);
 
+	auto res = parse_argv(state, arg_parsers...);
+
+	return res.is_ok()? eval_postcond_iter(state, arg_parsers...) : res;
+}
+
+
+// numbers the arguments that no Schema has numbered in declaration order
+// across arg_parsers, like a Schema of them would, so that the per-argument
+// statistics of ARGS_INSTRUMENT (see ArgCost) tell them apart. Numbered
+// arguments keep their id, so a Schema that contains them still works
+struct ArgNumberer {
+	uint next;
+
+	template <typename A>
+	void operator() (A& arg) {
+		if (arg.id == BaseArg::no_id)
+			arg.id = next;
+
+		next++;
+	}
+};
+
+template <typename... ArgParsers>
+void number_args(ArgParsers&... arg_parsers) {
+	ArgNumberer numberer { 0 };
+
+	int expand[] = { 0, (arg_parsers.for_each_arg(numberer), 0)... };
+	(void) expand;
+}
+
+
+template <typename... ArgParsers>
+ParseResultVoid parse_argv(OwnedParserState& state, ArgParsers&... arg_parsers) {
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
 	while (state.pos < state.argv.size()) {
 		auto res = parse_iter(state, arg_parsers...);
 
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers...);
+
 		if (!res.is_ok())
 			return res;
 	}
 
-	return eval_postcond_iter(state, arg_parsers...);
+	return success();
+}
+
+
+// fills the suggestion of an unknown argument with the closest name of the
+// arguments of the parsers
+template <typename... ArgParsers>
+void suggest(UnknownArg& err, const ArgParsers&... arg_parsers) {
+	if (err.str_off != 0)
+		return;
+
+	NameSuggester suggester(longopt_name(err.argv_element));
+
+	int expand[] = { 0, (suggester.add(arg_parsers.names()), 0)... };
+	(void) expand;
+
+	err.suggestion = suggester.suggestion();
 }
 
 
@@ -68,6 +175,17 @@ ParseResultVoid parse_iter(OwnedParserState& state,
 }
 
 
+// forgets the results of a previous parse so that the arguments can be reused
+inline void reset() {
+}
+
+template <typename ArgParser, typename... ArgParsers>
+void reset(ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+	arg_parser.reset();
+	reset(arg_parsers...);
+}
+
+
 inline ParseResultVoid eval_postcond_iter(const OwnedParserState& state) {
 	return success();
 }
@@ -1,39 +1,66 @@
 #include "parser_state.hpp"
 
-using namespace args;
+#include "common/types.hpp"
+#include "utils/tokenizer.hpp"
 
+namespace args {
 
-ParserState::ParserState(
-		const std::vector<const BaseArg*>& matched_args,
-		const std::vector<StrView>& argv)
+
+ParserState::ParserState(const MatchLog& matched_args, const Argv& argv)
 	: matched_args(matched_args)
 	, argv(argv) {}
 
 
-bool ParserState::bounds_check() const {
-	return ::args::bounds_check(pos, argv);
+uint ParserState::multiplicity(const BaseArg& arg) const {
+	if (!counts)
+		return arg.multiplicity;
+	else
+		return arg.id < count_size ? counts[arg.id] : 0;
 }
 
-bool ParserState::offset_check() const {
-	return ::args::bounds_check(str_off, arg());
-}
 
-const StrView& ParserState::arg() const {
-	return argv[pos];
+bool OwnedParserState::assign_command(StrView command, std::string& buffer) {
+	rewind(0, false, 0);
+
+	return replace_command(command, buffer);
 }
 
-const StrView& ParserState::arg_next() {
-	auto& a = arg();
-	pos++;
-	return a;
+bool OwnedParserState::replace_command(StrView command, std::string& buffer,
+		std::vector<std::size_t>* word_ends) {
+
+	owned_argv.clear();
+
+	if (word_ends)
+		word_ends->clear();
+
+	bool ok = split_shell(command, owned_argv, buffer, word_ends);
+
+	classify();
+
+	return ok;
 }
 
-char ParserState::ch() const {
-	return arg()[str_off];
+void OwnedParserState::rewind(uint pos, bool end_of_flags, std::size_t match_count) {
+	this->pos = pos;
+	this->str_off = 0;
+	this->end_of_flags = end_of_flags;
+	longopt_match = StrView();
+
+	owned_matched_args.truncate(match_count);
 }
 
-void ParserState::update(ParserState& clone) {
-	pos = clone.pos;
-	str_off = clone.str_off;
+void OwnedParserState::classify() {
+	owned_classes.resize(owned_argv.size());
+	end_of_flags_pos = owned_argv.size();
+
+	for (uint i = 0; i < owned_argv.size(); i++) {
+		owned_classes[i] = classify_token(owned_argv[i]);
+
+		if (owned_classes[i] == TokenClass::EndOfFlags && end_of_flags_pos == owned_argv.size())
+			end_of_flags_pos = i;
+	}
+
+	classes = owned_classes.data();
 }
 
+}
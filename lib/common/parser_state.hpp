@@ -20,9 +20,13 @@
 #ifndef ARGS_PARSER_STATE_H
 #define ARGS_PARSER_STATE_H
 
+#include <cstring>
 #include <vector>
 #include <string>
 
+#include "common/match_log.hpp"
+
+#include "utils/memory_resource.hpp"
 #include "utils/string_view.hpp"
 
 
@@ -30,6 +34,8 @@ namespace args {
 
 struct BaseArg;
 
+using Argv = PolyVector<StrView>;
+
 
 template <typename Container>
 bool bounds_check(int pos, const Container& cont) {
@@ -37,16 +43,68 @@ bool bounds_check(int pos, const Container& cont) {
 }
 
 
+// What an argv token looks like, computed once per argv by OwnedParserState
+// so that parsers don't have to look at the strings of tokens they can't match
+enum class TokenClass : unsigned char {
+	Positional,      // doesn't start with '-' (or is empty)
+	Dash,            // "-"
+	EndOfFlags,      // "--"
+	ShortoptCluster, // "-abc"
+	Longopt,         // "--name"
+	LongoptValue     // "--name=value"
+};
+
+inline TokenClass classify_token(const StrView& token) {
+	if (token.size() < 2 || token[0] != '-')
+		return token.size() == 1 && token[0] == '-'
+			? TokenClass::Dash
+			: TokenClass::Positional;
+
+	if (token[1] != '-')
+		return TokenClass::ShortoptCluster;
+
+	if (token.size() == 2)
+		return TokenClass::EndOfFlags;
+
+	return std::memchr(token.c_str() + 2, '=', token.size() - 2)
+		? TokenClass::LongoptValue
+		: TokenClass::Longopt;
+}
+
+// the name of a longopt token, i.e. "--name" for "--name=value"
+inline StrView longopt_name(const StrView& token) {
+	auto eq = static_cast<const char*>(std::memchr(token.c_str(), '=', token.size()));
+
+	return eq ? token.substr(0, eq - token.c_str()) : token;
+}
+
+
 struct ParserState {
 	uint pos = 0;
 	uint str_off = 0;
 
-	const std::vector<const BaseArg*>& matched_args;
-	const std::vector<StrView>& argv;
+	// "--" has been found, so everything else is a positional argument
+	bool end_of_flags = false;
+
+	const MatchLog& matched_args;
+	const Argv& argv;
+
+	// where parsers allocate the values they own (see ParamParser<PolyString>)
+	MemoryResource* resource = new_delete_resource();
+
+	// multiplicities indexed by BaseArg::id when the results are stored out of
+	// the arguments (see Schema), null when they are stored in the arguments
+	const uint* counts = nullptr;
+	uint count_size = 0;
 
-	ParserState(
-			const std::vector<const BaseArg*>& matched_args,
-			const std::vector<StrView>& argv);
+	// class of every token of argv, null to classify them when needed
+	const TokenClass* classes = nullptr;
+
+	// longopt that the current token abbreviates (see FlagParser), empty if
+	// it must be matched exactly
+	StrView longopt_match;
+
+	ParserState(const MatchLog& matched_args, const Argv& argv);
 
 	ParserState(const ParserState&) = default;
 
@@ -59,25 +117,154 @@ struct ParserState {
 
 	const StrView& arg_next();
 
+	// the next parameter of a flag: the rest of the current token if it's
+	// attached to the flag ("-j8", "--jobs=8"), otherwise the next token
+	StrView param_next();
+
 	char ch() const;
 
+	// class of the current token
+	TokenClass token_class() const;
+
+	// how many times arg has been parsed so far. conditions must use this
+	// instead of BaseArg::multiplicity so that they work with a Schema
+	uint multiplicity(const BaseArg& arg) const;
+
 	void update(ParserState& clone);
 };
 
 
+// the accessors are used for every token by the parse loop, they are defined
+// here so that they can be inlined into it
+
+inline bool ParserState::bounds_check() const {
+	return ::args::bounds_check(pos, argv);
+}
+
+inline bool ParserState::offset_check() const {
+	return ::args::bounds_check(str_off, arg());
+}
+
+inline const StrView& ParserState::arg() const {
+	return argv[pos];
+}
+
+inline const StrView& ParserState::arg_next() {
+	auto& a = arg();
+	pos++;
+	return a;
+}
+
+inline StrView ParserState::param_next() {
+	if (str_off == 0)
+		return arg_next();
+
+	auto param = arg().substr(str_off);
+
+	pos++;
+	str_off = 0;
+
+	return param;
+}
+
+inline char ParserState::ch() const {
+	return arg()[str_off];
+}
+
+inline TokenClass ParserState::token_class() const {
+	return classes ? classes[pos] : classify_token(arg());
+}
+
+inline void ParserState::update(ParserState& clone) {
+	pos = clone.pos;
+	str_off = clone.str_off;
+	longopt_match = StrView();
+}
+
+
+// Owns argv, the matched arguments and the token classes, allocated from
+// res (see MemoryResource), which must outlive the state
 struct OwnedParserState : public ParserState {
-	std::vector<const BaseArg*> owned_matched_args = {};
+	MatchLog owned_matched_args;
+
+	// position of the first "--" in argv, or argv.size()
+	uint end_of_flags_pos = 0;
+
+	explicit OwnedParserState(MemoryResource* res = new_delete_resource())
+		: ParserState(owned_matched_args, owned_argv)
+		, owned_matched_args(res)
+		, owned_argv(res)
+		, owned_classes(res) {
+
+		resource = res;
+	}
 
 	template <typename InputIt>
-	OwnedParserState(InputIt argv_begin, InputIt argv_end)
+	OwnedParserState(InputIt argv_begin, InputIt argv_end,
+			MemoryResource* res = new_delete_resource())
+		: ParserState(owned_matched_args, owned_argv)
+		, owned_matched_args(res)
+		, owned_argv(argv_begin, argv_end, res)
+		, owned_classes(res) {
+
+		resource = res;
+		classify();
+	}
+
+	OwnedParserState(OwnedParserState&& other)
 		: ParserState(owned_matched_args, owned_argv)
-		, owned_argv(argv_begin, argv_end) {
+		, owned_matched_args(std::move(other.owned_matched_args))
+		, end_of_flags_pos(other.end_of_flags_pos)
+		, owned_argv(std::move(other.owned_argv))
+		, owned_classes(std::move(other.owned_classes)) {
 
-		owned_matched_args.reserve(argv.size());
+		resource = other.resource;
+		pos = other.pos;
+		str_off = other.str_off;
+		end_of_flags = other.end_of_flags;
+		counts = other.counts;
+		count_size = other.count_size;
+		classes = other.classes ? owned_classes.data() : nullptr;
 	}
 
+	OwnedParserState(const OwnedParserState&) = delete;
+	OwnedParserState& operator= (const OwnedParserState&) = delete;
+
+	// starts over with a new argv, reusing the storage of the previous one
+	template <typename InputIt>
+	void assign(InputIt argv_begin, InputIt argv_end) {
+		owned_argv.assign(argv_begin, argv_end);
+		owned_matched_args.clear();
+
+		pos = 0;
+		str_off = 0;
+		end_of_flags = false;
+
+		classify();
+	}
+
+	// starts over with the words of a shell command line (see split_shell),
+	// reusing the storage of the previous argv. The unescaped words are stored
+	// in buffer, which must outlive the parse. Returns false if command has an
+	// unterminated quote
+	bool assign_command(StrView command, std::string& buffer);
+
+	// replaces argv with the words of command like assign_command, but keeps
+	// the position and the matched arguments, for when only the tokens after
+	// the position have changed (see IncrementalSession)
+	bool replace_command(StrView command, std::string& buffer,
+			std::vector<std::size_t>* word_ends = nullptr);
+
+	// goes back to token pos, forgetting every match after the first
+	// match_count
+	void rewind(uint pos, bool end_of_flags, std::size_t match_count);
+
 private:
-	const std::vector<StrView> owned_argv;
+	Argv owned_argv;
+	PolyVector<TokenClass> owned_classes;
+
+	// classifies every token of argv and finds the first "--"
+	void classify();
 };
 
 
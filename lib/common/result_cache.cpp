@@ -0,0 +1,206 @@
+#include "common/result_cache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace args {
+
+
+namespace {
+
+thread_local CacheRecorder* current_recorder = nullptr;
+
+const char cache_magic[8] = { 'A', 'R', 'G', 'S', 'R', 'C', '0', '2' };
+
+void put_u64(std::string& out, std::uint64_t value) {
+	ResultCodec<std::uint64_t>::encode(value, out);
+}
+
+bool dependency_unchanged(const CacheDependency& dep) {
+	return dep.stamp == (dep.kind == CacheDependency::Kind::File
+		? file_stamp(dep.name)
+		: env_stamp(dep.name));
+}
+
+}
+
+
+std::uint64_t file_stamp(const Str& path) {
+	struct stat st;
+
+	// a missing file is a state too: creating it invalidates the results
+	if (::stat(path.c_str(), &st) != 0)
+		return 0;
+
+	Fnv1a h;
+	h.add_u64(st.st_dev);
+	h.add_u64(st.st_ino);
+	h.add_u64(st.st_size);
+	h.add_u64(st.st_mtim.tv_sec);
+	h.add_u64(st.st_mtim.tv_nsec);
+	h.add_u64(st.st_ctim.tv_sec);
+	h.add_u64(st.st_ctim.tv_nsec);
+
+	return h.value();
+}
+
+std::uint64_t env_stamp(const Str& name) {
+	const char* value = std::getenv(name.c_str());
+
+	Fnv1a h;
+	h.add_u64(value != nullptr);
+
+	if (value)
+		h.add(StrView(value));
+
+	return h.value();
+}
+
+
+void cache_depend_on_file(const Str& path) {
+	if (current_recorder)
+		current_recorder->add(CacheDependency::Kind::File, path, file_stamp(path));
+}
+
+void cache_depend_on_env(const Str& name) {
+	if (current_recorder)
+		current_recorder->add(CacheDependency::Kind::Env, name, env_stamp(name));
+}
+
+
+CacheRecorder::CacheRecorder()
+	: previous(current_recorder) {
+
+	current_recorder = this;
+}
+
+CacheRecorder::~CacheRecorder() {
+	current_recorder = previous;
+}
+
+void CacheRecorder::add(CacheDependency::Kind kind, const Str& name, std::uint64_t stamp) {
+	for (const auto& dep : deps) {
+		if (dep.kind == kind && dep.name == name)
+			return;
+	}
+
+	deps.push_back(CacheDependency { kind, name, stamp });
+}
+
+
+ResultCache::ResultCache(Str dir, std::uint64_t version)
+	: dir(std::move(dir))
+	, version(version) {}
+
+void ResultCache::encode_context(std::string& key) const {
+	// rebuilding the program may change how the arguments validate
+	put_u64(key, file_stamp("/proc/self/exe"));
+	put_u64(key, version);
+
+	for (const auto& name : env_names) {
+		const char* value = std::getenv(name.c_str());
+
+		ResultCodec<Str>::encode(name, key);
+		ResultCodec<bool>::encode(value != nullptr, key);
+		ResultCodec<StrView>::encode(value ? StrView(value) : StrView(), key);
+	}
+}
+
+Str ResultCache::entry_path(const std::string& key) const {
+	char name[32];
+	std::snprintf(name, sizeof name, "/%016llx.args",
+			static_cast<unsigned long long>(Fnv1a().add(key).value()));
+
+	return dir + name;
+}
+
+bool ResultCache::load(const std::string& key, ByteReader& payload) {
+	// mapped aside, so that the views of the last hit stay valid on a miss
+	MappedFile file(entry_path(key).c_str());
+
+	if (!file.is_open())
+		return false;
+
+	ByteReader in(file.data());
+
+	char magic[sizeof cache_magic];
+	StrView stored_key;
+	std::uint32_t dep_count;
+
+	// the hash only picks the file, the whole key must match
+	if (!in.read(magic, sizeof magic) || std::memcmp(magic, cache_magic, sizeof magic) != 0
+			|| !ResultCodec<StrView>::decode(in, stored_key) || stored_key != StrView(key)
+			|| !ResultCodec<std::uint32_t>::decode(in, dep_count))
+		return false;
+
+	for (std::uint32_t i = 0; i < dep_count; i++) {
+		CacheDependency dep;
+
+		if (!ResultCodec<CacheDependency::Kind>::decode(in, dep.kind)
+				|| !ResultCodec<Str>::decode(in, dep.name)
+				|| !ResultCodec<std::uint64_t>::decode(in, dep.stamp)
+				|| !dependency_unchanged(dep))
+			return false;
+	}
+
+	StrView data;
+	std::uint64_t payload_size;
+
+	if (!ResultCodec<std::uint64_t>::decode(in, payload_size)
+			|| !in.view(payload_size, data) || !in.at_end())
+		return false;
+
+	loaded = std::move(file);
+	payload = ByteReader(data);
+	return true;
+}
+
+void ResultCache::store(const std::string& key,
+		const std::vector<CacheDependency>& deps, const std::string& payload) {
+
+	std::string out(cache_magic, sizeof cache_magic);
+	ResultCodec<StrView>::encode(StrView(key), out);
+	ResultCodec<std::uint32_t>::encode(deps.size(), out);
+
+	for (const auto& dep : deps) {
+		ResultCodec<CacheDependency::Kind>::encode(dep.kind, out);
+		ResultCodec<Str>::encode(dep.name, out);
+		put_u64(out, dep.stamp);
+	}
+
+	put_u64(out, payload.size());
+	out += payload;
+
+	// written next to the entry and renamed over it, so that readers see
+	// either the old entry or the whole new one
+	Str path = entry_path(key);
+	Str tmp = path + "." + std::to_string(::getpid()) + ".tmp";
+
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+	if (fd < 0)
+		return;
+
+	std::size_t written = 0;
+
+	while (written < out.size()) {
+		ssize_t n = ::write(fd, out.data() + written, out.size() - written);
+
+		if (n <= 0)
+			break;
+
+		written += n;
+	}
+
+	::close(fd);
+
+	if (written != out.size() || ::rename(tmp.c_str(), path.c_str()) != 0)
+		::unlink(tmp.c_str());
+}
+
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_RESULT_CACHE_H
+#define ARGS_RESULT_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser.hpp"
+#include "common/result_codec.hpp"
+
+#include "utils/hash.hpp"
+#include "utils/mapped_file.hpp"
+
+
+namespace args {
+
+// Something the results of a parse depend on besides argv: a file (e.g. a
+// path a validator resolved) or an environment variable, with a stamp of its
+// state (file metadata, variable value) when the results were cached
+struct CacheDependency {
+	enum class Kind : std::uint8_t { File, Env };
+
+	Kind kind;
+	Str name;
+	std::uint64_t stamp;
+};
+
+std::uint64_t file_stamp(const Str& path);
+
+std::uint64_t env_stamp(const Str& name);
+
+// Records the dependencies of the results of a parse made by parse_cached.
+// ParamParsers and arguments that look at files or the environment must call
+// these so that the cached results are discarded when those change: nothing
+// else detects it, and none of the built-in parameters report anything. The
+// checks of ExistingPath and friends are run by PathChecks after the parse,
+// so they are redone on every call and need no reporting, but custom
+// ParamParsers and LambdaArgs must report what they read. They do nothing
+// outside of parse_cached.
+void cache_depend_on_file(const Str& path);
+
+void cache_depend_on_env(const Str& name);
+
+
+// Collects the dependencies reported on this thread while it's alive
+class CacheRecorder {
+	CacheRecorder* previous;
+	std::vector<CacheDependency> deps;
+
+	friend void cache_depend_on_file(const Str&);
+	friend void cache_depend_on_env(const Str&);
+
+	void add(CacheDependency::Kind kind, const Str& name, std::uint64_t stamp);
+
+public:
+	CacheRecorder();
+
+	CacheRecorder(const CacheRecorder&) = delete;
+	CacheRecorder& operator= (const CacheRecorder&) = delete;
+
+	~CacheRecorder();
+
+	const std::vector<CacheDependency>& dependencies() const {
+		return deps;
+	}
+};
+
+
+// Directory of parse results (see parse_cached), one file per hash of the key
+// (argv and its context). An entry stores the whole key, and is only used if
+// the key is the same byte for byte and all its dependencies are unchanged.
+// Entries are replaced atomically, so concurrent processes can share the
+// directory. The directory must exist; failing to write an entry only makes
+// the next parse a miss.
+class ResultCache {
+	Str dir;
+	std::vector<Str> env_names;
+	std::uint64_t version;
+
+	// the entry of the last hit, which decoded views point into
+	MappedFile entry;
+
+	// the entry of the last load, until its results are decoded
+	MappedFile loaded;
+
+	std::size_t hit_count = 0;
+	std::size_t miss_count = 0;
+
+public:
+	// version is mixed into every key, to be bumped when the behavior of the
+	// arguments changes without changing their types or names
+	explicit ResultCache(Str dir, std::uint64_t version = 0);
+
+	// makes the value of an environment variable part of the key
+	ResultCache& env(Str name) {
+		env_names.push_back(std::move(name));
+		return *this;
+	}
+
+	// appends the program, the version and the environment variables of the
+	// key to key
+	void encode_context(std::string& key) const;
+
+	// maps the entry of key and checks it, payload is then the encoded results.
+	// The mapping of the last hit stays until keep_loaded() replaces it
+	bool load(const std::string& key, ByteReader& payload);
+
+	// makes the entry of the last load the one decoded views point into, once
+	// its results have been decoded
+	void keep_loaded() {
+		entry = std::move(loaded);
+	}
+
+	void store(const std::string& key,
+			const std::vector<CacheDependency>& deps, const std::string& payload);
+
+	void count(bool hit) {
+		(hit ? hit_count : miss_count)++;
+	}
+
+	std::size_t hits() const {
+		return hit_count;
+	}
+
+	std::size_t misses() const {
+		return miss_count;
+	}
+
+private:
+	Str entry_path(const std::string& key) const;
+};
+
+
+struct ResultEncoder {
+	std::string& out;
+
+	template <typename A>
+	void operator() (const A& arg) const {
+		using Codec = ResultCodec<typename A::value_type>;
+
+		ResultCodec<std::uint32_t>::encode(arg.multiplicity, out);
+		ResultCodec<Origin>::encode(arg.origin, out);
+		ResultCodec<std::uint32_t>::encode(arg.result.size(), out);
+
+		for (const auto& value : arg.result)
+			Codec::encode(value, out);
+	}
+};
+
+struct ResultDecoder {
+	ByteReader& in;
+	bool ok;
+
+	template <typename A>
+	void operator() (A& arg) {
+		using Codec = ResultCodec<typename A::value_type>;
+
+		std::uint32_t multiplicity, count;
+
+		ok = ok
+			&& ResultCodec<std::uint32_t>::decode(in, multiplicity)
+			&& ResultCodec<Origin>::decode(in, arg.origin)
+			&& ResultCodec<std::uint32_t>::decode(in, count);
+
+		for (std::uint32_t i = 0; ok && i < count; i++) {
+			typename A::value_type value;
+			ok = Codec::decode(in, value);
+
+			if (ok)
+				arg.result.push_back(std::move(value));
+		}
+
+		if (ok)
+			arg.multiplicity = multiplicity;
+	}
+};
+
+struct ArgFingerprint {
+	Fnv1a& h;
+
+	template <typename A>
+	void operator() (const A& arg) const {
+		h.add(typeid(typename A::value_type).name());
+		h.add(arg.to_str());
+		h.add(arg.source_key);
+	}
+};
+
+
+// hash of the types of the parsers and the names of their arguments, which
+// changes when the arguments or the types of their results do
+template <typename... ArgParsers>
+std::uint64_t cache_fingerprint(const ArgParsers&... arg_parsers) {
+	Fnv1a h;
+	ArgFingerprint add_arg { h };
+
+	int expand[] = { 0, (
+		h.add(typeid(ArgParsers).name()),
+		arg_parsers.for_each_arg(add_arg), 0)... };
+	(void) expand;
+
+	return h.value();
+}
+
+
+// Like parse, but the results are loaded from cache when the same argv (and
+// environment variables of cache, see ResultCache::env) has already been
+// parsed successfully by the same program, instead of being converted and
+// validated again. Postconditions are not evaluated again either. Failed
+// parses are not cached. The results of every argument need a ResultCodec.
+// Views in the results of a hit point into its entry, and are valid until the
+// next hit of cache.
+template <typename InputIt, typename... ArgParsers>
+ParseResultVoid parse_cached(ResultCache& cache,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
+
+	std::string key;
+	ResultCodec<std::uint64_t>::encode(cache_fingerprint(arg_parsers...), key);
+	cache.encode_context(key);
+
+	for (auto i = argv_begin; i != argv_end; ++i)
+		ResultCodec<StrView>::encode(StrView(*i), key);
+
+	ByteReader payload;
+
+	if (cache.load(key, payload)) {
+		reset(arg_parsers...);
+
+		ResultDecoder decoder { payload, true };
+
+		int expand[] = { 0, (arg_parsers.for_each_arg(decoder), 0)... };
+		(void) expand;
+
+		if (decoder.ok && payload.at_end()) {
+			cache.keep_loaded();
+			cache.count(true);
+			return success();
+		}
+	}
+
+	cache.count(false);
+	reset(arg_parsers...);
+
+	CacheRecorder recorder;
+	auto res = parse_impl(argv_begin, argv_end, arg_parsers...);
+
+	if (res.is_ok()) {
+		std::string encoded;
+		ResultEncoder encoder { encoded };
+
+		int expand[] = { 0, (arg_parsers.for_each_arg(encoder), 0)... };
+		(void) expand;
+
+		cache.store(key, recorder.dependencies(), encoded);
+	}
+
+	return res;
+}
+
+}
+
+#endif
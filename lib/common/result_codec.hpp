@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_RESULT_CODEC_H
+#define ARGS_RESULT_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "common/types.hpp"
+
+#include "utils/string_view.hpp"
+
+
+namespace args {
+
+// Reads the bytes written by ResultCodecs, failing instead of reading past
+// the end
+struct ByteReader {
+	const char* p = nullptr;
+	const char* end = nullptr;
+
+	ByteReader() = default;
+
+	explicit ByteReader(StrView data)
+		: p(data.begin()), end(data.end()) {}
+
+	bool read(void* out, std::size_t size) {
+		if (static_cast<std::size_t>(end - p) < size)
+			return false;
+
+		std::memcpy(out, p, size);
+		p += size;
+		return true;
+	}
+
+	// a view into the data, which must outlive it
+	bool view(std::size_t size, StrView& out) {
+		if (static_cast<std::size_t>(end - p) < size)
+			return false;
+
+		out = StrView(p, size);
+		p += size;
+		return true;
+	}
+
+	bool at_end() const {
+		return p == end;
+	}
+};
+
+
+template <typename T>
+struct IsTuple : std::false_type {};
+
+template <typename... Ts>
+struct IsTuple<std::tuple<Ts...>> : std::true_type {};
+
+
+// Converts results of type T to bytes and back, for ResultCache. Trivially
+// copyable types are stored as they are (so they must not hold pointers),
+// specialize it for other types.
+template <typename T, typename Enable = void>
+struct ResultCodec {
+	static_assert(
+		!std::is_same<T,T>::value,
+		"ResultCodec is not specialized for this type");
+};
+
+template <typename T>
+struct ResultCodec<T, typename std::enable_if<
+		std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value
+		&& !std::is_same<T, StrView>::value && !IsTuple<T>::value
+	>::type> {
+
+	static void encode(const T& value, std::string& out) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof value);
+	}
+
+	static bool decode(ByteReader& in, T& value) {
+		return in.read(&value, sizeof value);
+	}
+};
+
+template <>
+struct ResultCodec<Str> {
+	static void encode(const Str& value, std::string& out) {
+		std::uint32_t size = value.size();
+		ResultCodec<std::uint32_t>::encode(size, out);
+		out += value;
+	}
+
+	static bool decode(ByteReader& in, Str& value) {
+		std::uint32_t size;
+		StrView data;
+
+		if (!ResultCodec<std::uint32_t>::decode(in, size) || !in.view(size, data))
+			return false;
+
+		value.assign(data.c_str(), data.size());
+		return true;
+	}
+};
+
+// decoded views point into the cache entry, which stays mapped until the
+// ResultCache that loaded it loads another one
+template <>
+struct ResultCodec<StrView> {
+	static void encode(const StrView& value, std::string& out) {
+		std::uint32_t size = value.size();
+		ResultCodec<std::uint32_t>::encode(size, out);
+		out.append(value.c_str(), value.size());
+	}
+
+	static bool decode(ByteReader& in, StrView& value) {
+		std::uint32_t size;
+		return ResultCodec<std::uint32_t>::decode(in, size) && in.view(size, value);
+	}
+};
+
+template <typename... Ts>
+struct ResultCodec<std::tuple<Ts...>> {
+	using Tuple = std::tuple<Ts...>;
+
+	static void encode(const Tuple& value, std::string& out) {
+		encode_iter<0>(value, out);
+	}
+
+	static bool decode(ByteReader& in, Tuple& value) {
+		return decode_iter<0>(in, value);
+	}
+
+private:
+	template <std::size_t I>
+	static If<I == sizeof...(Ts), void> encode_iter(const Tuple&, std::string&) {
+	}
+
+	template <std::size_t I>
+	static If<I < sizeof...(Ts), void> encode_iter(const Tuple& value, std::string& out) {
+		using T = typename std::tuple_element<I, Tuple>::type;
+
+		ResultCodec<T>::encode(std::get<I>(value), out);
+		encode_iter<I+1>(value, out);
+	}
+
+	template <std::size_t I>
+	static If<I == sizeof...(Ts), bool> decode_iter(ByteReader&, Tuple&) {
+		return true;
+	}
+
+	template <std::size_t I>
+	static If<I < sizeof...(Ts), bool> decode_iter(ByteReader& in, Tuple& value) {
+		using T = typename std::tuple_element<I, Tuple>::type;
+
+		return ResultCodec<T>::decode(in, std::get<I>(value)) && decode_iter<I+1>(in, value);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,480 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_SCHEMA_H
+#define ARGS_SCHEMA_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/arg.hpp"
+#include "common/parser.hpp"
+
+#include "utils/alloc_audit.hpp"
+#include "utils/thread_pool.hpp"
+
+
+namespace args {
+
+template <typename... ArgParsers>
+class Schema;
+
+
+// Results of a parse with a Schema. Unlike args::parse, the arguments are not
+// modified: their results and multiplicities are stored here instead.
+template <typename... ArgParsers>
+class Results {
+	friend class Schema<ArgParsers...>;
+
+public:
+	using ParsersTuple = std::tuple<ArgParsers...>;
+	using ValuesTuple = std::tuple<typename ArgParsers::Values...>;
+
+private:
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	const ParsersTuple* arg_parsers = nullptr;
+
+	ValuesTuple values;
+	std::vector<uint> counts;
+	ParseResultVoid res = success();
+
+
+	template <typename A>
+	using ValuesPtr = const std::vector<typename A::value_type>*;
+
+	template <std::size_t P, typename A>
+	If<P == N, ValuesPtr<A>> find_values_iter(const A&) const {
+		return nullptr;
+	}
+
+	template <std::size_t P, typename A>
+	If<P < N, ValuesPtr<A>> find_values_iter(const A& arg) const {
+		auto found = std::get<P>(*arg_parsers).find_values(arg, std::get<P>(values));
+
+		return found ? found : find_values_iter<P+1>(arg);
+	}
+
+
+	template <std::size_t... Ps>
+	void clear(Indices<Ps...>) {
+		int expand[] = { 0, (clear_values(std::get<Ps>(values)), 0)... };
+		(void) expand;
+	}
+
+	template <typename... Vecs>
+	static void clear_values(std::tuple<Vecs...>& vecs) {
+		clear_vecs(vecs, BuildIndices<sizeof...(Vecs)>());
+	}
+
+	template <typename Tuple, std::size_t... Is>
+	static void clear_vecs(Tuple& vecs, Indices<Is...>) {
+		int expand[] = { 0, (std::get<Is>(vecs).clear(), 0)... };
+		(void) expand;
+	}
+
+	void clear(const ParsersTuple* arg_parsers, uint arg_count) {
+		this->arg_parsers = arg_parsers;
+		clear(BuildIndices<N>());
+		counts.assign(arg_count, 0);
+		res = success();
+	}
+
+public:
+
+	// the parse error, or success()
+	const ParseResultVoid& result() const {
+		return res;
+	}
+
+	bool is_ok() const {
+		return res.is_ok();
+	}
+
+	uint multiplicity(const BaseArg& arg) const {
+		return arg.id < counts.size() ? counts[arg.id] : 0;
+	}
+
+	bool has(const BaseArg& arg) const {
+		return multiplicity(arg) > 0;
+	}
+
+	// results of every argument, grouped by parser
+	const ValuesTuple& all_values() const {
+		return values;
+	}
+
+	// the equivalent of arg.result. arg must be part of the schema
+	template <typename A>
+	const std::vector<typename A::value_type>& operator[] (const A& arg) const {
+		static const std::vector<typename A::value_type> none;
+
+		auto found = arg_parsers ? find_values_iter<0>(arg) : nullptr;
+
+		return found ? *found : none;
+	}
+};
+
+
+// ChunkTraits of every argument of a set of parsers
+template <typename... ArgParsers>
+struct ParsersChunkTraits {
+	static constexpr bool chunkable = true;
+	static constexpr std::size_t max_arity = 0;
+};
+
+template <typename P, typename... ArgParsers>
+struct ParsersChunkTraits<P, ArgParsers...> {
+	using Rest = ParsersChunkTraits<ArgParsers...>;
+
+	static constexpr bool chunkable = P::Chunking::chunkable && Rest::chunkable;
+
+	static constexpr std::size_t max_arity = P::Chunking::max_arity > Rest::max_arity
+		? P::Chunking::max_arity : Rest::max_arity;
+};
+
+
+// computes where the values of every chunk of argv go in the merged results
+struct ChunkSizeValues {
+	std::vector<std::size_t>& bases;
+
+	template <typename T>
+	void operator() (const std::vector<T>& chunk, std::vector<T>& merged) {
+		bases.push_back(merged.size());
+		merged.resize(merged.size() + chunk.size());
+	}
+};
+
+// moves the values of a chunk of argv to the merged results
+struct ChunkMoveValues {
+	const std::vector<std::size_t>& bases;
+	std::size_t arg;
+
+	explicit ChunkMoveValues(const std::vector<std::size_t>& bases)
+		: bases(bases)
+		, arg(0) {}
+
+	template <typename T>
+	void operator() (std::vector<T>& chunk, std::vector<T>& merged) {
+		std::move(begin(chunk), end(chunk), begin(merged) + bases[arg++]);
+	}
+};
+
+
+// Read-only set of parsers that can be used by many threads at once, since
+// parsing stores everything in a Results object instead of the arguments.
+// Building a schema numbers its arguments (BaseArg::id), so an argument can
+// only belong to one schema. Custom arguments and conditions must not modify
+// themselves while parsing and must use ParserState::multiplicity().
+template <typename... ArgParsers>
+class Schema {
+	static constexpr std::size_t N = sizeof...(ArgParsers);
+
+	std::tuple<ArgParsers...> arg_parsers;
+	uint arg_count = 0;
+
+	// see allocation_free
+	bool alloc_free = false;
+
+
+	struct IdAssigner {
+		uint next = 0;
+
+		template <typename A>
+		void operator() (A& arg) {
+			arg.id = next++;
+		}
+	};
+
+	template <std::size_t... Ps>
+	void assign_ids(Indices<Ps...>) {
+		IdAssigner assigner;
+		int expand[] = { 0, (std::get<Ps>(arg_parsers).for_each_arg(assigner), 0)... };
+		(void) expand;
+		arg_count = assigner.next;
+	}
+
+
+	template <std::size_t P>
+	If<P == N> parse_iter(OwnedParserState& state, Results<ArgParsers...>&) const {
+		return ParseError(UnknownArg(state));
+	}
+
+	template <std::size_t P>
+	If<P < N> parse_iter(OwnedParserState& state, Results<ArgParsers...>& out) const {
+		using Parser = typename std::tuple_element<P, std::tuple<ArgParsers...>>::type;
+
+		typename Parser::ValueSink sink { std::get<P>(out.values), out.counts.data() };
+
+		auto res = std::get<P>(arg_parsers).parse(state, sink);
+
+		return is<UnknownArg>(res) ? parse_iter<P+1>(state, out) : res;
+	}
+
+
+	// parses the remaining tokens of state, without the postconditions
+	const ParseResultVoid& parse_tokens(OwnedParserState& state,
+			Results<ArgParsers...>& out) const {
+
+		state.counts = out.counts.data();
+		state.count_size = arg_count;
+
+		while (state.pos < state.argv.size()) {
+			out.res = parse_iter<0>(state, out);
+
+			if (is<UnknownArg>(out.res))
+				suggest(out.res.template get<UnknownArg>(), BuildIndices<N>());
+
+			if (!out.res.is_ok())
+				break;
+		}
+
+		return out.res;
+	}
+
+	template <std::size_t... Ps>
+	void suggest(UnknownArg& err, Indices<Ps...>) const {
+		args::suggest(err, std::get<Ps>(arg_parsers)...);
+	}
+
+	const ParseResultVoid& parse_state(OwnedParserState& state,
+			Results<ArgParsers...>& out) const {
+
+		ARGS_TIME_PARSE();
+
+		out.clear(&arg_parsers, arg_count);
+
+		if (!parse_tokens(state, out).is_ok())
+			return out.res;
+
+		out.res = eval_postcond_iter<0>(state);
+		return out.res;
+	}
+
+	// whether a parse starting at argv[k] begins with a new argument, given
+	// that no argument consumes more than max_arity tokens after a flag and
+	// only one otherwise (see Arg::bounded_tokens)
+	static bool chunk_boundary(const ParserState& state, std::size_t k) {
+		std::size_t window = k < max_arity ? k : max_arity;
+
+		for (std::size_t t = k - window; t < k; t++) {
+			if (state.classes[t] != TokenClass::Positional)
+				return false;
+		}
+
+		return true;
+	}
+
+	template <std::size_t P>
+	If<P == N> eval_postcond_iter(const ParserState&) const {
+		return success();
+	}
+
+	template <std::size_t P>
+	If<P < N> eval_postcond_iter(const ParserState& state) const {
+		auto res = std::get<P>(arg_parsers).eval_postcond(state);
+
+		return res.is_ok() ? eval_postcond_iter<P+1>(state) : res;
+	}
+
+public:
+	// whether argv can be split and parsed in parallel (see parse below)
+	static constexpr bool chunkable = ParsersChunkTraits<ArgParsers...>::chunkable;
+
+	static constexpr std::size_t max_arity = ParsersChunkTraits<ArgParsers...>::max_arity;
+
+	explicit Schema(ArgParsers... arg_parsers)
+		: arg_parsers(std::move(arg_parsers)...) {
+
+		assign_ids(BuildIndices<N>());
+	}
+
+	uint size() const {
+		return arg_count;
+	}
+
+
+	const std::tuple<ArgParsers...>& parsers() const {
+		return arg_parsers;
+	}
+
+
+	// marks parses into warm buffers as allocation-free: in builds with
+	// ARGS_ALLOC_AUDIT (see AllocAudit), a successful parse into Results that
+	// were already parsed into, with a reused state, reports its allocations
+	// and aborts, so that a test fails. The first parse into out sizes the
+	// buffers and isn't checked, nor are failed parses (messages allocate)
+	Schema& allocation_free(bool on = true) & {
+		alloc_free = on;
+		return *this;
+	}
+
+	Schema&& allocation_free(bool on = true) && {
+		alloc_free = on;
+		return std::move(*this);
+	}
+
+	bool is_allocation_free() const {
+		return alloc_free;
+	}
+
+
+	// parses into out, reusing its storage and the one of state
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out, OwnedParserState& state) const {
+
+		if (!alloc_free || !out.arg_parsers || !AllocAudit::enabled()) {
+			state.assign(argv_begin, argv_end);
+			return parse_state(state, out);
+		}
+
+		AllocAudit audit;
+
+		state.assign(argv_begin, argv_end);
+		parse_state(state, out);
+
+		audit.stop();
+
+		if (audit.count() != 0 && out.res.is_ok()) {
+			std::cerr << "allocation in a parse with an allocation-free schema: ";
+			audit.report(std::cerr);
+			std::abort();
+		}
+
+		return out.res;
+	}
+
+	// Parses a very long argv into out using all the threads of the pool. argv
+	// is cut into chunks of at least min_chunk_tokens tokens where no argument
+	// can span two chunks, the chunks are parsed independently and their
+	// results are concatenated before evaluating the postconditions. This needs
+	// stateless preconditions and arguments that consume a bounded number of
+	// tokens (see chunkable), otherwise it's the same as the serial parse.
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out, ThreadPool& pool,
+			std::size_t min_chunk_tokens = 1 << 14) const {
+
+		OwnedParserState state(argv_begin, argv_end);
+		const auto& argv = state.argv;
+
+		std::size_t chunk_count = std::min(pool.size(),
+				argv.size() / std::max<std::size_t>(min_chunk_tokens, 1));
+
+		if (!chunkable || chunk_count < 2)
+			return parse_state(state, out);
+
+		ARGS_TIME_PARSE();
+
+		std::vector<std::size_t> bounds { 0 };
+
+		for (std::size_t c = 1; c < chunk_count; c++) {
+			std::size_t k = std::max(c * argv.size() / chunk_count, bounds.back() + 1);
+
+			while (k < argv.size() && !chunk_boundary(state, k))
+				k++;
+
+			if (k < argv.size())
+				bounds.push_back(k);
+		}
+
+		bounds.push_back(argv.size());
+		chunk_count = bounds.size() - 1;
+
+		std::vector<Results<ArgParsers...>> chunks(chunk_count);
+		std::vector<OwnedParserState> chunk_states(chunk_count);
+
+		pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+			auto& chunk_state = chunk_states[c];
+
+			chunk_state.assign(begin(argv) + bounds[c], begin(argv) + bounds[c+1]);
+			chunk_state.end_of_flags = state.end_of_flags_pos < bounds[c];
+			chunk_state.owned_matched_args.keep_positions(
+					state.owned_matched_args.keeps_positions());
+
+			chunks[c].clear(&arg_parsers, arg_count);
+			parse_tokens(chunk_state, chunks[c]);
+		});
+
+		out.clear(&arg_parsers, arg_count);
+
+		std::vector<std::vector<std::size_t>> bases(chunk_count);
+
+		for (std::size_t c = 0; c < chunk_count; c++) {
+			if (!chunks[c].res.is_ok()) {
+				out.res = std::move(chunks[c].res);
+				return out.res;
+			}
+
+			for (uint i = 0; i < arg_count; i++)
+				out.counts[i] += chunks[c].counts[i];
+
+			state.owned_matched_args.append(chunk_states[c].owned_matched_args, bounds[c]);
+
+			ChunkSizeValues size_values { bases[c] };
+			zip_nested(size_values, chunks[c].values, out.values);
+		}
+
+		pool.run(chunk_count, [&](std::size_t, std::size_t c) {
+			ChunkMoveValues move_values { bases[c] };
+			zip_nested(move_values, chunks[c].values, out.values);
+		});
+
+		state.pos = argv.size();
+		state.end_of_flags = chunk_states.back().end_of_flags;
+		state.counts = out.counts.data();
+		state.count_size = arg_count;
+
+		out.res = eval_postcond_iter<0>(state);
+		return out.res;
+	}
+
+	// parses into out, reusing its storage
+	template <typename InputIt>
+	const ParseResultVoid& parse(InputIt argv_begin, InputIt argv_end,
+			Results<ArgParsers...>& out) const {
+
+		OwnedParserState state;
+		return parse(argv_begin, argv_end, out, state);
+	}
+
+	template <typename InputIt>
+	Results<ArgParsers...> parse(InputIt argv_begin, InputIt argv_end) const {
+		Results<ArgParsers...> out;
+		parse(argv_begin, argv_end, out);
+		return out;
+	}
+};
+
+
+template <typename... ArgParsers>
+Schema<ArgParsers...> schema(const ArgParsers&... arg_parsers) {
+	return Schema<ArgParsers...>(arg_parsers...);
+}
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 #define ARGS_TYPES_H
 
 #include <limits>
+#include <tuple>
 #include <string>
 #include <vector>
 
@@ -44,8 +45,57 @@ template <bool cond, typename Ret = ParseResultVoid>
 using If = typename std::enable_if<cond, Ret>::type;
 
 
+// compile-time list of tuple indices, BuildIndices<N> is Indices<0, ..., N-1>
+template <std::size_t... Is>
+struct Indices {};
+
+template <std::size_t N, std::size_t... Is>
+struct BuildIndices : BuildIndices<N-1, N-1, Is...> {};
+
+template <std::size_t... Is>
+struct BuildIndices<0, Is...> : Indices<Is...> {};
+
+
+// calls f(a_i, b_i) for the elements of two tuples of the same size
+template <typename F, typename TupleA, typename TupleB, std::size_t... Is>
+void zip_each(F& f, TupleA& a, TupleB& b, Indices<Is...>) {
+	int expand[] = { 0, (f(std::get<Is>(a), std::get<Is>(b)), 0)... };
+	(void) expand;
+}
+
+// same as zip_each for tuples of tuples (one tuple per parser)
+template <typename F>
+struct ZipInner {
+	F& f;
+
+	template <typename TupleA, typename TupleB>
+	void operator() (TupleA& a, TupleB& b) {
+		zip_each(f, a, b, BuildIndices<std::tuple_size<TupleA>::value>());
+	}
+};
+
+template <typename F, typename TupleA, typename TupleB>
+void zip_nested(F& f, TupleA& a, TupleB& b) {
+	ZipInner<F> inner { f };
+	zip_each(inner, a, b, BuildIndices<std::tuple_size<TupleA>::value>());
+}
+
+
+// where the values of an argument come from, by increasing precedence
+enum class Origin : unsigned char {
+	None, Default, File, Env, Argv
+};
+
+
 struct BaseArg {
+	static constexpr uint no_id = std::numeric_limits<uint>::max();
+
 	uint multiplicity = 0;
+	Origin origin = Origin::None;
+
+	// position in the Schema that contains the argument (or in the parsers of
+	// its parse with ARGS_INSTRUMENT, see number_args)
+	uint id = no_id;
 
 	explicit operator bool() const {
 		return multiplicity > 0;
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_VALIDATION_H
+#define ARGS_VALIDATION_H
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/parser.hpp"
+
+#include "utils/thread_pool.hpp"
+
+
+namespace args {
+
+// Check of every result of an argument, run after the parse by a
+// ValidationStage. check is called as check(const A::value_type&) and returns
+// a ParseResultVoid; it may be called by several threads at once.
+template <typename A, typename F>
+struct Validator {
+	A& arg;
+	F check;
+};
+
+template <typename A, typename F>
+Validator<A, F> validate(A& arg, F check) {
+	return Validator<A, F> { arg, std::move(check) };
+}
+
+
+// Runs expensive checks of the parse results (e.g. whether paths exist) in a
+// separate stage, on a ThreadPool, instead of during the serial token walk.
+// Every result of every validated argument is one task. The errors are
+// reported in argv order when the positions of the matches are known (see
+// parse_validated), otherwise in the order of the validators and results.
+template <typename... Validators>
+class ValidationStage {
+	static constexpr std::size_t N = sizeof...(Validators);
+
+	struct Failure {
+		uint pos;
+		std::size_t task;
+	};
+
+	std::tuple<Validators...> validators;
+
+	// first task of every validator, and the total at the end
+	std::vector<std::size_t> offsets;
+
+	// result of every task of the last run, and argv position of every task
+	std::vector<ParseError> task_errors;
+	std::vector<uint> task_pos;
+
+	std::vector<ParseError> failures;
+
+
+	template <std::size_t I>
+	If<I == N, void> count_tasks() {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> count_tasks() {
+		offsets[I+1] = offsets[I] + std::get<I>(validators).arg.result.size();
+		count_tasks<I+1>();
+	}
+
+	template <std::size_t I>
+	If<I == N, void> find_positions(const MatchLog&) {
+	}
+
+	// the k-th result of an argument comes from its k-th match
+	template <std::size_t I>
+	If<I < N, void> find_positions(const MatchLog& matched) {
+		const BaseArg* arg = &std::get<I>(validators).arg;
+		std::size_t task = offsets[I];
+		std::size_t i = 0;
+
+		for (const BaseArg* m : matched) {
+			if (m == arg && task < offsets[I+1])
+				task_pos[task++] = matched.position(i);
+
+			i++;
+		}
+
+		find_positions<I+1>(matched);
+	}
+
+	template <std::size_t I>
+	If<I == N, void> run_task(std::size_t) {
+	}
+
+	template <std::size_t I>
+	If<I < N, void> run_task(std::size_t task) {
+		if (task >= offsets[I+1])
+			return run_task<I+1>(task);
+
+		auto& validator = std::get<I>(validators);
+		auto& err = task_errors[task];
+
+		err = validator.check(validator.arg.result[task - offsets[I]]);
+
+		if (!err.is_ok())
+			err.set_arg(&validator.arg);
+	}
+
+public:
+	explicit ValidationStage(Validators... validators)
+		: validators(std::move(validators)...)
+		, offsets(N + 1, 0) {}
+
+
+	// validates the current results of the arguments. state is the state of
+	// the parse, to order the errors by argv position
+	ParseResultVoid run(ThreadPool& pool, const ParserState* state = nullptr) {
+		count_tasks<0>();
+
+		std::size_t task_count = offsets[N];
+
+		task_errors.assign(task_count, success());
+		task_pos.assign(task_count, MatchLog::no_pos);
+		failures.clear();
+
+		if (state && state->matched_args.keeps_positions())
+			find_positions<0>(state->matched_args);
+
+		pool.run(task_count, [this](std::size_t, std::size_t task) {
+			run_task<0>(task);
+		});
+
+		std::vector<Failure> failed;
+
+		for (std::size_t task = 0; task < task_count; task++) {
+			if (!task_errors[task].is_ok())
+				failed.push_back(Failure { task_pos[task], task });
+		}
+
+		// values from sources have no position and go last
+		std::stable_sort(begin(failed), end(failed), [](const Failure& a, const Failure& b) {
+			return a.pos < b.pos;
+		});
+
+		for (const auto& f : failed)
+			failures.push_back(std::move(task_errors[f.task]));
+
+		return failures.empty() ? success() : failures.front();
+	}
+
+	// every error of the last run, in order
+	const std::vector<ParseError>& errors() const {
+		return failures;
+	}
+};
+
+template <typename... Validators>
+ValidationStage<Validators...> validation(Validators... validators) {
+	return ValidationStage<Validators...>(std::move(validators)...);
+}
+
+
+// like parse, then runs stage on pool if the parse succeeded. The first
+// validation error in argv order is returned, stage.errors() has all of them
+template <typename Stage, typename InputIt, typename... ArgParsers>
+ParseResultVoid parse_validated(Stage& stage, ThreadPool& pool,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	OwnedParserState state(argv_begin, argv_end);
+	state.owned_matched_args.keep_positions(true);
+
+	auto res = parse_argv(state, arg_parsers...);
+
+	if (res.is_ok())
+		res = eval_postcond_iter(state, arg_parsers...);
+
+	return res.is_ok() ? stage.run(pool, &state) : res;
+}
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_VISITOR_H
+#define ARGS_VISITOR_H
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+#include "common/parser.hpp"
+
+
+namespace args {
+
+// Calls f with every value of arg, see visitor
+template <typename A, typename F>
+struct Handler {
+	using arg_type = A;
+
+	A& arg;
+	F f;
+};
+
+template <typename A, typename F>
+Handler<A, F> on(A& arg, F f) {
+	return Handler<A, F> { arg, std::move(f) };
+}
+
+
+// Hands the values of the arguments to their handlers as they are parsed,
+// instead of storing them in the arguments. Only the multiplicities, the
+// origins and the first match of every argument are kept (which is what the
+// conditions look at), so no memory is spent on the values. The parse still
+// copies argv into an OwnedParserState, a view and a token class per token.
+// Values of arguments without a handler are dropped.
+template <typename... Handlers>
+class Visitor {
+	static constexpr std::size_t N = sizeof...(Handlers);
+
+	std::tuple<Handlers...> handlers;
+
+
+	template <std::size_t J, typename A, typename T>
+	If<J == N, void> dispatch(A&, T&&) {
+	}
+
+	template <std::size_t J, typename A, typename T>
+	If<J < N, void> dispatch(A& arg, T&& value) {
+		using H = typename std::tuple_element<J, std::tuple<Handlers...>>::type;
+
+		if (!call_at(std::get<J>(handlers), arg, value, std::is_same<typename H::arg_type, A>()))
+			dispatch<J+1>(arg, std::forward<T>(value));
+	}
+
+	template <typename H, typename A, typename T>
+	static bool call_at(H& handler, const A& arg, T& value, std::true_type) {
+		if (&handler.arg != &arg)
+			return false;
+
+		handler.f(std::move(value));
+		return true;
+	}
+
+	template <typename H, typename A, typename T>
+	static bool call_at(H&, const A&, T&, std::false_type) {
+		return false;
+	}
+
+public:
+	explicit Visitor(Handlers... handlers)
+		: handlers(std::move(handlers)...) {}
+
+
+	// sink of ArgParser::parse
+	template <std::size_t I, typename A, typename T>
+	void push(A& arg, T&& value) {
+		arg.multiplicity++;
+		arg.origin = Origin::Argv;
+
+		dispatch<0>(arg, std::forward<T>(value));
+	}
+};
+
+
+template <typename... Handlers>
+Visitor<Handlers...> visitor(Handlers... handlers) {
+	return Visitor<Handlers...>(std::move(handlers)...);
+}
+
+
+template <typename... Handlers>
+ParseResultVoid parse_iter(OwnedParserState& state, Visitor<Handlers...>&) {
+	return ParseError(UnknownArg(state));
+}
+
+template <typename... Handlers, typename ArgParser, typename... ArgParsers>
+ParseResultVoid parse_iter(OwnedParserState& state, Visitor<Handlers...>& visitor,
+		ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+
+	auto res = arg_parser.parse(state, visitor);
+
+	return is<UnknownArg>(res)? parse_iter(state, visitor, arg_parsers...) : res;
+}
+
+
+// like parse, but the values are given to the handlers of visitor in argv
+// order as soon as they are parsed (so before the errors of later tokens and
+// the postconditions are found), and are not stored in the arguments:
+//
+//     auto res = args::parse(args::visitor(
+//             args::on(include_flag, [&](std::tuple<StrView> t) { ... }),
+//             args::on(file_arg, [&](std::string file) { ... })),
+//         argv+1, argv+argc, flag_parser, arg_parser);
+template <typename... Handlers, typename InputIt, typename... ArgParsers>
+ParseResultVoid
+parse(Visitor<Handlers...> visitor,
+		InputIt argv_begin, InputIt argv_end, ArgParsers&&... arg_parsers) {
+
+	ARGS_TIME_PARSE();
+
+	ARGS_NUMBER_ARGS(arg_parsers...);
+
+	OwnedParserState state(argv_begin, argv_end);
+	state.owned_matched_args.keep_runs(false);
+
+	while (state.pos < state.argv.size()) {
+		auto res = parse_iter(state, visitor, arg_parsers...);
+
+		if (is<UnknownArg>(res))
+			suggest(res.template get<UnknownArg>(), arg_parsers...);
+
+		if (!res.is_ok())
+			return res;
+	}
+
+	return eval_postcond_iter(state, arg_parsers...);
+}
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_DISPLAY_COMPLETE_H
+#define ARGS_DISPLAY_COMPLETE_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "utils/string_view.hpp"
+
+#include "common/types.hpp"
+#include "common/arg.hpp"
+#include "common/schema.hpp"
+
+
+namespace args {
+
+inline bool completion_less(const StrView& a, const StrView& b) {
+	return a < b;
+}
+
+inline bool completion_equal(const StrView& a, const StrView& b) {
+	return a == b;
+}
+
+template <typename ArgParser>
+void complete_names(StrView partial, std::vector<StrView>& out, const ArgParser& parser) {
+	auto range = parser.names().prefix_range(partial);
+	out.insert(end(out), range.first, range.second);
+}
+
+
+// appends the longopts and keywords of parsers starting with partial to out,
+// sorted and without duplicates
+template <typename... ArgParsers>
+void complete(StrView partial, std::vector<StrView>& out, const ArgParsers&... parsers) {
+	auto first = out.size();
+
+	int expand[] = { 0, (complete_names(partial, out, parsers), 0)... };
+	(void) expand;
+
+	if (sizeof...(ArgParsers) > 1) {
+		std::sort(begin(out) + first, end(out), completion_less);
+		out.erase(std::unique(begin(out) + first, end(out), completion_equal), end(out));
+	}
+}
+
+template <typename... ArgParsers, std::size_t... Ps>
+void complete_schema(StrView partial, std::vector<StrView>& out,
+		const Schema<ArgParsers...>& schema, Indices<Ps...>) {
+
+	complete(partial, out, std::get<Ps>(schema.parsers())...);
+}
+
+template <typename... ArgParsers>
+void complete(StrView partial, std::vector<StrView>& out, const Schema<ArgParsers...>& schema) {
+	complete_schema(partial, out, schema, BuildIndices<sizeof...(ArgParsers)>());
+}
+
+
+// Query mode for shell completion scripts: if argv[1] is "--complete", prints
+// the completions of argv[2] (everything if it's missing), one per line, and
+// returns true. Otherwise returns false and the program should parse argv.
+template <typename... ArgParsers>
+bool print_completions(int argc, const char* const* argv, std::ostream& o,
+		const ArgParsers&... parsers) {
+
+	if (argc < 2 || StrView(argv[1]) != "--complete")
+		return false;
+
+	std::vector<StrView> candidates;
+	complete(argc > 2 ? StrView(argv[2]) : StrView(), candidates, parsers...);
+
+	for (const auto& candidate : candidates)
+		o << candidate << '\n';
+
+	return true;
+}
+
+}
+
+#endif
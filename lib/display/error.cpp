@@ -4,7 +4,7 @@
 #include "common/parse_error.hpp"
 
 
-std::string err_arg_str(const args::BaseArg* arg) {
+static std::string err_arg_str(const args::BaseArg* arg) {
 	return arg
 		? arg->to_str() + " (" + std::to_string(arg->multiplicity) + ")"
 		: "(null)";
@@ -22,6 +22,9 @@ void args::report_error(const args::ParseError& err, std::ostream& o) {
 
 			o << "unknown argument: " << e.argv_element << "\n";
 
+			if (!e.suggestion.empty())
+				o << "  did you mean " << e.suggestion << "?\n";
+
 		} break;
 
 		case ParseError::index_of<BoundError>(): {
@@ -57,7 +60,7 @@ void args::report_error(const args::ParseError& err, std::ostream& o) {
 
 			o << "condition failed for " << err_arg_str(e.arg) << ":\n";
 
-			o << "  " << e.error_msg << "\n";
+			o << "  " << e.message() << "\n";
 
 		} break;
 
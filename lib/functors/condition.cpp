@@ -1,65 +1,54 @@
 #include "functors/condition.hpp"
 
-using namespace args;
-using namespace args::condition;
+namespace args {
+namespace condition {
 
 
 ParseResultVoid Requires::operator() (const BaseArg& self, const ParserState& s) const {
-	using namespace std;
-	auto& m = s.matched_args;
-
-	if (self.multiplicity == 0 || find(begin(m), end(m), &to_find) != end(m))
+	if (s.multiplicity(self) == 0 || s.matched_args.contains(to_find))
 		return success();
 	else
-		return cond_fail("Requires " + to_find.to_str());
+		return cond_fail("Requires", &to_find);
 }
 
 ParseResultVoid Conflicts::operator() (const BaseArg& self, const ParserState& s) const {
-	using namespace std;
-	auto& m = s.matched_args;
-
-	if (self.multiplicity == 0 || find(begin(m), end(m), &to_find) == end(m))
+	if (s.multiplicity(self) == 0 || !s.matched_args.contains(to_find))
 		return success();
 	else
-		return cond_fail("Conflicts " + to_find.to_str());
+		return cond_fail("Conflicts", &to_find);
 }
 
 
-ParseResultVoid Before::operator() (const BaseArg& self, const ParserState& s) const {
-	for (const BaseArg* matched : s.matched_args) {
-		if (matched == &to_find)
-			return cond_fail("Before " + to_find.to_str());
+// ids are ordered by first match, so these only look at the distinct arguments
 
-		if (matched == &self)
-			break;
-	}
+ParseResultVoid Before::operator() (const BaseArg& self, const ParserState& s) const {
+	if (s.matched_args.first_before(to_find, self))
+		return cond_fail("Before", &to_find);
 
 	return success();
 }
 
 ParseResultVoid After::operator() (const BaseArg& self, const ParserState& s) const {
-	for (const BaseArg* matched : s.matched_args) {
-		if (matched == &self)
-			return cond_fail("After " + to_find.to_str());
-
-		if (matched == &to_find)
-			break;
-	}
+	if (s.matched_args.first_before(self, to_find))
+		return cond_fail("After", &to_find);
 
 	return success();
 }
 
 
 ParseResultVoid Min::operator() (const BaseArg& self, const ParserState& s) const {
-	if (self.multiplicity >= min_multiplicity)
+	if (s.multiplicity(self) >= min_multiplicity)
 		return success();
 	else
-		return cond_fail("Min " + std::to_string(min_multiplicity));
+		return cond_fail("Min", min_multiplicity);
 }
 
 ParseResultVoid Max::operator() (const BaseArg& self, const ParserState& s) const {
-	if (self.multiplicity <= max_multiplicity)
+	if (s.multiplicity(self) <= max_multiplicity)
 		return success();
 	else
-		return cond_fail("Max " + std::to_string(max_multiplicity));
+		return cond_fail("Max", max_multiplicity);
+}
+
+}
 }
@@ -22,6 +22,7 @@
 
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 
 #include "common/types.hpp"
 #include "common/parse_error.hpp"
@@ -38,6 +39,15 @@ inline ParseResultVoid cond_fail(Str error_msg) {
 	return ParseError(CondFailed(std::move(error_msg)));
 }
 
+// failures whose message is only built when reported (see CondFailed)
+inline ParseResultVoid cond_fail(const char* condition, const BaseArg* other = nullptr) {
+	return ParseError(CondFailed::lazy(condition, other));
+}
+
+inline ParseResultVoid cond_fail(const char* condition, uint number) {
+	return ParseError(CondFailed::lazy(condition, number));
+}
+
 
 struct True {
 	ParseResultVoid operator() (const BaseArg& self, const ParserState& s) const {
@@ -87,7 +97,6 @@ struct All {
 template <typename... Predicates>
 struct Any {
 	std::tuple<Predicates...> predicates;
-	mutable std::vector<ParseError> errors;
 
 	static constexpr std::size_t N = sizeof...(Predicates);
 
@@ -96,32 +105,36 @@ struct Any {
 
 	template <typename Self>
 	ParseResultVoid operator() (const Self& self, const ParserState& s) const {
-		return eval_iter<Self, 0>(self, s);
+		std::vector<ParseError> errors;
+		return eval_iter<Self, 0>(self, s, errors);
 	}
 
 
 	template <typename Self, std::size_t I>
-	If<I == N> eval_iter(const Self& self, const ParserState& s) const {
-		std::ostringstream ss("Failed all conditions on " + self->to_str() + ":\n");
+	If<I == N> eval_iter(const Self& self, const ParserState& s,
+			std::vector<ParseError>& errors) const {
+
+		std::ostringstream ss;
+		ss << "Failed all conditions on " << self.to_str() << ":\n";
 
 		for (const auto& e : errors)
 			ss << e;
 
-		errors.clear();
 		return cond_fail(ss.str());
 	}
 
 	template <typename Self, std::size_t I>
-	If<I < N> eval_iter(const Self& self, const ParserState& s) const {
+	If<I < N> eval_iter(const Self& self, const ParserState& s,
+			std::vector<ParseError>& errors) const {
+
 		auto res = std::get<I>(predicates)(self, s);
 
 		if (res.is_ok()) {
-			errors.clear();
 			return success();
 		}
 		else {
 			errors.emplace_back(std::move(res));
-			return eval_iter<Self, I+1>();
+			return eval_iter<Self, I+1>(self, s, errors);
 		}
 	}
 };
@@ -178,6 +191,30 @@ struct Max {
 
 
 
+// Whether a condition gives the same result wherever it's evaluated, i.e. it
+// doesn't depend on the arguments parsed so far. If all preconditions are
+// stateless, parts of argv can be parsed independently (see Schema::parse)
+template <typename Cond>
+struct is_stateless : std::false_type {};
+
+template <>
+struct is_stateless<True> : std::true_type {};
+
+template <>
+struct is_stateless<False> : std::true_type {};
+
+template <>
+struct is_stateless<All<>> : std::true_type {};
+
+template <typename P, typename... Ps>
+struct is_stateless<All<P, Ps...>> : std::integral_constant<bool,
+	is_stateless<P>::value && is_stateless<All<Ps...>>::value> {};
+
+template <typename... Ps>
+struct is_stateless<Any<Ps...>> : is_stateless<All<Ps...>> {};
+
+
+
 // Constructor wrappers
 
 template <typename... Predicates>
@@ -0,0 +1,125 @@
+#include "sources/config_source.hpp"
+
+#include <cstring>
+
+namespace args {
+
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static StrView trim(StrView s) {
+	std::size_t b = 0, e = s.size();
+
+	while (b < e && is_blank(s[b]))
+		b++;
+
+	while (e > b && is_blank(s[e-1]))
+		e--;
+
+	return s.substr(b, e - b);
+}
+
+static StrView unquote(StrView s) {
+	bool quoted = s.size() >= 2
+		&& (s[0] == '"' || s[0] == '\'')
+		&& s[s.size()-1] == s[0];
+
+	return quoted ? s.substr(1, s.size() - 2) : s;
+}
+
+
+ConfigFile::ConfigFile(Str path)
+	: path(std::move(path))
+	, file(this->path.c_str()) {}
+
+
+ParseResultVoid ConfigFile::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	auto data = file.data();
+
+	StrView section;
+	Str full_key;
+	uint line_no = 0;
+
+	std::size_t pos = 0;
+
+	while (pos < data.size()) {
+		const char* nl = static_cast<const char*>(
+				std::memchr(data.c_str() + pos, '\n', data.size() - pos));
+
+		std::size_t line_end = nl ? nl - data.c_str() : data.size();
+
+		auto line = trim(data.substr(pos, line_end - pos));
+		pos = line_end + 1;
+		line_no++;
+
+		if (line.empty() || line[0] == '#' || line[0] == ';')
+			continue;
+
+		if (line[0] == '[') {
+			if (line[line.size()-1] != ']')
+				return ParseError(InvalidParam(
+					path + ":" + std::to_string(line_no) + ": expected ']'", line));
+
+			section = trim(line.substr(1, line.size() - 2));
+			continue;
+		}
+
+		const char* eq = static_cast<const char*>(
+				std::memchr(line.c_str(), '=', line.size()));
+
+		if (!eq)
+			return ParseError(InvalidParam(
+				path + ":" + std::to_string(line_no) + ": expected 'key = value'", line));
+
+		std::size_t eq_pos = eq - line.c_str();
+
+		auto key   = trim(line.substr(0, eq_pos));
+		auto value = unquote(trim(line.substr(eq_pos + 1)));
+
+		int slot;
+
+		if (section.empty()) {
+			slot = index.find(key);
+		} else {
+			full_key.assign(section.c_str(), section.size());
+			full_key += '.';
+			full_key.append(key.c_str(), key.size());
+
+			slot = index.find(full_key);
+		}
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), value });
+	}
+
+	return success();
+}
+
+
+ParseResultVoid Defaults::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	for (const auto& kv : key_values) {
+		int slot = index.find(kv.first);
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), kv.second });
+	}
+
+	return success();
+}
+
+
+ConfigFile config_file(Str path) {
+	return ConfigFile(std::move(path));
+}
+
+Defaults defaults(std::vector<std::pair<Str, Str>> key_values) {
+	return Defaults(std::move(key_values));
+}
+
+}
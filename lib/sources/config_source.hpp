@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_CONFIG_SOURCE_H
+#define ARGS_CONFIG_SOURCE_H
+
+#include <utility>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+
+#include "sources/source.hpp"
+
+#include "utils/mapped_file.hpp"
+
+
+namespace args {
+
+// Takes values from a memory-mapped configuration file made of `key = value`
+// lines and `[section]` headers, with `#` or `;` comments. Keys inside a
+// section are looked up as "section.key". Values are views into the mapping,
+// so the file must outlive the parse results that refer to it (e.g. errors).
+// A missing file is treated as an empty one, check is_open() if it matters.
+class ConfigFile {
+	Str path;
+	MappedFile file;
+
+public:
+	explicit ConfigFile(Str path);
+
+	bool is_open() const {
+		return file.is_open();
+	}
+
+	Origin origin() const {
+		return Origin::File;
+	}
+
+	Str index_key(StrView key) const {
+		return key.str();
+	}
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+// Default values given as strings, parsed like any other source
+class Defaults {
+	std::vector<std::pair<Str, Str>> key_values;
+
+public:
+	explicit Defaults(std::vector<std::pair<Str, Str>> key_values)
+		: key_values(std::move(key_values)) {}
+
+	Origin origin() const {
+		return Origin::Default;
+	}
+
+	Str index_key(StrView key) const {
+		return key.str();
+	}
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+ConfigFile config_file(Str path);
+
+Defaults defaults(std::vector<std::pair<Str, Str>> key_values);
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "sources/env_source.hpp"
+
+#include <cctype>
+
+extern char** environ;
+
+namespace args {
+
+
+EnvSource::EnvSource(Str prefix, const char* const* envp)
+	: prefix(std::move(prefix))
+	, envp(envp) {}
+
+
+Str EnvSource::index_key(StrView key) const {
+	Str name;
+	name.reserve(key.size());
+
+	for (char c : key) {
+		if (c == '-' || c == '.')
+			name += '_';
+		else
+			name += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	}
+
+	return name;
+}
+
+ParseResultVoid EnvSource::scan(const SourceIndex& index,
+		std::vector<SourceValue>& values) const {
+
+	for (auto env = envp; env && *env; env++) {
+		StrView var(*env);
+
+		if (!var.starts_with(prefix))
+			continue;
+
+		const char* eq = static_cast<const char*>(
+				std::memchr(var.c_str(), '=', var.size()));
+
+		if (!eq || eq < var.c_str() + prefix.size())
+			continue;
+
+		std::size_t name_end = eq - var.c_str();
+		auto name = var.substr(prefix.size(), name_end - prefix.size());
+
+		int slot = index.find(name);
+
+		if (slot != SourceIndex::not_found)
+			values.push_back({ static_cast<uint>(slot), var.substr(name_end + 1) });
+	}
+
+	return success();
+}
+
+
+EnvSource env_source(Str prefix) {
+	return EnvSource(std::move(prefix), environ);
+}
+
+EnvSource env_source(Str prefix, const char* const* envp) {
+	return EnvSource(std::move(prefix), envp);
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_ENV_SOURCE_H
+#define ARGS_ENV_SOURCE_H
+
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+
+#include "sources/source.hpp"
+
+
+namespace args {
+
+// Takes values from environment variables named after the source key of the
+// arguments: with prefix "TOOL_", --cache-dir is read from TOOL_CACHE_DIR.
+// The environment is scanned only once per parse.
+class EnvSource {
+	Str prefix;
+	const char* const* envp;
+
+public:
+	EnvSource(Str prefix, const char* const* envp);
+
+	Origin origin() const {
+		return Origin::Env;
+	}
+
+	Str index_key(StrView key) const;
+
+	ParseResultVoid scan(const SourceIndex& index, std::vector<SourceValue>& values) const;
+};
+
+
+EnvSource env_source(Str prefix);
+
+EnvSource env_source(Str prefix, const char* const* envp);
+
+}
+
+#endif
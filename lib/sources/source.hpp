@@ -0,0 +1,261 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_SOURCE_H
+#define ARGS_SOURCE_H
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/types.hpp"
+#include "common/parse_error.hpp"
+#include "common/parser_state.hpp"
+
+#include "args/flag/param_parsers.hpp"
+
+#include "utils/tokenizer.hpp"
+
+
+namespace args {
+
+// A value found by a source for the argument numbered `slot` (arguments are
+// numbered in declaration order across all the parsers)
+struct SourceValue {
+	uint slot;
+	StrView value;
+};
+
+
+// Sorted table of the source keys of all declared arguments
+class SourceIndex {
+	std::vector<std::pair<Str, uint>> entries;
+
+public:
+	static constexpr int not_found = -1;
+
+	void add(Str key, uint slot);
+
+	void sort();
+
+	int find(StrView key) const;
+
+	bool empty() const {
+		return entries.empty();
+	}
+};
+
+
+template <typename Source>
+struct SourceKeyCollector {
+	const Source& source;
+	SourceIndex& index;
+	uint slot = 0;
+
+	SourceKeyCollector(const Source& source, SourceIndex& index)
+		: source(source)
+		, index(index) {}
+
+	template <typename A>
+	void operator() (A& arg) {
+		if (!arg.source_key.empty())
+			index.add(source.index_key(arg.source_key), slot);
+
+		slot++;
+	}
+};
+
+
+// Feeds the values of a source to their arguments. Arguments that already
+// have been given (by argv or a source with a higher precedence) are skipped.
+class SourceApplier {
+	OwnedParserState& state;
+	Origin origin;
+	const std::vector<SourceValue>& values;
+	Argv tokens;
+
+	std::size_t next = 0;
+	uint slot = 0;
+
+
+	template <typename A>
+	ParseResultVoid apply(A& arg, StrView value) {
+		tokens.clear();
+
+		if (A::value_arity == 0) {
+			// flags without parameters are enabled by a boolean value
+			tokens.push_back(value);
+
+			ParserState bool_state(state.matched_args, tokens);
+			auto enabled = ParamParser<bool>::parse(bool_state);
+
+			if (!enabled.is_ok()) {
+				enabled.get_err().set_arg(&arg);
+				return enabled.get_err();
+			}
+
+			if (!enabled.get_ok())
+				return success();
+
+			tokens.clear();
+
+		} else if (A::value_arity == 1) {
+			tokens.push_back(value);
+
+		} else {
+			split_words(value, tokens);
+		}
+
+		ParserState value_state(state.matched_args, tokens);
+		value_state.resource = state.resource;
+
+		const auto& c_arg = arg;
+		auto res = arg.precond(c_arg, value_state);
+
+		if (res.is_ok())
+			res = arg.parse_value(value_state);
+
+		if (res.is_ok() && value_state.pos != tokens.size())
+			res = ParseError(InvalidParam("too many values", value));
+
+		if (res.is_ok()) {
+			arg.multiplicity++;
+			arg.origin = origin;
+			state.owned_matched_args.add(arg);
+		} else {
+			res.set_arg(&arg);
+		}
+
+		return res;
+	}
+
+public:
+	ParseResultVoid result = success();
+
+	SourceApplier(OwnedParserState& state, Origin origin,
+			const std::vector<SourceValue>& values)
+		: state(state)
+		, origin(origin)
+		, values(values) {}
+
+	template <typename A>
+	void operator() (A& arg) {
+		bool taken = arg.multiplicity > 0;
+
+		for (; next < values.size() && values[next].slot == slot; next++) {
+			if (result.is_ok() && !taken)
+				result = apply(arg, values[next].value);
+		}
+
+		slot++;
+	}
+};
+
+
+template <typename F>
+void for_each_arg(F&) {
+}
+
+template <typename F, typename ArgParser, typename... ArgParsers>
+void for_each_arg(F& f, ArgParser& arg_parser, ArgParsers&... arg_parsers) {
+	arg_parser.for_each_arg(f);
+	for_each_arg(f, arg_parsers...);
+}
+
+
+// Looks up the keys of every argument in the source and parses the values
+// that were found. Values keep the order of the source for every argument.
+template <typename Source, typename... ArgParsers>
+ParseResultVoid apply_source(const Source& source,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	SourceIndex index;
+	SourceKeyCollector<Source> collector(source, index);
+	for_each_arg(collector, arg_parsers...);
+
+	if (index.empty())
+		return success();
+
+	index.sort();
+
+	std::vector<SourceValue> values;
+	auto res = source.scan(index, values);
+
+	if (!res.is_ok())
+		return res;
+
+	std::stable_sort(begin(values), end(values),
+		[](const SourceValue& lhs, const SourceValue& rhs) {
+			return lhs.slot < rhs.slot;
+		});
+
+	SourceApplier applier(state, source.origin(), values);
+	for_each_arg(applier, arg_parsers...);
+
+	return applier.result;
+}
+
+
+// Sources ordered by decreasing precedence. Every source only fills the
+// arguments that were not given by argv or the previous ones, so values that
+// would be overridden are never parsed.
+template <typename... Sources>
+struct Layers {
+	static constexpr std::size_t N = sizeof...(Sources);
+
+	std::tuple<Sources...> sources;
+
+	explicit Layers(Sources... sources) : sources(std::move(sources)...) {}
+};
+
+
+template <std::size_t I, typename... Sources, typename... ArgParsers>
+If<I == sizeof...(Sources)> apply_layers_iter(const Layers<Sources...>&,
+		OwnedParserState&, ArgParsers&...) {
+	return success();
+}
+
+template <std::size_t I, typename... Sources, typename... ArgParsers>
+If<I < sizeof...(Sources)> apply_layers_iter(const Layers<Sources...>& layers,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	auto res = apply_source(std::get<I>(layers.sources), state, arg_parsers...);
+
+	return res.is_ok()
+		? apply_layers_iter<I+1>(layers, state, arg_parsers...)
+		: res;
+}
+
+template <typename... Sources, typename... ArgParsers>
+ParseResultVoid apply_source(const Layers<Sources...>& layers,
+		OwnedParserState& state, ArgParsers&... arg_parsers) {
+
+	return apply_layers_iter<0>(layers, state, arg_parsers...);
+}
+
+
+template <typename... Sources>
+Layers<Sources...> layers(Sources... sources) {
+	return Layers<Sources...>(std::move(sources)...);
+}
+
+}
+
+#endif
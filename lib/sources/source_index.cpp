@@ -0,0 +1,26 @@
+#include "sources/source.hpp"
+
+namespace args {
+
+
+void SourceIndex::add(Str key, uint slot) {
+	entries.emplace_back(std::move(key), slot);
+}
+
+void SourceIndex::sort() {
+	std::sort(begin(entries), end(entries));
+}
+
+int SourceIndex::find(StrView key) const {
+	auto i = std::lower_bound(begin(entries), end(entries), key,
+		[](const std::pair<Str, uint>& entry, const StrView& key) {
+			return StrView(entry.first) < key;
+		});
+
+	if (i != end(entries) && StrView(i->first) == key)
+		return static_cast<int>(i->second);
+	else
+		return not_found;
+}
+
+}
@@ -0,0 +1,201 @@
+#include "utils/alloc_audit.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#include <execinfo.h>
+
+namespace args {
+
+
+constexpr std::size_t AllocAudit::max_recorded;
+constexpr std::size_t AllocAudit::max_frames;
+
+
+// audit of the current thread, null if none
+static thread_local AllocAudit* current_audit = nullptr;
+
+
+bool AllocAudit::enabled() {
+#ifdef ARGS_ALLOC_AUDIT
+	return true;
+#else
+	return false;
+#endif
+}
+
+AllocAudit::AllocAudit()
+	: previous(current_audit) {
+
+	current_audit = this;
+}
+
+AllocAudit::~AllocAudit() {
+	stop();
+}
+
+void AllocAudit::stop() {
+	if (active) {
+		current_audit = previous;
+		active = false;
+	}
+}
+
+AllocExempt::AllocExempt()
+	: audit(current_audit) {
+
+	current_audit = nullptr;
+}
+
+AllocExempt::~AllocExempt() {
+	current_audit = audit;
+}
+
+void AllocAudit::record(std::size_t size) {
+	// backtrace() may allocate the first time it's called
+	if (recording)
+		return;
+
+	recording = true;
+
+	if (total < max_recorded) {
+		auto& allocation = recorded[total];
+		allocation.size = size;
+		allocation.frame_count = backtrace(allocation.frames, max_frames);
+	}
+
+	total++;
+	total_bytes += size;
+
+	recording = false;
+}
+
+void AllocAudit::report(std::ostream& o) const {
+	o << total << " allocations (" << total_bytes << " bytes)\n";
+
+	for (const auto& allocation : *this) {
+		o << "  " << allocation.size << " bytes at:\n";
+
+		// the first frames are record() and the allocation function
+		char** symbols = backtrace_symbols(allocation.frames, allocation.frame_count);
+
+		for (int i = 2; i < allocation.frame_count; i++) {
+			o << "    ";
+
+			if (symbols)
+				o << symbols[i] << '\n';
+			else
+				o << allocation.frames[i] << '\n';
+		}
+
+		std::free(symbols);
+	}
+
+	if (total > max_recorded)
+		o << "  (" << total - max_recorded << " more)\n";
+}
+
+
+}
+
+
+#ifdef ARGS_ALLOC_AUDIT
+
+#ifdef __GLIBC__
+
+// malloc, calloc and realloc are replaced too, forwarding to glibc's own
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* p, std::size_t size);
+
+static void* raw_alloc(std::size_t size) {
+	return __libc_malloc(size);
+}
+
+extern "C" void* malloc(std::size_t size) {
+	void* p = __libc_malloc(size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) {
+	void* p = __libc_calloc(count, size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(count * size);
+
+	return p;
+}
+
+extern "C" void* realloc(void* old, std::size_t size) {
+	void* p = __libc_realloc(old, size);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+#else
+
+static void* raw_alloc(std::size_t size) {
+	return std::malloc(size);
+}
+
+#endif
+
+static void* audited_alloc(std::size_t size) {
+	void* p = raw_alloc(size ? size : 1);
+
+	if (p && args::current_audit)
+		args::current_audit->record(size);
+
+	return p;
+}
+
+void* operator new(std::size_t size) {
+	void* p = audited_alloc(size);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	void* p = audited_alloc(size);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return audited_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return audited_alloc(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+#endif
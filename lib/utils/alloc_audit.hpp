@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_ALLOC_AUDIT_H
+#define ARGS_ALLOC_AUDIT_H
+
+#include <cstddef>
+#include <iostream>
+
+
+namespace args {
+
+// Records the allocations made with operator new by the calling thread while
+// it's alive, with their call stacks, e.g. to check that parsing with warm
+// buffers doesn't allocate. Allocations are only intercepted when the library
+// is built with ARGS_ALLOC_AUDIT (see enabled()), which replaces the global
+// operator new and delete, and with glibc malloc, calloc and realloc.
+class AllocAudit {
+public:
+	static constexpr std::size_t max_recorded = 64;
+	static constexpr std::size_t max_frames = 8;
+
+	struct Allocation {
+		std::size_t size;
+		void* frames[max_frames];
+		int frame_count;
+	};
+
+	// whether operator new is intercepted in this build
+	static bool enabled();
+
+	AllocAudit();
+	~AllocAudit();
+
+	AllocAudit(const AllocAudit&) = delete;
+	AllocAudit& operator= (const AllocAudit&) = delete;
+
+	// stops recording (also done by the destructor)
+	void stop();
+
+	// number of allocations, including the ones past max_recorded
+	std::size_t count() const {
+		return total;
+	}
+
+	std::size_t bytes() const {
+		return total_bytes;
+	}
+
+	// the first max_recorded allocations
+	const Allocation* begin() const {
+		return recorded;
+	}
+
+	const Allocation* end() const {
+		return recorded + (total < max_recorded ? total : max_recorded);
+	}
+
+	// writes every recorded allocation with its call stack
+	void report(std::ostream& o) const;
+
+	// called by operator new
+	void record(std::size_t size);
+
+private:
+	AllocAudit* previous;
+	bool active = true;
+	bool recording = false;
+
+	std::size_t total = 0;
+	std::size_t total_bytes = 0;
+	Allocation recorded[max_recorded];
+};
+
+
+// Leaves the allocations made by the calling thread while it's alive out of
+// its AllocAudit. Used by the parameter parsers around the data of values that
+// own it (e.g. strings longer than the small-string buffer), which grows with
+// the input whatever the buffers are
+class AllocExempt {
+	AllocAudit* audit;
+
+public:
+	AllocExempt();
+	~AllocExempt();
+
+	AllocExempt(const AllocExempt&) = delete;
+	AllocExempt& operator= (const AllocExempt&) = delete;
+};
+
+
+// runs f under an AllocAudit and writes its allocations to o. returns whether
+// f didn't allocate. buffers reused across calls (e.g. Results or a
+// ParseSession) should be warmed up by a first call outside of the audit
+template <typename F>
+bool allocation_free(F&& f, std::ostream& o = std::cerr) {
+	AllocAudit audit;
+	f();
+	audit.stop();
+
+	if (audit.count() != 0)
+		audit.report(o);
+
+	return audit.count() == 0;
+}
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "utils/file_watch.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace args {
+
+
+FileWatch::FileWatch(const Str& path) {
+	auto slash = path.rfind('/');
+
+	dir  = slash == Str::npos ? "." : path.substr(0, slash + 1);
+	name = slash == Str::npos ? path : path.substr(slash + 1);
+
+#ifdef __linux__
+	m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	// watching the directory also catches files replaced with rename()
+	if (m_fd >= 0 && ::inotify_add_watch(m_fd, dir.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+#endif
+}
+
+FileWatch::~FileWatch() {
+#ifdef __linux__
+	if (m_fd >= 0)
+		::close(m_fd);
+#endif
+}
+
+
+bool FileWatch::changed(int timeout_ms) {
+#ifdef __linux__
+	if (m_fd < 0)
+		return false;
+
+	pollfd p = { m_fd, POLLIN, 0 };
+
+	if (::poll(&p, 1, timeout_ms) <= 0)
+		return false;
+
+	alignas(inotify_event) char buf[4096];
+	bool found = false;
+	ssize_t len;
+
+	while ((len = ::read(m_fd, buf, sizeof buf)) > 0) {
+		for (char* i = buf; i < buf + len; ) {
+			auto ev = reinterpret_cast<const inotify_event*>(i);
+
+			if (ev->len > 0 && name == ev->name)
+				found = true;
+
+			i += sizeof(inotify_event) + ev->len;
+		}
+	}
+
+	return found;
+#else
+	(void) timeout_ms;
+	return false;
+#endif
+}
+
+}
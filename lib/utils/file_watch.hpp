@@ -0,0 +1,61 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_FILE_WATCH_H
+#define ARGS_FILE_WATCH_H
+
+#include "common/types.hpp"
+
+
+namespace args {
+
+// Notifies changes of a file (e.g. a config file to reload) with inotify.
+// Replacing the file by renaming another one over it is also reported.
+// Never reports anything on systems without inotify.
+class FileWatch {
+	int m_fd = -1;
+	Str dir;
+	Str name;
+
+public:
+	explicit FileWatch(const Str& path);
+
+	FileWatch(const FileWatch&) = delete;
+	FileWatch& operator= (const FileWatch&) = delete;
+
+	~FileWatch();
+
+
+	bool is_open() const {
+		return m_fd >= 0;
+	}
+
+	// can be polled for readability to integrate with an event loop
+	int fd() const {
+		return m_fd;
+	}
+
+	// waits up to timeout_ms milliseconds (-1 waits forever) and returns
+	// whether the file was changed
+	bool changed(int timeout_ms = 0);
+};
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_HASH_H
+#define ARGS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/string_view.hpp"
+
+
+namespace args {
+
+// 64-bit FNV-1a, for cache keys and fingerprints (not for untrusted input)
+class Fnv1a {
+	std::uint64_t h;
+
+public:
+	static constexpr std::uint64_t offset_basis = 14695981039346656037ull;
+	static constexpr std::uint64_t prime = 1099511628211ull;
+
+	explicit Fnv1a(std::uint64_t seed = offset_basis)
+		: h(seed) {}
+
+	Fnv1a& add(const void* data, std::size_t size) {
+		auto p = static_cast<const unsigned char*>(data);
+
+		for (std::size_t i = 0; i < size; i++) {
+			h ^= p[i];
+			h *= prime;
+		}
+
+		return *this;
+	}
+
+	// the size is hashed too, so that ("ab", "c") and ("a", "bc") differ
+	Fnv1a& add(const StrView& s) {
+		add_u64(s.size());
+		return add(s.c_str(), s.size());
+	}
+
+	Fnv1a& add_u64(std::uint64_t value) {
+		return add(&value, sizeof value);
+	}
+
+	std::uint64_t value() const {
+		return h;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include "utils/instrument.hpp"
+
+namespace args {
+namespace instrument {
+
+
+constexpr std::size_t LatencyHistogram::sub_buckets;
+constexpr std::size_t LatencyHistogram::bucket_count;
+constexpr std::size_t ParseStats::max_args;
+
+
+static unsigned msb(std::uint64_t value) {
+	return 63 - __builtin_clzll(value);
+}
+
+
+// values below 2 * sub_buckets are their own index. above, the value is
+// shifted so that its top 5 bits remain (16 to 31), and the index is made of
+// the shift (the power of two) and the 4 bits after the most significant one
+std::size_t LatencyHistogram::index(std::uint64_t value) {
+	if (value < 2 * sub_buckets)
+		return value;
+
+	unsigned shift = msb(value) - 4;
+	std::size_t top = value >> shift;
+
+	return (shift + 1) * sub_buckets + (top - sub_buckets);
+}
+
+std::uint64_t LatencyHistogram::lower_bound(std::size_t i) {
+	if (i < 2 * sub_buckets)
+		return i;
+
+	unsigned shift = i / sub_buckets - 1;
+	std::uint64_t top = sub_buckets + i % sub_buckets;
+
+	return top << shift;
+}
+
+std::uint64_t LatencyHistogram::count() const {
+	std::uint64_t total = 0;
+
+	for (const auto& bucket : buckets)
+		total += bucket.load(std::memory_order_relaxed);
+
+	return total;
+}
+
+std::uint64_t LatencyHistogram::percentile(double p) const {
+	std::uint64_t total = count();
+
+	if (total == 0)
+		return 0;
+
+	auto rank = static_cast<std::uint64_t>(p / 100 * (total - 1));
+	std::uint64_t seen = 0;
+
+	for (std::size_t i = 0; i < bucket_count; i++) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+
+		if (seen > rank)
+			return lower_bound(i);
+	}
+
+	return lower_bound(bucket_count - 1);
+}
+
+void LatencyHistogram::reset() {
+	for (auto& bucket : buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+
+void ParseStats::reset() {
+	for (auto* counter : { &parses, &match_attempts, &precond_evals, &state_clones,
+			&param_parses, &keyword_lookups, &postcond_evals, &result_allocations })
+		counter->store(0, std::memory_order_relaxed);
+
+	for (auto& phase : phase_cycles)
+		phase.store(0, std::memory_order_relaxed);
+
+	for (auto& cost : args) {
+		cost.attempts.store(0, std::memory_order_relaxed);
+		cost.matches.store(0, std::memory_order_relaxed);
+		cost.cycles.store(0, std::memory_order_relaxed);
+	}
+
+	parse_latency.reset();
+}
+
+void ParseStats::print(std::ostream& o) const {
+	static const char* const phase_names[] = { "parse", "match", "params", "postcond" };
+
+	auto line = [&](const char* name, std::uint64_t value) {
+		if (value != 0)
+			o << name << ' ' << value << '\n';
+	};
+
+	line("args_parses", parses);
+	line("args_match_attempts", match_attempts);
+	line("args_precond_evals", precond_evals);
+	line("args_state_clones", state_clones);
+	line("args_param_parses", param_parses);
+	line("args_keyword_lookups", keyword_lookups);
+	line("args_postcond_evals", postcond_evals);
+	line("args_result_allocations", result_allocations);
+
+	for (unsigned i = 0; i < static_cast<unsigned>(Phase::Count); i++) {
+		if (phase_cycles[i] != 0)
+			o << "args_phase_cycles{phase=\"" << phase_names[i] << "\"} " << phase_cycles[i] << '\n';
+	}
+
+	for (std::size_t id = 0; id < max_args; id++) {
+		const auto& cost = args[id];
+
+		if (cost.attempts == 0)
+			continue;
+
+		o << "args_arg_attempts{id=\"" << id << "\"} " << cost.attempts << '\n';
+		o << "args_arg_matches{id=\"" << id << "\"} " << cost.matches << '\n';
+		o << "args_arg_cycles{id=\"" << id << "\"} " << cost.cycles << '\n';
+	}
+
+	if (parse_latency.count() != 0) {
+		for (double p : { 50.0, 90.0, 99.0, 99.9 })
+			o << "args_parse_cycles{quantile=\"" << p / 100 << "\"} " << parse_latency.percentile(p) << '\n';
+
+		o << "args_parse_cycles_count " << parse_latency.count() << '\n';
+	}
+}
+
+
+ParseStats& stats() {
+	static ParseStats s;
+	return s;
+}
+
+}
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_INSTRUMENT_H
+#define ARGS_INSTRUMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+
+// Parse instrumentation. The counters, timers and histograms below are always
+// available, but the library only records into them when ARGS_INSTRUMENT is
+// defined (for the whole program, including libargs), otherwise the
+// instrumentation points compile to nothing.
+
+namespace args {
+namespace instrument {
+
+// cycle counter used by the timers (the TSC on x86, nanoseconds elsewhere)
+inline std::uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+enum class Phase : unsigned {
+	Parse,    // a whole parse, from argv to the last postcondition
+	Match,    // preconditions and parse_impl of the arguments tried
+	Params,   // ParamParsers of the flags that matched
+	Postcond, // postconditions
+	Count
+};
+
+
+// Histogram of positive values with a relative precision of 1/16: values
+// below 32 have their own bucket, the others fall in one of 16 buckets per
+// power of two (like HdrHistogram with 1 significant digit in base 2).
+// Recording is a single relaxed atomic increment.
+class LatencyHistogram {
+public:
+	static constexpr std::size_t sub_buckets = 16;
+	static constexpr std::size_t bucket_count = 61 * sub_buckets;
+
+	static std::size_t index(std::uint64_t value);
+
+	// smallest value that falls in bucket i
+	static std::uint64_t lower_bound(std::size_t i);
+
+	void record(std::uint64_t value) {
+		buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::uint64_t count() const;
+
+	// lower bound of the bucket of the p-th percentile (p in [0, 100])
+	std::uint64_t percentile(double p) const;
+
+	void reset();
+
+private:
+	std::atomic<std::uint64_t> buckets[bucket_count] = {};
+};
+
+
+// cost of one argument, attributed by BaseArg::id (given by a Schema, or by
+// ARGS_NUMBER_ARGS to the arguments of the other parses)
+struct ArgCost {
+	std::atomic<std::uint64_t> attempts { 0 };
+	std::atomic<std::uint64_t> matches { 0 };
+	std::atomic<std::uint64_t> cycles { 0 };
+};
+
+struct ParseStats {
+	// arguments with an id >= this share the last ArgCost
+	static constexpr std::size_t max_args = 256;
+
+	std::atomic<std::uint64_t> parses { 0 };
+	std::atomic<std::uint64_t> match_attempts { 0 };
+	std::atomic<std::uint64_t> precond_evals { 0 };
+	std::atomic<std::uint64_t> state_clones { 0 };
+	std::atomic<std::uint64_t> param_parses { 0 };
+	std::atomic<std::uint64_t> keyword_lookups { 0 };
+	std::atomic<std::uint64_t> postcond_evals { 0 };
+
+	// result vectors that had to grow to store a value
+	std::atomic<std::uint64_t> result_allocations { 0 };
+
+	std::atomic<std::uint64_t> phase_cycles[static_cast<unsigned>(Phase::Count)] = {};
+
+	ArgCost args[max_args];
+
+	// cycles per parse
+	LatencyHistogram parse_latency;
+
+
+	ArgCost& arg(std::size_t id) {
+		return args[id < max_args ? id : max_args - 1];
+	}
+
+	void reset();
+
+	// writes every non-zero statistic as "name value" lines
+	void print(std::ostream& o) const;
+};
+
+// the process-wide statistics
+ParseStats& stats();
+
+
+inline void count(std::atomic<std::uint64_t>& counter) {
+	counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// adds the cycles spent in its scope to a phase
+class PhaseTimer {
+	Phase phase;
+	std::uint64_t start;
+
+public:
+	explicit PhaseTimer(Phase phase)
+		: phase(phase)
+		, start(cycles()) {}
+
+	~PhaseTimer() {
+		stats().phase_cycles[static_cast<unsigned>(phase)]
+			.fetch_add(cycles() - start, std::memory_order_relaxed);
+	}
+};
+
+// times a whole parse: its phase, the latency histogram and the parse count
+class ParseTimer {
+	std::uint64_t start;
+
+public:
+	ParseTimer()
+		: start(cycles()) {}
+
+	~ParseTimer() {
+		auto& s = stats();
+		std::uint64_t elapsed = cycles() - start;
+
+		count(s.parses);
+		s.phase_cycles[static_cast<unsigned>(Phase::Parse)]
+			.fetch_add(elapsed, std::memory_order_relaxed);
+		s.parse_latency.record(elapsed);
+	}
+};
+
+// attributes the cycles spent in its scope to an argument
+class ArgTimer {
+	ArgCost& cost;
+	std::uint64_t start;
+
+public:
+	explicit ArgTimer(std::size_t id)
+		: cost(stats().arg(id))
+		, start(cycles()) {
+
+		count(cost.attempts);
+	}
+
+	~ArgTimer() {
+		cost.cycles.fetch_add(cycles() - start, std::memory_order_relaxed);
+	}
+};
+
+}
+}
+
+
+#ifdef ARGS_INSTRUMENT
+
+#define ARGS_COUNT(counter) \
+	::args::instrument::count(::args::instrument::stats().counter)
+
+#define ARGS_COUNT_IF(cond, counter) \
+	do { if (cond) ARGS_COUNT(counter); } while (0)
+
+#define ARGS_TIME_PHASE(phase) \
+	::args::instrument::PhaseTimer args_phase_timer(::args::instrument::Phase::phase)
+
+#define ARGS_TIME_PARSE() \
+	::args::instrument::ParseTimer args_parse_timer
+
+#define ARGS_TIME_ARG(id) \
+	::args::instrument::ArgTimer args_arg_timer(id)
+
+#define ARGS_COUNT_ARG_MATCH(id) \
+	::args::instrument::count(::args::instrument::stats().arg(id).matches)
+
+#define ARGS_NUMBER_ARGS(...) \
+	::args::number_args(__VA_ARGS__)
+
+#else
+
+#define ARGS_COUNT(counter) ((void) 0)
+#define ARGS_COUNT_IF(cond, counter) ((void) 0)
+#define ARGS_TIME_PHASE(phase) ((void) 0)
+#define ARGS_TIME_PARSE() ((void) 0)
+#define ARGS_TIME_ARG(id) ((void) 0)
+#define ARGS_COUNT_ARG_MATCH(id) ((void) 0)
+#define ARGS_NUMBER_ARGS(...) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#include "utils/mapped_file.hpp"
+
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace args {
+
+
+MappedFile::MappedFile(const char* path) {
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return;
+
+	struct stat st;
+
+	if (::fstat(fd, &st) == 0) {
+		m_size = static_cast<std::size_t>(st.st_size);
+
+		if (m_size == 0) {
+			m_open = true;
+
+		} else {
+			void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (p != MAP_FAILED) {
+				m_data = static_cast<const char*>(p);
+				m_open = true;
+			} else {
+				m_size = 0;
+			}
+		}
+	}
+
+	::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+	: m_data(other.m_data)
+	, m_size(other.m_size)
+	, m_open(other.m_open) {
+
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_open = false;
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& other) {
+	if (this != &other) {
+		close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_open, other.m_open);
+	}
+
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+void MappedFile::close() {
+	if (m_data)
+		::munmap(const_cast<char*>(m_data), m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_MAPPED_FILE_H
+#define ARGS_MAPPED_FILE_H
+
+#include <cstddef>
+
+#include "utils/string_view.hpp"
+
+
+namespace args {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+	const char* m_data = nullptr;
+	std::size_t m_size = 0;
+	bool m_open = false;
+
+public:
+	MappedFile() = default;
+
+	explicit MappedFile(const char* path);
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator= (MappedFile&& other);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator= (const MappedFile&) = delete;
+
+	~MappedFile();
+
+
+	bool is_open() const {
+		return m_open;
+	}
+
+	StrView data() const {
+		return StrView(m_data ? m_data : "", m_size);
+	}
+
+	void close();
+};
+
+}
+
+#endif
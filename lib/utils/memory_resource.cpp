@@ -0,0 +1,105 @@
+#include "utils/memory_resource.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace args {
+
+
+namespace {
+
+class NewDeleteResource : public MemoryResource {
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t) override {
+		return ::operator new(bytes);
+	}
+
+	void do_deallocate(void* p, std::size_t, std::size_t) override {
+		::operator delete(p);
+	}
+};
+
+class NullResource : public MemoryResource {
+protected:
+	void* do_allocate(std::size_t, std::size_t) override {
+		throw std::bad_alloc();
+	}
+
+	void do_deallocate(void*, std::size_t, std::size_t) override {
+	}
+};
+
+}
+
+
+MemoryResource* new_delete_resource() {
+	static NewDeleteResource res;
+	return &res;
+}
+
+MemoryResource* null_resource() {
+	static NullResource res;
+	return &res;
+}
+
+
+MonotonicBuffer::MonotonicBuffer(void* buffer, std::size_t size, MemoryResource* upstream)
+	: initial_buffer(static_cast<char*>(buffer))
+	, initial_size(size)
+	, current(initial_buffer)
+	, remaining(size)
+	, next_chunk_size(std::max<std::size_t>(size, 1024))
+	, upstream(upstream) {}
+
+MonotonicBuffer::MonotonicBuffer(std::size_t initial_chunk_size, MemoryResource* upstream)
+	: initial_buffer(nullptr)
+	, initial_size(0)
+	, current(nullptr)
+	, remaining(0)
+	, next_chunk_size(std::max<std::size_t>(initial_chunk_size, 64))
+	, upstream(upstream) {}
+
+MonotonicBuffer::~MonotonicBuffer() {
+	release();
+}
+
+void MonotonicBuffer::release() {
+	while (chunks) {
+		Chunk* previous = chunks->previous;
+		upstream->deallocate(chunks, chunks->size);
+		chunks = previous;
+	}
+
+	current = initial_buffer;
+	remaining = initial_size;
+}
+
+void* MonotonicBuffer::do_allocate(std::size_t bytes, std::size_t align) {
+	auto addr = reinterpret_cast<std::uintptr_t>(current);
+	std::size_t padding = (align - addr % align) % align;
+
+	if (!current || padding + bytes > remaining) {
+		// the chunk header is followed by its memory
+		std::size_t size = std::max(next_chunk_size, sizeof(Chunk) + align + bytes);
+
+		auto chunk = static_cast<Chunk*>(upstream->allocate(size));
+		chunk->previous = chunks;
+		chunk->size = size;
+		chunks = chunk;
+
+		current = reinterpret_cast<char*>(chunk + 1);
+		remaining = size - sizeof(Chunk);
+		next_chunk_size = size * 2;
+
+		addr = reinterpret_cast<std::uintptr_t>(current);
+		padding = (align - addr % align) % align;
+	}
+
+	char* p = current + padding;
+	current = p + bytes;
+	remaining -= padding + bytes;
+
+	return p;
+}
+
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_MEMORY_RESOURCE_H
+#define ARGS_MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+namespace args {
+
+// Source of memory for the storage owned by the parser (argv views, matched
+// arguments, results), modeled after std::pmr::memory_resource.
+class MemoryResource {
+public:
+	virtual ~MemoryResource() = default;
+
+	void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+		return do_allocate(bytes, align);
+	}
+
+	void deallocate(void* p, std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+		do_deallocate(p, bytes, align);
+	}
+
+protected:
+	virtual void* do_allocate(std::size_t bytes, std::size_t align) = 0;
+
+	virtual void do_deallocate(void* p, std::size_t bytes, std::size_t align) = 0;
+};
+
+// operator new and delete
+MemoryResource* new_delete_resource();
+
+// throws std::bad_alloc on every allocation, e.g. as the upstream of a
+// MonotonicBuffer over a fixed buffer
+MemoryResource* null_resource();
+
+
+// Hands out memory from a buffer by bumping a pointer, and gets more from
+// upstream when it's exhausted (in growing chunks). Deallocation does
+// nothing: everything is freed at once by release() or the destructor.
+// Not thread-safe.
+class MonotonicBuffer : public MemoryResource {
+	struct Chunk {
+		Chunk* previous;
+		std::size_t size;
+	};
+
+	char* initial_buffer;
+	std::size_t initial_size;
+
+	char* current;
+	std::size_t remaining;
+	std::size_t next_chunk_size;
+
+	Chunk* chunks = nullptr;
+	MemoryResource* upstream;
+
+public:
+	// starts with buffer, which is not owned
+	MonotonicBuffer(void* buffer, std::size_t size,
+			MemoryResource* upstream = new_delete_resource());
+
+	explicit MonotonicBuffer(std::size_t initial_chunk_size = 1024,
+			MemoryResource* upstream = new_delete_resource());
+
+	MonotonicBuffer(const MonotonicBuffer&) = delete;
+	MonotonicBuffer& operator= (const MonotonicBuffer&) = delete;
+
+	~MonotonicBuffer();
+
+	// frees everything allocated so far. the storage that used it must not be
+	// used anymore
+	void release();
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t align) override;
+
+	void do_deallocate(void*, std::size_t, std::size_t) override {
+	}
+};
+
+
+// Allocator that uses a MemoryResource (new_delete_resource() by default).
+// Unlike std::pmr::polymorphic_allocator, the resource is propagated on move
+// assignment and swap, so assigning a container built with another resource
+// (see ArgState::use_resource) switches the storage to that resource.
+template <typename T>
+class PolyAllocator {
+	MemoryResource* res;
+
+	template <typename U>
+	friend class PolyAllocator;
+
+public:
+	using value_type = T;
+
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	PolyAllocator()
+		: res(new_delete_resource()) {}
+
+	PolyAllocator(MemoryResource* res)
+		: res(res) {}
+
+	template <typename U>
+	PolyAllocator(const PolyAllocator<U>& other)
+		: res(other.res) {}
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(res->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		res->deallocate(p, n * sizeof(T), alignof(T));
+	}
+
+	MemoryResource* resource() const {
+		return res;
+	}
+
+	template <typename U>
+	bool operator== (const PolyAllocator<U>& other) const {
+		return res == other.res;
+	}
+
+	template <typename U>
+	bool operator!= (const PolyAllocator<U>& other) const {
+		return res != other.res;
+	}
+};
+
+
+template <typename T>
+using PolyVector = std::vector<T, PolyAllocator<T>>;
+
+using PolyString = std::basic_string<char, std::char_traits<char>, PolyAllocator<char>>;
+
+
+// Moves the storage that a parsed value allocated from a resource to res (see
+// ArgState::move_results_to). Only PolyString values own such storage
+template <typename T>
+void rebind_value(T&, MemoryResource*) {
+}
+
+inline void rebind_value(PolyString& value, MemoryResource* res) {
+	PolyString copy(value.data(), value.size(), PolyAllocator<char>(res));
+	value.swap(copy);
+}
+
+template <std::size_t I, typename... Ts>
+typename std::enable_if<I == sizeof...(Ts)>::type
+rebind_tuple(std::tuple<Ts...>&, MemoryResource*) {
+}
+
+template <std::size_t I, typename... Ts>
+typename std::enable_if<I < sizeof...(Ts)>::type
+rebind_tuple(std::tuple<Ts...>& value, MemoryResource* res) {
+	rebind_value(std::get<I>(value), res);
+	rebind_tuple<I+1>(value, res);
+}
+
+template <typename... Ts>
+void rebind_value(std::tuple<Ts...>& value, MemoryResource* res) {
+	rebind_tuple<0>(value, res);
+}
+
+}
+
+#endif
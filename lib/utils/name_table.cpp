@@ -0,0 +1,129 @@
+#include "utils/name_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace args {
+
+
+static bool name_less(const StrView& a, const StrView& b) {
+	return a < b;
+}
+
+static bool name_equal(const StrView& a, const StrView& b) {
+	return a == b;
+}
+
+
+void NameTable::add(StrView name) {
+	if (!name.empty())
+		names.push_back(name);
+}
+
+void NameTable::sort() {
+	std::sort(names.begin(), names.end(), name_less);
+	names.erase(std::unique(names.begin(), names.end(), name_equal), names.end());
+}
+
+std::pair<NameTable::const_iterator, NameTable::const_iterator>
+NameTable::prefix_range(StrView prefix) const {
+	auto first = std::lower_bound(names.begin(), names.end(), prefix, name_less);
+
+	auto last = std::partition_point(first, names.end(),
+		[&](const StrView& name) {
+			return name.starts_with(prefix);
+		});
+
+	return { first, last };
+}
+
+StrView NameTable::resolve(StrView prefix) const {
+	auto i = std::lower_bound(names.begin(), names.end(), prefix, name_less);
+
+	if (i == names.end() || !i->starts_with(prefix))
+		return StrView();
+
+	if (i->size() == prefix.size())
+		return *i;
+
+	auto next = i + 1;
+
+	if (next != names.end() && next->starts_with(prefix))
+		return StrView();
+
+	return *i;
+}
+
+
+NameSuggester::NameSuggester(StrView token)
+	: token_size(token.size() <= 64 ? token.size() : 0)
+	, best_distance(std::max<std::size_t>(1, token.size() / 3) + 1) {
+
+	std::memset(char_masks, 0, sizeof(char_masks));
+
+	for (std::size_t i = 0; i < token_size; i++)
+		char_masks[static_cast<unsigned char>(token[i])] |= std::uint64_t(1) << i;
+}
+
+void NameSuggester::add(const NameTable& names) {
+	if (token_size == 0)
+		return;
+
+	for (const auto& name : names) {
+		std::size_t diff = name.size() > token_size
+			? name.size() - token_size
+			: token_size - name.size();
+
+		if (diff >= best_distance)
+			continue;
+
+		std::size_t d = distance(name, best_distance);
+
+		if (d < best_distance) {
+			best_distance = d;
+			best = name;
+		}
+	}
+}
+
+// Levenshtein distance between the token and name, with Hyyrö's formulation
+// of Myers' algorithm: bit i of pv/mv tells whether the distance between the
+// first i+1 characters of the token and the prefix of name grows/shrinks by
+// one from row i to row i+1. Stops early once the result can't be < bound.
+std::size_t NameSuggester::distance(StrView name, std::size_t bound) const {
+	const std::uint64_t high = std::uint64_t(1) << (token_size - 1);
+
+	std::uint64_t pv = token_size == 64 ? ~std::uint64_t(0) : (high << 1) - 1;
+	std::uint64_t mv = 0;
+	std::size_t score = token_size;
+
+	for (std::size_t j = 0; j < name.size(); j++) {
+		std::uint64_t eq = char_masks[static_cast<unsigned char>(name[j])];
+
+		std::uint64_t xv = eq | mv;
+		std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+
+		std::uint64_t ph = mv | ~(xh | pv);
+		std::uint64_t mh = pv & xh;
+
+		if (ph & high)
+			score++;
+		else if (mh & high)
+			score--;
+
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		std::size_t remaining = name.size() - j - 1;
+
+		if (score >= bound + remaining)
+			return score - remaining;
+	}
+
+	return score;
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_NAME_TABLE_H
+#define ARGS_NAME_TABLE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "utils/string_view.hpp"
+
+
+namespace args {
+
+// Sorted set of the names that select arguments on the command line (longopts,
+// keywords), used to resolve abbreviations and to complete partial tokens.
+// The table only holds views: the names must outlive it.
+class NameTable {
+	std::vector<StrView> names;
+
+public:
+	using const_iterator = std::vector<StrView>::const_iterator;
+
+	void add(StrView name);
+
+	// sorts the names and removes duplicates, must be called after adding
+	void sort();
+
+	std::size_t size() const {
+		return names.size();
+	}
+
+	const_iterator begin() const {
+		return names.begin();
+	}
+
+	const_iterator end() const {
+		return names.end();
+	}
+
+	// the names starting with prefix, in order
+	std::pair<const_iterator, const_iterator> prefix_range(StrView prefix) const;
+
+	// the name equal to prefix, or else the only name starting with it. empty
+	// if there is none or prefix is ambiguous
+	StrView resolve(StrView prefix) const;
+};
+
+
+// Finds the name closest to a token (e.g. an unknown argument) in one or more
+// NameTables, using Myers' bit-parallel edit distance: the token is encoded
+// once, then every name costs one pass of a few word operations per
+// character, without allocating. Names further than max(1, size/3) edits
+// away are not suggested, nor are any for tokens longer than 64 characters.
+class NameSuggester {
+	std::uint64_t char_masks[256];
+	std::size_t token_size;
+
+	std::size_t best_distance;
+	StrView best;
+
+	std::size_t distance(StrView name, std::size_t bound) const;
+
+public:
+	explicit NameSuggester(StrView token);
+
+	void add(const NameTable& names);
+
+	// the closest name, empty if none is close enough
+	StrView suggestion() const {
+		return best;
+	}
+};
+
+}
+
+#endif
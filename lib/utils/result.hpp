@@ -21,6 +21,7 @@
 #define ARGS_RESULT_H
 
 #include <algorithm>
+#include <new>
 #include <utility>
 
 
@@ -77,16 +78,16 @@ public:
 
 	Result(const Result& other) : type(other.type) {
 		if (is_ok())
-			ok_value = other.ok_value;
+			new (&ok_value) OkType(other.ok_value);
 		else
-			err_value = other.err_value;
+			new (&err_value) ErrType(other.err_value);
 	}
 
 	Result(Result&& other) : type(other.type) {
 		if (is_ok())
-			ok_value = std::move(other.ok_value);
+			new (&ok_value) OkType(std::move(other.ok_value));
 		else
-			err_value = std::move(other.err_value);
+			new (&err_value) ErrType(std::move(other.err_value));
 	}
 
 
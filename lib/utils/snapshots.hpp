@@ -0,0 +1,162 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_SNAPSHOTS_H
+#define ARGS_SNAPSHOTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "common/parse_error.hpp"
+
+
+namespace args {
+
+// Immutable values (e.g. a configuration built from parse results) that can be
+// replaced while other threads read them. Reading is a single atomic load.
+//
+// Old values are reclaimed RCU-style: every thread that reads registers a
+// Reader and calls quiescent() whenever it holds no reference to a value (e.g.
+// between requests). A replaced value is deleted once all readers have been
+// quiescent after the replacement.
+template <typename T>
+class Snapshots {
+public:
+	class Reader {
+		friend class Snapshots;
+
+		Snapshots& owner;
+		std::atomic<std::uint64_t> seen_epoch;
+
+	public:
+		explicit Reader(Snapshots& owner)
+			: owner(owner)
+			, seen_epoch(owner.epoch.load()) {
+
+			std::lock_guard<std::mutex> lock(owner.writer);
+			owner.readers.push_back(this);
+		}
+
+		Reader(const Reader&) = delete;
+		Reader& operator= (const Reader&) = delete;
+
+		~Reader() {
+			std::lock_guard<std::mutex> lock(owner.writer);
+			auto& r = owner.readers;
+			r.erase(std::find(begin(r), end(r), this));
+			owner.reclaim();
+		}
+
+		const T& get() const {
+			return owner.get();
+		}
+
+		void quiescent() {
+			seen_epoch.store(owner.epoch.load(), std::memory_order_release);
+		}
+	};
+
+
+	explicit Snapshots(T initial = T())
+		: current(new T(std::move(initial))) {}
+
+	Snapshots(const Snapshots&) = delete;
+	Snapshots& operator= (const Snapshots&) = delete;
+
+	~Snapshots() {
+		for (const auto& r : retired)
+			delete r.second;
+
+		delete current.load();
+	}
+
+
+	const T& get() const {
+		return *current.load(std::memory_order_acquire);
+	}
+
+	void publish(T value) {
+		std::lock_guard<std::mutex> lock(writer);
+		publish_locked(std::unique_ptr<T>(new T(std::move(value))));
+	}
+
+	// builds a fresh value with f(T&), which returns a ParseResultVoid
+	// (typically after reset() and parse()), and publishes it only on success.
+	// Reloads are serialized, readers are never blocked.
+	template <typename F>
+	ParseResultVoid reload(F&& f) {
+		std::lock_guard<std::mutex> lock(writer);
+
+		std::unique_ptr<T> fresh(new T());
+		ParseResultVoid res = f(*fresh);
+
+		if (res.is_ok())
+			publish_locked(std::move(fresh));
+
+		return res;
+	}
+
+	// deletes the replaced values that no reader can still see
+	void collect() {
+		std::lock_guard<std::mutex> lock(writer);
+		reclaim();
+	}
+
+private:
+	std::atomic<const T*> current;
+	std::atomic<std::uint64_t> epoch { 1 };
+
+	std::mutex writer;
+	std::vector<Reader*> readers;
+	std::vector<std::pair<std::uint64_t, const T*>> retired;
+
+
+	void publish_locked(std::unique_ptr<T> fresh) {
+		const T* old = current.exchange(fresh.release());
+		retired.emplace_back(epoch.fetch_add(1) + 1, old);
+		reclaim();
+	}
+
+	void reclaim() {
+		auto min_seen = std::numeric_limits<std::uint64_t>::max();
+
+		for (const Reader* r : readers)
+			min_seen = std::min(min_seen, r->seen_epoch.load(std::memory_order_acquire));
+
+		auto safe = std::partition(begin(retired), end(retired),
+			[&](const std::pair<std::uint64_t, const T*>& r) {
+				return r.first > min_seen;
+			});
+
+		for (auto i = safe; i != end(retired); ++i)
+			delete i->second;
+
+		retired.erase(safe, end(retired));
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,307 @@
+#include "utils/stat_batch.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ARGS_HAVE_IO_URING
+#endif
+#endif
+
+#ifdef ARGS_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace args {
+
+
+namespace {
+
+PathStat stat_one(const char* path) {
+	PathStat result;
+	struct stat st;
+
+	if (::stat(path, &st) != 0)
+		result.error = errno;
+	else
+		result.is_dir = S_ISDIR(st.st_mode);
+
+	return result;
+}
+
+
+#ifdef ARGS_HAVE_IO_URING
+
+// Minimal io_uring driven with raw syscalls (no liburing), used only to
+// submit statx requests in batches
+class StatRing {
+	int fd = -1;
+
+	unsigned sq_entries = 0;
+	unsigned cq_entries = 0;
+
+	void* sq_ring = MAP_FAILED;
+	void* cq_ring = MAP_FAILED;
+	std::size_t sq_ring_size = 0;
+	std::size_t cq_ring_size = 0;
+
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	std::size_t sqes_size = 0;
+
+	unsigned* sq_tail = nullptr;
+	unsigned* sq_mask = nullptr;
+	unsigned* sq_array = nullptr;
+
+	unsigned* cq_head = nullptr;
+	unsigned* cq_tail = nullptr;
+	unsigned* cq_mask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	std::vector<struct statx> buffers;
+
+	template <typename T>
+	static T* at(void* ring, unsigned offset) {
+		return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+	}
+
+	static unsigned load_acquire(unsigned* p) {
+		return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+	}
+
+	static void store_release(unsigned* p, unsigned value) {
+		__atomic_store_n(p, value, __ATOMIC_RELEASE);
+	}
+
+public:
+	explicit StatRing(unsigned entries) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof params);
+
+		fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+		if (fd < 0)
+			return;
+
+		sq_entries = params.sq_entries;
+		cq_entries = params.cq_entries;
+
+		sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+		if (single_mmap)
+			sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+		sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+		if (sq_ring == MAP_FAILED)
+			return;
+
+		cq_ring = single_mmap ? sq_ring : ::mmap(nullptr, cq_ring_size,
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+		if (cq_ring == MAP_FAILED)
+			return;
+
+		sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+		if (sqes == MAP_FAILED)
+			return;
+
+		sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+		sq_mask = at<unsigned>(sq_ring, params.sq_off.ring_mask);
+		sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+
+		cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+		cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+		cq_mask = at<unsigned>(cq_ring, params.cq_off.ring_mask);
+		cqes = at<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+		buffers.resize(sq_entries);
+	}
+
+	StatRing(const StatRing&) = delete;
+	StatRing& operator= (const StatRing&) = delete;
+
+	~StatRing() {
+		if (sqes != MAP_FAILED)
+			::munmap(sqes, sqes_size);
+
+		if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+			::munmap(cq_ring, cq_ring_size);
+
+		if (sq_ring != MAP_FAILED)
+			::munmap(sq_ring, sq_ring_size);
+
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	bool is_open() const {
+		return fd >= 0 && sqes != MAP_FAILED;
+	}
+
+	// waits for the completions of the requests still in flight, which write
+	// to buffers. False if the ring failed, buffers must then be leaked
+	bool drain(unsigned in_flight) {
+		while (in_flight > 0) {
+			long ret = ::syscall(__NR_io_uring_enter, fd, 0, in_flight,
+					IORING_ENTER_GETEVENTS, nullptr, 0);
+
+			if (ret < 0 && errno != EINTR)
+				return false;
+
+			unsigned head = *cq_head;
+			unsigned cq_end = load_acquire(cq_tail);
+
+			in_flight -= cq_end - head;
+			store_release(cq_head, cq_end);
+		}
+
+		return true;
+	}
+
+	// false if the kernel can't stat through io_uring, out is then incomplete.
+	// Every submitted request has completed when it returns
+	bool stat_all(const std::vector<const char*>& paths, std::vector<PathStat>& out) {
+		std::size_t next = 0;
+
+		while (next < paths.size()) {
+			// a batch never exceeds the rings, so it's submitted and reaped
+			// with a single io_uring_enter
+			unsigned batch = static_cast<unsigned>(std::min<std::size_t>(
+					std::min(sq_entries, cq_entries), paths.size() - next));
+
+			unsigned tail = *sq_tail;
+
+			for (unsigned i = 0; i < batch; i++) {
+				unsigned index = tail & *sq_mask;
+				io_uring_sqe& sqe = sqes[index];
+
+				std::memset(&sqe, 0, sizeof sqe);
+				sqe.opcode = IORING_OP_STATX;
+				sqe.fd = AT_FDCWD;
+				sqe.addr = reinterpret_cast<std::uintptr_t>(paths[next + i]);
+				sqe.len = STATX_TYPE;
+				sqe.off = reinterpret_cast<std::uintptr_t>(&buffers[i]);
+				sqe.statx_flags = AT_STATX_SYNC_AS_STAT;
+				sqe.user_data = i;
+
+				sq_array[index] = index;
+				tail++;
+			}
+
+			store_release(sq_tail, tail);
+
+			unsigned submitted = 0;
+			unsigned completed = 0;
+			bool supported = true;
+
+			while (completed < batch) {
+				long ret = ::syscall(__NR_io_uring_enter, fd,
+						batch - submitted, batch - completed,
+						IORING_ENTER_GETEVENTS, nullptr, 0);
+
+				if (ret < 0 && errno != EINTR) {
+					// the requests the kernel took still write to buffers
+					if (!drain(submitted - completed))
+						abandon_buffers();
+
+					return false;
+				}
+
+				if (ret > 0)
+					submitted += ret;
+
+				unsigned head = *cq_head;
+				unsigned cq_end = load_acquire(cq_tail);
+
+				for (; head != cq_end; head++) {
+					const io_uring_cqe& cqe = cqes[head & *cq_mask];
+
+					// statx is never invalid here, the opcode is unsupported
+					if (cqe.res == -EINVAL)
+						supported = false;
+
+					PathStat& result = out[next + cqe.user_data];
+
+					result.error = cqe.res < 0 ? -cqe.res : 0;
+					result.is_dir = cqe.res == 0 && S_ISDIR(buffers[cqe.user_data].stx_mode);
+
+					completed++;
+				}
+
+				store_release(cq_head, head);
+			}
+
+			if (!supported)
+				return false;
+
+			next += batch;
+		}
+
+		return true;
+	}
+
+private:
+	// for when the ring failed with requests in flight: the kernel may still
+	// write to buffers after the ring is closed, so they're never freed
+	void abandon_buffers() {
+		new std::vector<struct statx>(std::move(buffers));
+	}
+};
+
+#endif
+
+}
+
+
+void stat_batch(const std::vector<const char*>& paths, std::vector<PathStat>& out,
+		ThreadPool* pool, StatMethod method) {
+
+	out.assign(paths.size(), PathStat());
+
+	if (paths.empty())
+		return;
+
+#ifdef ARGS_HAVE_IO_URING
+	if (method == StatMethod::IoUring) {
+		unsigned entries = 1;
+
+		while (entries < paths.size() && entries < 4096)
+			entries *= 2;
+
+		StatRing ring(entries);
+
+		if (ring.is_open() && ring.stat_all(paths, out))
+			return;
+	}
+#else
+	(void) method;
+#endif
+
+	if (pool) {
+		pool->run(paths.size(), [&](std::size_t, std::size_t i) {
+			out[i] = stat_one(paths[i]);
+		});
+
+	} else {
+		for (std::size_t i = 0; i < paths.size(); i++)
+			out[i] = stat_one(paths[i]);
+	}
+}
+
+}
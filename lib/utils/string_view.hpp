@@ -20,6 +20,7 @@
 #ifndef ARGS_STRING_VIEW_H
 #define ARGS_STRING_VIEW_H
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -28,17 +29,21 @@
 namespace args {
 
 class StrView {
-	explicit StrView(const char* c_str, std::size_t size)
-		: m_c_str(c_str), m_size(size) {}
-
 	const char* m_c_str;
 	std::size_t m_size;
 
 public:
+	static constexpr std::size_t npos = std::size_t(-1);
+
 	StrView() : StrView("", 0) {}
 	StrView(const StrView&) = default;
 	StrView& operator= (const StrView&) = default;
 
+	// views built from a pointer and a size (e.g. with substr()) are not
+	// necessarily null-terminated
+	explicit StrView(const char* c_str, std::size_t size)
+		: m_c_str(c_str), m_size(size) {}
+
 	StrView(const char* c_str) : StrView(c_str, std::strlen(c_str)) {}
 
 	StrView(const std::string& str) : StrView(str.c_str(), str.size()) {}
@@ -49,27 +54,65 @@ public:
 	}
 
 	std::string str() const {
-		return c_str();
+		return std::string(m_c_str, m_size);
 	}
 
 	std::size_t size() const {
 		return m_size;
 	}
 
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	const char* begin() const {
+		return m_c_str;
+	}
+
+	const char* end() const {
+		return m_c_str + m_size;
+	}
+
 	char operator[](std::size_t pos) const {
 		return m_c_str[pos];
 	}
+
+	StrView substr(std::size_t pos, std::size_t n = npos) const {
+		return StrView(m_c_str + pos, std::min(n, m_size - pos));
+	}
+
+	bool starts_with(const StrView& prefix) const {
+		return m_size >= prefix.m_size &&
+			std::memcmp(m_c_str, prefix.m_c_str, prefix.m_size) == 0;
+	}
+
+	int compare(const StrView& other) const {
+		int cmp = std::memcmp(m_c_str, other.m_c_str, std::min(m_size, other.m_size));
+
+		if (cmp != 0)
+			return cmp;
+		else
+			return m_size < other.m_size ? -1 : m_size > other.m_size ? 1 : 0;
+	}
 };
 
 }
 
 inline bool operator== (const args::StrView& v1, const args::StrView& v2) {
 	return v1.size() == v2.size() &&
-		std::strncmp(v1.c_str(), v2.c_str(), v1.size()) == 0;
+		std::memcmp(v1.c_str(), v2.c_str(), v1.size()) == 0;
+}
+
+inline bool operator!= (const args::StrView& v1, const args::StrView& v2) {
+	return !(v1 == v2);
+}
+
+inline bool operator< (const args::StrView& v1, const args::StrView& v2) {
+	return v1.compare(v2) < 0;
 }
 
 inline std::ostream& operator<< (std::ostream& o, const args::StrView& v) {
-	return o << v.c_str();
+	return o.write(v.c_str(), v.size());
 }
 
 
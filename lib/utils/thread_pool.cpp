@@ -0,0 +1,102 @@
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace args {
+
+
+ThreadPool::ThreadPool(std::size_t threads) {
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	ranges.reset(new Range[threads]);
+
+	for (std::size_t w = 0; w < threads; w++) {
+		ranges[w].next = 0;
+		ranges[w].end = 0;
+	}
+
+	for (std::size_t w = 1; w < threads; w++)
+		workers.emplace_back(&ThreadPool::worker_loop, this, w);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	start_cv.notify_all();
+
+	for (auto& t : workers)
+		t.join();
+}
+
+
+void ThreadPool::run(std::size_t count, const Task& task) {
+	std::size_t n = size();
+
+	for (std::size_t w = 0; w < n; w++) {
+		ranges[w].next.store(count * w / n, std::memory_order_relaxed);
+		ranges[w].end = count * (w + 1) / n;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		running = workers.size();
+		generation++;
+	}
+
+	start_cv.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done_cv.wait(lock, [&] { return running == 0; });
+	this->task = nullptr;
+}
+
+
+void ThreadPool::work(std::size_t worker) {
+	std::size_t n = size();
+
+	for (std::size_t k = 0; k < n; k++) {
+		// own range first, then steal from the next ones
+		Range& r = ranges[(worker + k) % n];
+
+		for (;;) {
+			std::size_t i = r.next.fetch_add(1, std::memory_order_relaxed);
+
+			if (i >= r.end)
+				break;
+
+			(*task)(worker, i);
+		}
+	}
+}
+
+void ThreadPool::worker_loop(std::size_t worker) {
+	std::size_t seen = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start_cv.wait(lock, [&] { return stopping || generation != seen; });
+
+			if (stopping)
+				return;
+
+			seen = generation;
+		}
+
+		work(worker);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (--running == 0)
+			done_cv.notify_one();
+	}
+}
+
+}
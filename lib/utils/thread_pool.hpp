@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_THREAD_POOL_H
+#define ARGS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace args {
+
+// Fixed set of worker threads that run indexed tasks. Every worker starts with
+// a contiguous range of task indices and steals from the ranges of the others
+// once its own is exhausted, so uneven tasks still keep every core busy.
+class ThreadPool {
+public:
+	using Task = std::function<void(std::size_t worker, std::size_t index)>;
+
+	// threads == 0 uses one worker per hardware thread. The thread calling
+	// run() counts as a worker
+	explicit ThreadPool(std::size_t threads = 0);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator= (const ThreadPool&) = delete;
+
+	~ThreadPool();
+
+
+	std::size_t size() const {
+		return workers.size() + 1;
+	}
+
+	// runs task(worker, i) for every i in [0, count) and waits for all of them.
+	// worker is in [0, size()), and can be used to index per-thread scratch data
+	void run(std::size_t count, const Task& task);
+
+private:
+	// padded to a cache line, so that workers taking indices from neighbouring
+	// ranges don't share one (new doesn't honour alignas(64) before C++17)
+	struct Range {
+		std::atomic<std::size_t> next;
+		std::size_t end;
+		char padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+	};
+
+	std::vector<std::thread> workers;
+	std::unique_ptr<Range[]> ranges;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+
+	const Task* task = nullptr;
+	std::size_t generation = 0;
+	std::size_t running = 0;
+	bool stopping = false;
+
+
+	void work(std::size_t worker);
+
+	void worker_loop(std::size_t worker);
+};
+
+}
+
+#endif
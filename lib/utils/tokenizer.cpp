@@ -0,0 +1,207 @@
+#include "utils/tokenizer.hpp"
+#include "utils/memory_resource.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace args {
+
+
+namespace {
+
+bool is_shell_special(char c) {
+	return is_word_separator(c) || c == '\'' || c == '"' || c == '\\';
+}
+
+bool is_dquote_special(char c) {
+	return c == '"' || c == '\\';
+}
+
+bool is_dquote_escape(char c) {
+	return c == '$' || c == '`' || c == '"' || c == '\\';
+}
+
+#ifdef __SSE2__
+
+// bit i is set if the byte i of v is c
+int match(__m128i v, char c) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+int ctz(int mask) {
+	return __builtin_ctz(static_cast<unsigned>(mask));
+}
+
+#endif
+
+// first word separator, quote or backslash in [p, end), or end
+const char* find_shell_special(const char* p, const char* end) {
+#ifdef __SSE2__
+	for (; end - p >= 16; p += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		int mask = match(v, ' ') | match(v, '\t') | match(v, '\n') | match(v, '\r')
+			| match(v, '\'') | match(v, '"') | match(v, '\\');
+
+		if (mask != 0)
+			return p + ctz(mask);
+	}
+#endif
+
+	while (p < end && !is_shell_special(*p))
+		p++;
+
+	return p;
+}
+
+// first '"' or backslash in [p, end), or end
+const char* find_dquote_special(const char* p, const char* end) {
+#ifdef __SSE2__
+	for (; end - p >= 16; p += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		int mask = match(v, '"') | match(v, '\\');
+
+		if (mask != 0)
+			return p + ctz(mask);
+	}
+#endif
+
+	while (p < end && !is_dquote_special(*p))
+		p++;
+
+	return p;
+}
+
+
+// A word being built from runs of literal characters. It stays a view into
+// the input as long as the runs are contiguous, and is copied into buffer
+// once they aren't.
+struct ShellWord {
+	std::string& buffer;
+	const char* data;
+	std::size_t size;
+	bool copied;
+
+	ShellWord(std::string& buffer, const char* start)
+		: buffer(buffer)
+		, data(start)
+		, size(0)
+		, copied(false) {}
+
+	void append(const char* p, std::size_t n) {
+		if (n == 0)
+			return;
+
+		if (!copied) {
+			if (size == 0)
+				data = p;
+
+			if (data + size == p) {
+				size += n;
+				return;
+			}
+
+			std::size_t start = buffer.size();
+			buffer.append(data, size);
+			data = &buffer[start];
+			copied = true;
+		}
+
+		buffer.append(p, n);
+		size += n;
+	}
+
+	StrView view() const {
+		return StrView(data, size);
+	}
+};
+
+}
+
+
+template <typename Words>
+bool split_shell(StrView s, Words& words, std::string& buffer,
+		std::vector<std::size_t>* word_ends) {
+	buffer.clear();
+	buffer.reserve(s.size());
+
+	const char* p = s.begin();
+	const char* end = s.end();
+
+	while (true) {
+		while (p < end && is_word_separator(*p))
+			p++;
+
+		if (p == end)
+			return true;
+
+		ShellWord word(buffer, p);
+
+		while (p < end && !is_word_separator(*p)) {
+			const char* q = find_shell_special(p, end);
+			word.append(p, q - p);
+			p = q;
+
+			if (p == end || is_word_separator(*p))
+				break;
+
+			char c = *p++;
+
+			if (c == '\\') {
+				if (p == end)
+					return false;
+
+				if (*p != '\n')
+					word.append(p, 1);
+
+				p++;
+
+			} else if (c == '\'') {
+				q = static_cast<const char*>(std::memchr(p, '\'', end - p));
+
+				if (!q)
+					return false;
+
+				word.append(p, q - p);
+				p = q + 1;
+
+			} else {
+				while (true) {
+					q = find_dquote_special(p, end);
+					word.append(p, q - p);
+					p = q;
+
+					if (p == end)
+						return false;
+
+					if (*p++ == '"')
+						break;
+
+					if (p == end)
+						return false;
+
+					if (is_dquote_escape(*p))
+						word.append(p++, 1);
+					else if (*p == '\n')
+						p++;
+					else
+						word.append(p - 1, 1);
+				}
+			}
+		}
+
+		words.push_back(word.view());
+
+		if (word_ends)
+			word_ends->push_back(p - s.begin());
+	}
+}
+
+template bool split_shell(StrView, std::vector<StrView>&, std::string&,
+		std::vector<std::size_t>*);
+template bool split_shell(StrView, PolyVector<StrView>&, std::string&,
+		std::vector<std::size_t>*);
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 xcv_
+ *
+ * This file is part of Args.
+ *
+ *  Args is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Args is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Args.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef ARGS_TOKENIZER_H
+#define ARGS_TOKENIZER_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utils/string_view.hpp"
+
+
+namespace args {
+
+inline bool is_word_separator(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// appends the whitespace-separated words of s to words, as views into s
+template <typename Words>
+void split_words(StrView s, Words& words) {
+	std::size_t i = 0;
+
+	while (i < s.size()) {
+		while (i < s.size() && is_word_separator(s[i]))
+			i++;
+
+		std::size_t start = i;
+
+		while (i < s.size() && !is_word_separator(s[i]))
+			i++;
+
+		if (i > start)
+			words.push_back(s.substr(start, i - start));
+	}
+}
+
+// appends the lines of s to lines, without the '\n' (or "\r\n")
+inline void split_lines(StrView s, std::vector<StrView>& lines) {
+	std::size_t pos = 0;
+
+	while (pos < s.size()) {
+		auto nl = static_cast<const char*>(
+				std::memchr(s.c_str() + pos, '\n', s.size() - pos));
+
+		std::size_t end = nl ? nl - s.c_str() : s.size();
+		std::size_t len = end - pos;
+
+		if (len > 0 && s[end-1] == '\r')
+			len--;
+
+		lines.push_back(s.substr(pos, len));
+		pos = end + 1;
+	}
+}
+
+// Splits a command line like a POSIX shell: words are separated by
+// whitespace, '...' keeps everything literally, "..." only interprets \$ \`
+// \" \\ and \<newline>, and \ outside of quotes escapes any character.
+// Other shell syntax ($var, |, ;, ...) is kept as is. The words are appended to
+// words as views into s when they don't need unescaping (including words that
+// are a single quoted string), otherwise they are unescaped into buffer, which
+// is reserved to s.size() beforehand so the views stay valid until buffer is
+// modified. Returns false on an unterminated quote or a trailing backslash.
+// If word_ends is given, the offset in s of the end of every word is appended
+// to it. Defined for std::vector<StrView> and PolyVector<StrView>.
+template <typename Words>
+bool split_shell(StrView s, Words& words, std::string& buffer,
+		std::vector<std::size_t>* word_ends = nullptr);
+
+}
+
+#endif